@@ -10,6 +10,7 @@
 #include "rtypes.h"
 #include "r3util.h"
 #include "rutil.h"
+#include "engine.h"
 
 #define MAX_STAMINA_MANOEUVRE    3
 #define MAX_TWS_STAMINA          30
@@ -342,3 +343,31 @@ struct tm dashboardImportParam (const char *fileName, CompetitorsList *competito
    return tm0; 
 }
 
+/*! Import all boats of virtual Regatta dashboard file in fleet, whatever their number
+   return: number of boats added, -1 if file cannot be opened
+*/
+int dashboardImportFleet (const char *fileName, FleetList *fleet) {
+   double lat, lon;
+   char line [MAX_SIZE_LINE];
+   int nLine = 0, nBoats = 0;
+   FILE *file = fopen (fileName, "r");
+
+   if (file == NULL) {
+      fprintf (stderr, "In dashboardImportFleet, could not open file: %s\n", fileName);
+      return -1;
+   }
+   while (fgets (line, sizeof (line), file)) {
+      nLine += 1;
+      char **tokens = g_strsplit (line, ";", -1);
+      int nCol = g_strv_length (tokens);
+      if ((nLine > 5) && (nCol > MIN_COL_VR_DASHBOARD) && (nCol <= MAX_COL_VR_DASHBOARD)) {
+         g_strstrip (tokens [1]);                           // second column as name
+         if (analyseCoord (tokens [10], &lat, &lon) && fleetAdd (fleet, tokens [1], lat, lon)) // 11th column with lat, lon
+            nBoats += 1;
+      }
+      g_strfreev (tokens);
+   }
+   fclose (file);
+   return nBoats;
+}
+
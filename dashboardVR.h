@@ -1,2 +1,3 @@
 extern void   staminaCalculator (GtkApplication *application);
 extern struct tm dashboardImportParam (const char *filename, CompetitorsList *competitors, char *report, size_t maxLen, char *footer, size_t maxLenFooter);
+extern int    dashboardImportFleet (const char *fileName, FleetList *fleet);
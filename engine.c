@@ -19,17 +19,23 @@
 #include "inline.h"
 #include "r3util.h"
 #include "grib.h"
+#include "polar.h"
+#include "engine.h"
 
 #define MAX_N_INTERVAL  1000                    // for chooseDeparture
 #define LIMIT           1                       // for forwardSectorOptimize
 #define MIN_VMC_RATIO   0.5                     // for forwardSectorOptimize
 #define MAX_N_HISTORY   20                      // for saveRoute
-#define MAX_UNREACHABLE 0                       // for bestTimeDeparture. 0 mens stop after first unreeach detected.
+#define PRUNE_SPEED_MARGIN 1.1                  // for bestTimeDeparture pruning. Safety factor on max speed for admissible bound
+#define MAX_N_DEPARTURE MIN (MAX_N_INTERVAL + 1, MAX_N_TIME_STAMPS) // for bestTimeDeparture. Bounded by chooseDeparture.t size
+#define DEPARTURE_POLL_TIME 100000              // in microseconds, for bestTimeDeparture stop request check
 #define LIMIT_SOG       100                     // for SOG error detection
 #define MIN_DT          0.1                     // in hours, the minimum delta time to progress, includi,ng penalties
+#define MAX_N_HEADINGS  512                     // for headingSweep. Above, scalar sweep is used
+#define MIN_PT_PER_THREAD 64                    // for buildNextIsochrone. Under this number of points per thread, no split
 
 /*! global variables */
-Pp      *isocArray = NULL;                      // list of isochrones Two dimensions array : maxNIsoc  * MAX_SIZE_ISOC
+Pp      **isocArray = NULL;                     // list of isochrones. isocArray [i][k] is point k of isochrone i
 IsoDesc *isoDesc = NULL;                        // Isochrone meta data. Array one dimension.
 int     maxNIsoc = 0;                           // Max number of isochrones based on based on Grib zone time stamp and isochrone time step
 int     nIsoc = 0;                              // total number of isochrones 
@@ -41,18 +47,8 @@ HistoryRouteList historyRoute = { .n = 0, .r = NULL };
 
 ChooseDeparture chooseDeparture;                // for choice of departure time
 
-/*! static global variable. If linking issue, remove static */
-static double pOrToPDestCog = 0.0;              // cog from pOr to pDest.
-static int    pId = 1;                          // global ID for points. -1 and 0 are reserved for pOr and pDest
-static double tDeltaCurrent = 0.0;              // delta time in hours between wind zone and current zone
-
-typedef struct {
-   double vmc;
-   double orthoVmc;
-   int nPt;
-} Sector;
-
-Sector sector [2][MAX_N_SECTORS];               // we keep even and odd last sectors
+/*! global variables above are a view of this context, used by routingLaunch, bestTimeDeparture and allCompetitors */
+static RoutingContext *legacyCtx = NULL;
 
 /*! return distance from point X do segment [AB]. Meaning to H, projection of X en [AB] */
 static double distSegment (double latX, double lonX, double latA, double lonA, double latB, double lonB) {
@@ -94,20 +90,20 @@ static double distSegment (double latX, double lonX, double latA, double lonA, d
 }
 
 /*! find first point in isochrone. Useful for drawAllIsochrones */ 
-static inline int findFirst (int nIsoc) {
+static inline int findFirst (const RoutingContext *ctx, int nIsoc) {
    int best = 0, next;
    double dSquare, dSquareMax = 0.0;
-   int size = isoDesc[nIsoc].size;
+   int size = ctx->isoDesc[nIsoc].size;
    if (size <= 1) return 0;
    
-   int baseIndex = nIsoc * MAX_SIZE_ISOC;
+   const Pp *iso = ctx->isocArray [nIsoc];
 
    for (int i = 0; i < size; i++) {
       next = (i >= size -1) ? 0 : i + 1;
 
-      double nextLat = isocArray [baseIndex + next].lat;
-      double deltaLat = isocArray [baseIndex + i].lat - nextLat;
-      double deltaLon = (isocArray [baseIndex + i].lon - isocArray [baseIndex + next].lon) * cos (DEG_TO_RAD * nextLat);
+      double nextLat = iso [next].lat;
+      double deltaLat = iso [i].lat - nextLat;
+      double deltaLon = (iso [i].lon - iso [next].lon) * cos (DEG_TO_RAD * nextLat);
       // square pythagore distance in degrees
       dSquare = deltaLat * deltaLat + deltaLon * deltaLon;
       if (dSquare > dSquareMax) {
@@ -119,8 +115,8 @@ static inline int findFirst (int nIsoc) {
 }
 
 /*! initialization of sector */
-static inline void initSector(int nIsoc, int nMax) {
-   memset (sector[nIsoc], 0, nMax * sizeof(Sector));
+static inline void initSector(RoutingContext *ctx, int nIsoc, int nMax) {
+   memset (ctx->sector[nIsoc], 0, nMax * sizeof(Sector));
 }
 
 /*! reduce the size of Isolist 
@@ -128,29 +124,31 @@ static inline void initSector(int nIsoc, int nMax) {
    make new isochrone optIsoc
    return the length of this isochrone 
    side effect: update  isoDesc */
-static inline int forwardSectorOptimize (const Pp *pOr, const Pp *pDest, int nIsoc, const Pp *isoList, int isoLen, Pp *optIsoc) {
+static inline int forwardSectorOptimize (RoutingContext *ctx, const Pp *pOr, const Pp *pDest, int nIsoc, const Pp *isoList, const PpMetric *metric,
+   int isoLen, Pp *optIsoc) {
    int iSector, k;
    double focalLat, focalLon; // center of sectors
    const double epsilonDenominator = 0.01;
    const int thresholdSector = 5;
-   const int nSectors = (nIsoc < thresholdSector) ? 180 : par.nSectors;
+   const int nSectors = (nIsoc < thresholdSector) ? 180 : ctx->par.nSectors;
    const double thetaStep = 360.0 / nSectors;
    const double invThetaStep = 1.0 / thetaStep;  // replace division by multiplication for perf
    const double denominator = cos (DEG_TO_RAD * (pOr->lat + pDest->lat) / 2.0);
+   const double pOrToPDestDist = orthoDist (pOr->lat, pOr->lon, pDest->lat, pDest->lon);
 
    if (denominator < epsilonDenominator) { // really small !
       fprintf (stderr, "In forwardSectorOptimize, Error denominator: %.8lf\n", denominator);
       return 0;
    }
 
-   if (par.jFactor == 0 || nIsoc < LIMIT) { // LIMIT SOULD BE > 0 
+   if (ctx->par.jFactor == 0 || nIsoc < LIMIT) { // LIMIT SOULD BE > 0 
       focalLat = pOr->lat; 
       focalLon = pOr->lon;
    }
    else {
-      double dist = isoDesc [nIsoc - LIMIT].bestVmc * (par.jFactor / 100.0) - isoDesc[nIsoc - LIMIT].biggestOrthoVmc * (par.kFactor / 100.0);
-      double dLat = dist * cos (DEG_TO_RAD * pOrToPDestCog);               // nautical miles in N S direction
-      double dLon = dist * sin (DEG_TO_RAD * pOrToPDestCog) / denominator; // nautical miles in E W direction
+      double dist = ctx->isoDesc [nIsoc - LIMIT].bestVmc * (ctx->par.jFactor / 100.0) - ctx->isoDesc[nIsoc - LIMIT].biggestOrthoVmc * (ctx->par.kFactor / 100.0);
+      double dLat = dist * cos (DEG_TO_RAD * ctx->pOrToPDestCog);               // nautical miles in N S direction
+      double dLon = dist * sin (DEG_TO_RAD * ctx->pOrToPDestCog) / denominator; // nautical miles in E W direction
       focalLat = pOr->lat + dLat / 60.0; 
       focalLon = pOr->lon + dLon / 60.0;
       if (focalLat  < -90.0 || focalLat > 90.0) {
@@ -163,29 +161,29 @@ static inline int forwardSectorOptimize (const Pp *pOr, const Pp *pDest, int nIs
       }
    }
 
-   isoDesc [nIsoc].focalLat = focalLat;
-   isoDesc [nIsoc].focalLon = focalLon;
+   ctx->isoDesc [nIsoc].focalLat = focalLat;
+   ctx->isoDesc [nIsoc].focalLon = focalLon;
    const int currentSector = nIsoc % 2;
    const int previousSector = (nIsoc - 1) % 2;
   
-   initSector (nIsoc % 2, nSectors);
+   initSector (ctx, nIsoc % 2, nSectors);
 
    for (int i = 0; i < isoLen; i++) {
       const Pp *iso = &isoList[i];
 
       double alpha = orthoCap (focalLat, focalLon, iso->lat, iso->lon);
-      double theta = pOrToPDestCog - alpha;
+      double theta = ctx->pOrToPDestCog - alpha;
 
       if (theta < 0) theta += 360.0;
       else if (theta >= 360.0) theta -= 360.0;
 
       int iSector = round ((360.0 - theta) * invThetaStep);
 
-      Sector *sect = &sector[currentSector][iSector];
+      Sector *sect = &ctx->sector[currentSector][iSector];
 
-      if (iso->vmc > sect->vmc) {
-         sect->vmc = iso->vmc;
-         sect->orthoVmc = iso->orthoVmc;
+      if (metric [i].vmc > sect->vmc) {
+         sect->vmc = metric [i].vmc;
+         sect->orthoVmc = metric [i].orthoVmc;
          optIsoc [iSector] = *iso;
       }
       sect->nPt += 1;
@@ -193,16 +191,15 @@ static inline int forwardSectorOptimize (const Pp *pOr, const Pp *pDest, int nIs
 
    k = 0;
    for (iSector = 0; iSector < nSectors; iSector += 1) {
-      const Sector *current = &sector[currentSector][iSector];  // Direct access with pointer to improve perf
-      const Sector *previous = &sector[previousSector][iSector];
+      const Sector *current = &ctx->sector[currentSector][iSector];  // Direct access with pointer to improve perf
+      const Sector *previous = &ctx->sector[previousSector][iSector];
 
       if ((current->nPt > 0) &&
-         (current->vmc < pOr->dd * 1.1) &&
-         ((current->orthoVmc >= isoDesc[nIsoc - 1].biggestOrthoVmc) ||  (current->vmc >= MIN_VMC_RATIO * isoDesc[nIsoc - 1].bestVmc)) &&
+         (current->vmc < pOrToPDestDist * 1.1) &&
+         ((current->orthoVmc >= ctx->isoDesc[nIsoc - 1].biggestOrthoVmc) ||  (current->vmc >= MIN_VMC_RATIO * ctx->isoDesc[nIsoc - 1].bestVmc)) &&
          ((current->vmc >= previous->vmc))) {
 
          optIsoc[k] = optIsoc [iSector];
-         optIsoc[k].sector = iSector;
          k++;
       }
    }
@@ -210,87 +207,255 @@ static inline int forwardSectorOptimize (const Pp *pOr, const Pp *pDest, int nIs
 }
 
 /*! choice of algorithm used to reduce the size of Isolist */
-static inline int optimize (const Pp *pOr, const Pp *pDest, int nIsoc, int algo, const Pp *isoList, int isoLen, Pp *optIsoc) {
+static inline int optimize (RoutingContext *ctx, const Pp *pOr, const Pp *pDest, int nIsoc, int algo, const Pp *isoList, const PpMetric *metric,
+   int isoLen, Pp *optIsoc) {
    switch (algo) {
       case 0: 
          memcpy (optIsoc, isoList, isoLen * sizeof (Pp)); 
          return isoLen;
       case 1:
-         return forwardSectorOptimize (pOr, pDest, nIsoc, isoList, isoLen, optIsoc);
+         return forwardSectorOptimize (ctx, pOr, pDest, nIsoc, isoList, metric, isoLen, optIsoc);
    } 
    return 0;
 }
 
-/*! build the new list describing the next isochrone, starting from isoList 
-  returns length of the newlist built or -1 if error*/
-static int buildNextIsochrone (const Pp *pOr, const Pp *pDest, const Pp *isoList, int isoLen,
-                               double t, double dt, Pp *newList, double *bestVmc, double *biggestOrthoVmc) {
+/*! chunks of one isochrone given to chunk workers, counted down as they are expanded */
+typedef struct {
+   GMutex mutex;
+   GCond done;
+   int pending;                                 // chunks not yet expanded by workers
+} ChunkBatch;
+
+/*! work description for one slice of isoList expanded by buildNextIsochrone */
+typedef struct {
+   const RoutingContext *ctx;
+   ChunkBatch *batch;                           // signaled when expanded by a chunk worker
+   const Pp *pOr;
+   const Pp *pDest;
+   const Pp *isoList;
+   int kBegin;                                  // first index in isoList
+   int kEnd;                                    // last index in isoList excluded
+   double t;
+   double dt;
+   Pp *newList;                                 // MAX_SIZE_ISOC points available
+   PpMetric *newMetric;                         // metrics of newList points
+   int lenNewL;                                 // number of points produced, -1 if overflow
+   int nCandidates;                             // number of candidate points, including those on earth
+   double bestVmc;
+   double biggestOrthoVmc;
+} IsocChunk;
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define SIMD_CLONES __attribute__((target_clones ("avx2", "default"))) // AVX2 version selected at run time if available
+#else
+#define SIMD_CLONES                                                      // NEON is baseline on aarch64
+#endif
+
+/*! headings of one isochrone point, structure of arrays for vectorized heading sweep */
+typedef struct {
+   int n;
+   double cog [MAX_N_HEADINGS];
+   double twa [MAX_N_HEADINGS];
+   double sog [MAX_N_HEADINGS];
+   double lat [MAX_N_HEADINGS];
+   double lon [MAX_N_HEADINGS];
+   double vmc [MAX_N_HEADINGS];
+   double orthoVmc [MAX_N_HEADINGS];
+   int amure [MAX_N_HEADINGS];
+   int sail [MAX_N_HEADINGS];
+} HeadingSweep;
+
+/*! TWA and amure of all headings. Branch free loop vectorized by compiler */
+SIMD_CLONES
+static void sweepTwa (double twd, HeadingSweep *sw) {
+   for (int i = 0; i < sw->n; i++) {                                // fTwa with fmod replaced by truncation
+      double val = twd - sw->cog [i];
+      val -= 360.0 * (int) (val / 360.0);
+      sw->twa [i] = val - 360.0 * ((val > 180) - (val < -180));
+      sw->amure [i] = (sw->twa [i] > 0.0) ? TRIBORD : BABORD;
+   }
+}
+
+/*! penalties, new positions, vmc and orthoVmc of all headings. Branch free loop vectorized by compiler.
+   orthoCap from pOr is not computed: cos and sin of alpha are obtained from the normalized direct cap vector */
+SIMD_CLONES
+static void sweepMove (const Pp *isoPt, const Pp *pOr, double pOrToPDestCog, double p0, double p1, double p2,
+   double dt, double invDenominator, double dLatCurr, double dLonCurr, HeadingSweep *sw) {
+
+   double sLatOr, cLatOr;
+   fastSinCosDeg (pOr->lat, &sLatOr, &cLatOr);
+
+   for (int i = 0; i < sw->n; i++) {
+      double penalty = (sw->amure [i] != isoPt->amure) ? ((fabs (sw->twa [i]) < 90.0) ? p0 : p1) : 0.0;
+      penalty += (sw->sail [i] != isoPt->sail) ? p2 : 0.0;
+      const double realDt = MAX (dt - penalty, MIN_DT);
+      double sCog, cCog;
+      fastSinCosDeg (sw->cog [i], &sCog, &cCog);
+      const double lat = isoPt->lat + (sw->sog [i] * realDt * cCog + dLatCurr) / 60.0;
+      const double lon = isoPt->lon + (sw->sog [i] * realDt * sCog * invDenominator + dLonCurr) / 60.0;
+      sw->lat [i] = lat;
+      sw->lon [i] = lon;
+
+      double sLat, cLat, sTheta, cTheta;
+      fastSinCosDeg (lat, &sLat, &cLat);
+      fastSinCosDeg (lon - pOr->lon, &sTheta, &cTheta);             // orthoDist to pOr
+      const double distOr = 60.0 * RAD_TO_DEG * fastAcos (CLAMP (sLat * sLatOr + cLat * cLatOr * cTheta, -1.0, 1.0));
+
+      double sAvg, cAvg, sD, cD;
+      fastSinCosDeg (0.5 * (pOr->lat + lat), &sAvg, &cAvg);
+      const double y = (lon - pOr->lon) * cAvg;
+      const double x = lat - pOr->lat;
+      const double r = sqrt (x * x + y * y);
+      const double invR = 1.0 / ((r > 0) ? r : 1.0);
+      const double cA = (r > 0) ? x * invR : 1.0;
+      const double sA = y * invR;
+      fastSinCosDeg (-0.5 * (lon - pOr->lon) * sAvg - pOrToPDestCog, &sD, &cD); // givry correction - pOrToPDestCog
+      sw->vmc [i] = distOr * (cA * cD - sA * sD);                   // cos (alpha)
+      sw->orthoVmc [i] = distOr * fabs (sA * cD + cA * sD);         // sin (alpha)
+   }
+}
+
+/*! same computation as the cog loop of expandChunk, pass by pass on all headings of isoPt.
+   Polar lookups stay scalar. Results differ from scalar path by rounding only: about 1e-12 degree on positions */
+static inline void headingSweep (const RoutingContext *ctx, const Pp *isoPt, const Pp *pOr, double minCog, double maxCog,
+   double twd, double tws, double w, double uCurr, double vCurr, bool motor, double efficiency, double invDenominator, double dt,
+   HeadingSweep *sw) {
+
+   int n = 0, bidon;
+   for (double cog = minCog; (cog <= maxCog) && (n < MAX_N_HEADINGS); cog += ctx->par.cogStep)
+      sw->cog [n++] = cog;                                          // same accumulation as scalar loop
+   sw->n = n;
+
+   sweepTwa (twd, sw);
+
+   for (int i = 0; i < n; i++) {
+      if (motor) {
+         sw->sog [i] = ctx->par.motorSpeed;
+         sw->sail [i] = 0;
+      } else
+         sw->sog [i] = efficiency * findPolar (sw->twa [i], tws * ctx->par.xWind, ctx->data.polMat, ctx->data.sailPolMat, &sw->sail [i]);
+      if (ctx->par.withWaves && (w > 0))
+         sw->sog [i] *= findPolar (sw->twa [i], w, ctx->data.wavePolMat, NULL, &bidon) / 100.0;
+   }
+
+   sweepMove (isoPt, pOr, ctx->pOrToPDestCog,
+      motor ? 0.0 : ctx->par.penalty0 / 3600.0,                     // tack
+      motor ? 0.0 : ctx->par.penalty1 / 3600.0,                     // gybe
+      motor ? 0.0 : ctx->par.penalty2 / 3600.0,                     // sail change
+      dt, invDenominator,
+      ctx->par.withCurrent ? MS_TO_KN * vCurr * dt : 0.0,
+      ctx->par.withCurrent ? MS_TO_KN * uCurr * dt * invDenominator : 0.0,
+      sw);
+}
+
+/*! true if step from isoPt to (lat, lon) is at sea: end of step only, or each cell crossed if par.segmentSea */
+static inline bool stepAtSea (const RoutingContext *ctx, const Pp *isoPt, double lat, double lon) {
+   if (ctx->par.segmentSea)
+      return isSeaSegment (ctx->data.tIsSea, isoPt->lat, isoPt->lon, lat, lon);
+   return isSea (ctx->data.tIsSea, lat, lon);
+}
+
+/*! expand points kBegin to kEnd - 1 of isoList. Point id is local to the chunk: index of candidate.
+   Reads only ctx so several chunks can run concurrently */
+static void expandChunk (IsocChunk *c) {
    Pp newPt;
+   HeadingSweep sweep;                                  // about 32 KB, used if par.vectorSweep
    bool motor;
-   int lenNewL = 0;
    double u, v, gust, w, twa, sog, uCurr, vCurr, currTwd, currTws, vDirectCap;
    double dLat, dLon, penalty;
    double waveCorrection, invDenominator, twd, tws;
    const double epsilon = 0.01;
-   struct tm tm0 = gribDateToTm(zone.dataDate[0], zone.dataTime[0] / 100);
-   int bidon; // useless
+   const RoutingContext *ctx = c->ctx;
+   const Pp *pOr = c->pOr, *pDest = c->pDest;
+   const double t = c->t, dt = c->dt;
+   int sail, bidon; // bidon useless
 
-   *bestVmc = 0;
-   *biggestOrthoVmc = 0;
+   c->lenNewL = 0;
+   c->nCandidates = 0;
+   c->bestVmc = 0;
+   c->biggestOrthoVmc = 0;
 
-   for (int k = 0; k < isoLen; k++) {
-      const Pp *isoPt = &isoList[k];
+   for (int k = c->kBegin; k < c->kEnd; k++) {
+      const Pp *isoPt = &c->isoList[k];
 
-      if (!isInZone (isoPt->lat, isoPt->lon, &zone) && (par.constWindTws == 0))
+      if (!isInZone (isoPt->lat, isoPt->lon, ctx->data.zone) && (ctx->par.constWindTws == 0))
          continue;
 
-      findWindGrib (isoPt->lat, isoPt->lon, t, &u, &v, &gust, &w, &twd, &tws);
-      if (tws > par.maxWind)
+      findWindSlice (&ctx->windSlice, &ctx->par, ctx->data.zone, ctx->data.windData, isoPt->lat, isoPt->lon, t, &u, &v, &gust, &w, &twd, &tws);
+      if (tws > ctx->par.maxWind)
          continue; // avoid location where wind speed too high...
 
-      if (par.withCurrent)
-         findCurrentGrib (isoPt->lat, isoPt->lon, t - tDeltaCurrent, &uCurr, &vCurr, &currTwd, &currTws);
+      if (ctx->par.withCurrent)
+         findCurrentSlice (&ctx->currentSlice, &ctx->par, ctx->data.currentZone, ctx->data.currentData, isoPt->lat, isoPt->lon, t - ctx->tDeltaCurrent, 
+            &uCurr, &vCurr, &currTwd, &currTws);
 
       vDirectCap = orthoCap (isoPt->lat, isoPt->lon, pDest->lat, pDest->lon);
-      motor = (maxSpeedInPolarAt (tws * par.xWind, &polMat) < par.threshold) && (par.motorSpeed > 0);
+      motor = (maxSpeedInPolarAt (tws * ctx->par.xWind, ctx->data.polMat) < ctx->par.threshold) && (ctx->par.motorSpeed > 0);
       invDenominator = 1.0 / MAX (epsilon, cos (DEG_TO_RAD * isoPt->lat));
       
-      struct tm localTm = tm0; // working on local copy improve performances
-      const double efficiency = isDayLight (&localTm, t, isoPt->lat, isoPt->lon) ? par.dayEfficiency : par.nightEfficiency;
-
-      double minCog = vDirectCap - par.rangeCog;
-      double maxCog = vDirectCap + par.rangeCog;
+      const double efficiency = isDayLightFast (&ctx->dayLight, t, isoPt->lat, isoPt->lon) ? ctx->par.dayEfficiency : ctx->par.nightEfficiency;
+
+      double minCog = vDirectCap - ctx->par.rangeCog;
+      double maxCog = vDirectCap + ctx->par.rangeCog;
+
+      if (ctx->par.vectorSweep && (2 * ctx->par.rangeCog / MAX (ctx->par.cogStep, 1) + 2 <= MAX_N_HEADINGS)) {
+         HeadingSweep *sw = &sweep;
+         headingSweep (ctx, isoPt, pOr, minCog, maxCog, twd, tws, w, uCurr, vCurr, motor, efficiency, invDenominator, dt, sw);
+         for (int i = 0; i < sw->n; i++) {
+            newPt.id = c->nCandidates++;                                   // rebased by buildNextIsochrone
+            if (!ctx->par.allwaysSea && !stepAtSea (ctx, isoPt, sw->lat [i], sw->lon [i]))
+               continue;
+            newPt.father = isoPt->id;
+            newPt.fatherIndex = k;
+            newPt.amure = sw->amure [i];
+            newPt.sail = sw->sail [i];
+            newPt.motor = motor;
+            newPt.toIndexWp = pDest->toIndexWp;
+            newPt.lat = sw->lat [i];
+            newPt.lon = sw->lon [i];
+            if (sw->vmc [i] > c->bestVmc) c->bestVmc = sw->vmc [i];
+            if (sw->orthoVmc [i] > c->biggestOrthoVmc) c->biggestOrthoVmc = sw->orthoVmc [i];
+
+            if (c->lenNewL < MAX_SIZE_ISOC) {
+               c->newMetric [c->lenNewL] = (PpMetric) {.vmc = sw->vmc [i], .orthoVmc = sw->orthoVmc [i]};
+               c->newList [c->lenNewL++] = newPt;
+            }
+            else {
+               c->lenNewL = -1;
+               return;
+            }
+         }
+         continue;
+      }
       
-      for (double cog = minCog; cog <= maxCog; cog += par.cogStep) {
+      for (double cog = minCog; cog <= maxCog; cog += ctx->par.cogStep) {
          twa = fTwa (cog, twd);
          newPt.amure = (twa > 0.0) ? TRIBORD : BABORD;
          newPt.toIndexWp = pDest->toIndexWp;
 
          if (motor) {
-            sog = par.motorSpeed;
-            newPt.sail = 0;
+            sog = ctx->par.motorSpeed;
+            sail = 0;
          } else {
-            sog = efficiency * findPolar (twa, tws * par.xWind, &polMat, &sailPolMat, &newPt.sail);
+            sog = efficiency * findPolar (twa, tws * ctx->par.xWind, ctx->data.polMat, ctx->data.sailPolMat, &sail);
          }
+         newPt.sail = sail;
          
          newPt.motor = motor;
          waveCorrection = 1.0;
-         if (par.withWaves && (w > 0))
-            waveCorrection = findPolar( twa, w, &wavePolMat, NULL, &bidon) / 100.0;
+         if (ctx->par.withWaves && (w > 0))
+            waveCorrection = findPolar( twa, w, ctx->data.wavePolMat, NULL, &bidon) / 100.0;
 
          sog *= waveCorrection;
          penalty = 0.0;
-         /*if (pId == 8789 || pId ==  16254 || pId == 21507 || pId == 25778) { //ATT
-            printf ("pId: %d, twd: %.2lf, twa: %.2lf, tws: %.2lf, cog: %.2lf, sog: %.2lf\n", pId, twd, twa, tws, cog, sog);
-         }*/
 
          if (!motor) {
             if (newPt.amure != isoPt->amure) {
-               if (fabs (twa) < 90.0) penalty = par.penalty0 / 3600.0;     // Tack
-               else penalty = par.penalty1 / 3600.0;                       // Gybe
+               if (fabs (twa) < 90.0) penalty = ctx->par.penalty0 / 3600.0; // Tack
+               else penalty = ctx->par.penalty1 / 3600.0;                  // Gybe
             }
-            if (newPt.sail != isoList [k].sail)                            // Sail change may bug
-               penalty += par.penalty2 / 3600.0;
+            if (newPt.sail != isoPt->sail)                                 // Sail change may bug
+               penalty += ctx->par.penalty2 / 3600.0;
          }
 
          double realDt = dt - penalty;
@@ -299,41 +464,139 @@ static int buildNextIsochrone (const Pp *pOr, const Pp *pDest, const Pp *isoList
          dLat = sog * (realDt) * cos (DEG_TO_RAD * cog);                   // nautical miles in N S direction
          dLon = sog * (realDt) * sin (DEG_TO_RAD * cog) * invDenominator;  // nautical miles in E W direction
 
-         if (par.withCurrent) {                                            // correction for current
+         if (ctx->par.withCurrent) {                                       // correction for current
             dLat += MS_TO_KN * vCurr * dt;
             dLon += MS_TO_KN * uCurr * dt * invDenominator;
          }
 
          newPt.lat = isoPt->lat + dLat / 60.0;
          newPt.lon = isoPt->lon + dLon / 60.0;
-         newPt.id = pId++;
+         newPt.id = c->nCandidates++;                                      // rebased by buildNextIsochrone
          newPt.father = isoPt->id;
-         newPt.vmc = 0.0;
-         newPt.orthoVmc = 0.0;
-         newPt.sector = 0;
+         newPt.fatherIndex = k;
 
-         if (par.allwaysSea || isSea(tIsSea, newPt.lat, newPt.lon)) {
-            newPt.dd = orthoDist (newPt.lat, newPt.lon, pDest->lat, pDest->lon);
-            double alpha = orthoCap (pOr->lat, pOr->lon, newPt.lat, newPt.lon) - pOrToPDestCog;
+         if (ctx->par.allwaysSea || stepAtSea (ctx, isoPt, newPt.lat, newPt.lon)) {
+            double alpha = orthoCap (pOr->lat, pOr->lon, newPt.lat, newPt.lon) - ctx->pOrToPDestCog;
             double newPtToPorDist = orthoDist (newPt.lat, newPt.lon, pOr->lat, pOr->lon);
-            newPt.vmc = newPtToPorDist * cos(DEG_TO_RAD * alpha);
-            newPt.orthoVmc = newPtToPorDist * fabs(sin (DEG_TO_RAD * alpha));
-            if (newPt.vmc > *bestVmc) *bestVmc = newPt.vmc;
-            if (newPt.orthoVmc > *biggestOrthoVmc) *biggestOrthoVmc = newPt.orthoVmc;
-
-            if (lenNewL < MAX_SIZE_ISOC)
-               newList [lenNewL++] = newPt;                      // new point added to the isochrone
-            else
-               return -1;
+            double vmc = newPtToPorDist * cos(DEG_TO_RAD * alpha);
+            double orthoVmc = newPtToPorDist * fabs(sin (DEG_TO_RAD * alpha));
+            if (vmc > c->bestVmc) c->bestVmc = vmc;
+            if (orthoVmc > c->biggestOrthoVmc) c->biggestOrthoVmc = orthoVmc;
+
+            if (c->lenNewL < MAX_SIZE_ISOC) {
+               c->newMetric [c->lenNewL] = (PpMetric) {.vmc = vmc, .orthoVmc = orthoVmc};
+               c->newList [c->lenNewL++] = newPt;               // new point added to the isochrone
+            }
+            else {
+               c->lenNewL = -1;
+               return;
+            }
+         }
+      }
+   }
+}
+
+/*! task of chunk workers: expand chunk then count it done in its batch */
+static void expandChunkTask (gpointer data, gpointer userData) {
+   (void) userData;
+   IsocChunk *chunk = data;
+   expandChunk (chunk);
+   g_mutex_lock (&chunk->batch->mutex);
+   chunk->batch->pending -= 1;
+   g_cond_signal (&chunk->batch->done);
+   g_mutex_unlock (&chunk->batch->mutex);
+}
+
+/*! make ctx->chunkPool have at least nWorkers threads. Created at first use, kept until routingContextFree
+   so that threads are not created for each isochrone. Return false if no pool */
+static bool chunkPoolReady (RoutingContext *ctx, int nWorkers) {
+   if (ctx->chunkPool == NULL)
+      ctx->chunkPool = g_thread_pool_new (expandChunkTask, NULL, nWorkers, TRUE, NULL);
+   else if (g_thread_pool_get_max_threads (ctx->chunkPool) < nWorkers)
+      g_thread_pool_set_max_threads (ctx->chunkPool, nWorkers, NULL); // on failure fewer workers take all chunks
+   return ctx->chunkPool != NULL;
+}
+
+/*! build the new list describing the next isochrone, starting from isoList 
+   isoList is split in par.nThreads contiguous chunks expanded concurrently by the calling thread
+   and the persistent workers of ctx, then merged in order.
+   Ids are given as if the points were computed serially, so result is identical whatever nThreads
+   returns length of the newlist built or -1 if error*/
+static int buildNextIsochrone (RoutingContext *ctx, const Pp *pOr, const Pp *pDest, const Pp *isoList, int isoLen,
+                               double t, double dt, Pp *newList, PpMetric *newMetric, double *bestVmc, double *biggestOrthoVmc) {
+   IsocChunk chunk [MAX_N_THREADS];
+   ChunkBatch batch = {.pending = 0};
+   int nChunks = MIN (ctx->par.nThreads, isoLen / MIN_PT_PER_THREAD);
+   int lenNewL = 0;
+   if (nChunks < 1) nChunks = 1;
+
+   *bestVmc = 0;
+   *biggestOrthoVmc = 0;
+
+   for (int i = 0; i < nChunks; i++) {
+      if ((i > 0) && (ctx->chunkBuffer [i] == NULL)) {
+         if ((ctx->chunkBuffer [i] = malloc (MAX_SIZE_ISOC * sizeof (Pp))) == NULL) {
+            fprintf (stderr, "In buildNextIsochrone, Error Malloc chunk buffer %d\n", i);
+            return -1;
          }
       }
+      if ((i > 0) && (ctx->chunkMetric [i] == NULL)) {
+         if ((ctx->chunkMetric [i] = malloc (MAX_SIZE_ISOC * sizeof (PpMetric))) == NULL) {
+            fprintf (stderr, "In buildNextIsochrone, Error Malloc chunk metric %d\n", i);
+            return -1;
+         }
+      }
+      chunk [i] = (IsocChunk) {.ctx = ctx, .pOr = pOr, .pDest = pDest, .isoList = isoList, 
+         .kBegin = (int) ((long) isoLen * i / nChunks), .kEnd = (int) ((long) isoLen * (i + 1) / nChunks),
+         .t = t, .dt = dt, .newList = (i == 0) ? newList : ctx->chunkBuffer [i],
+         .newMetric = (i == 0) ? newMetric : ctx->chunkMetric [i]};
+   }
+
+   if ((nChunks > 1) && chunkPoolReady (ctx, nChunks - 1)) {
+      g_mutex_init (&batch.mutex);
+      g_cond_init (&batch.done);
+      batch.pending = nChunks - 1;
+      for (int i = 1; i < nChunks; i++) {
+         chunk [i].batch = &batch;
+         g_thread_pool_push (ctx->chunkPool, &chunk [i], NULL);
+      }
+      expandChunk (&chunk [0]);                          // calling thread takes the first chunk
+      g_mutex_lock (&batch.mutex);
+      while (batch.pending > 0)
+         g_cond_wait (&batch.done, &batch.mutex);
+      g_mutex_unlock (&batch.mutex);
+      g_cond_clear (&batch.done);
+      g_mutex_clear (&batch.mutex);
+   }
+   else {                                                // no worker: same chunks expanded serially, same result
+      for (int i = 0; i < nChunks; i++)
+         expandChunk (&chunk [i]);
+   }
+
+   for (int i = 0; i < nChunks; i++) {                   // merge in isoList order and rebase ids
+      if ((chunk [i].lenNewL < 0) || (lenNewL + chunk [i].lenNewL > MAX_SIZE_ISOC))
+         return -1;
+      for (int j = 0; j < chunk [i].lenNewL; j++) {
+         chunk [i].newList [j].id += ctx->pId;
+         newList [lenNewL + j] = chunk [i].newList [j];   // no copy for chunk 0, already in place
+         newMetric [lenNewL + j] = chunk [i].newMetric [j];
+      }
+      lenNewL += chunk [i].lenNewL;
+      ctx->pId += chunk [i].nCandidates;
+      if (chunk [i].bestVmc > *bestVmc) *bestVmc = chunk [i].bestVmc;
+      if (chunk [i].biggestOrthoVmc > *biggestOrthoVmc) *biggestOrthoVmc = chunk [i].biggestOrthoVmc;
    }
    return lenNewL;
 }
 
-/*! find father of point in previous isochrone */
-static int findFather (int ptId, int i, int lIsoc) {
-    Pp *iso = &isocArray [i * MAX_SIZE_ISOC];  // Access isoc i
+/*! find father of point in previous isochrone 
+    fatherIndex is checked first. Linear search on id is a fallback */
+static int findFather (const RoutingContext *ctx, const Pp *pt, int i, int lIsoc) {
+    const Pp *iso = ctx->isocArray [i];  // Access isoc i
+    int ptId = pt->father;
+
+    if ((pt->fatherIndex >= 0) && (pt->fatherIndex < lIsoc) && (iso [pt->fatherIndex].id == ptId))
+       return pt->fatherIndex;
 
     for (int k = 0; k < lIsoc; k++) {
         if (iso[k].id == ptId) return k;
@@ -379,12 +642,13 @@ bool dumpIsocToFile (const char *fileName) {
       fprintf (stderr, "In dumpAllIsoc, Error cannot write isoc: %s\n", fileName);
       return false;
    }
-   fprintf (f, "  n;  WP;    Lat;    Lon;     Id; Father;  Amure;   Sail;  Motor;     dd;    VMC\n");
+   fprintf (f, "  n;  WP;    Lat;    Lon;     Id; Father;  Amure;   Sail;  Motor;     dd\n");
    for (int i = 0; i < nIsoc; i++) {
       for (int k = 0; k < isoDesc [i].size; k++) {
-         pt = isocArray [i * MAX_SIZE_ISOC + k];
-         fprintf (f, "%03d; %03d; %06.2f; %06.2f; %6d; %6d; %6d; %6d; %6d; %6.2lf; %6.2lf\n",\
-            i, pt.toIndexWp, pt.lat, pt.lon, pt.id, pt.father, pt.amure, pt.sail, pt.motor, pt.dd, pt.vmc);
+         pt = isocArray [i][k];
+         fprintf (f, "%03d; %03d; %06.2f; %06.2f; %6d; %6d; %6d; %6d; %6d; %6.2lf\n",\
+            i, pt.toIndexWp, pt.lat, pt.lon, pt.id, pt.father, pt.amure, pt.sail, pt.motor,
+            orthoDist (pt.lat, pt.lon, par.pDest.lat, par.pDest.lon));
       }
    }
    fprintf (f, "\n");
@@ -392,43 +656,55 @@ bool dumpIsocToFile (const char *fileName) {
    return true;
 }
 
-/*! store current route in history */
-void saveRoute (SailRoute *route) {
+/*! store route in history list */
+static void historyAdd (HistoryRouteList *history, const SailRoute *route) {
    // allocate or rallocate space for routes
-   if (historyRoute.n >= MAX_N_HISTORY) {
+   if (history->n >= MAX_N_HISTORY) {
       fprintf (stderr, "In saveRoute, Error: MAX_N_HISTORY reached: %d\n", MAX_N_HISTORY);
       return;
    }
-   SailRoute *newRoutes = realloc (historyRoute.r, (historyRoute.n + 1) * sizeof(SailRoute));
+   SailRoute *newRoutes = realloc (history->r, (history->n + 1) * sizeof(SailRoute));
    if (newRoutes == NULL) {
       fprintf (stderr, "In saveRoute, Error: Memory allocation failed\n");
       return;
    }
-   historyRoute.r = newRoutes;
-   historyRoute.r[historyRoute.n] = *route; // Copy simple fields witout pointer
+   history->r = newRoutes;
+   history->r[history->n] = *route; // Copy simple fields witout pointer
 
    // Allocation and copy of points
    size_t pointsSize = (route->nIsoc + 1) * sizeof (SailPoint);
-   historyRoute.r[historyRoute.n].t = malloc (pointsSize);
-   if (! historyRoute.r[historyRoute.n].t) {
+   history->r[history->n].t = malloc (pointsSize);
+   if (! history->r[history->n].t) {
       fprintf (stderr, "In saveRoute, Error: Memory allocation for SailPoint array failed\n");
       return;
    }
-   memcpy (historyRoute.r[historyRoute.n].t, route->t, pointsSize); // deep copy of points
+   memcpy (history->r[history->n].t, route->t, pointsSize); // deep copy of points
    
-   historyRoute.n += 1;
+   history->n += 1;
+}
+
+/*! free space for history list */
+static void historyFree (HistoryRouteList *history) {
+   for (int i = 0; i < history->n; i += 1)
+      free (history->r [i].t);
+   free (history->r);
+   history->r = NULL;
+   history->n = 0;
+}
+
+/*! store current route in history */
+void saveRoute (SailRoute *route) {
+   historyAdd (&historyRoute, route);
 }
 
 /*! free space for history route */
 void freeHistoryRoute () {
-   free (historyRoute.r);
-   historyRoute.r = NULL;
-   historyRoute.n = 0;
+   historyFree (&historyRoute);
 }
 
 /*! return the total duration of the route, taking into acount last steps duration */
-static double calcDuration (SailRoute *route) {
-   double duration = (route->n - route->nWayPoints - 1) * par.tStep;
+static double calcDuration (const RoutingContext *ctx, SailRoute *route) {
+   double duration = (route->n - route->nWayPoints - 1) * ctx->par.tStep;
    for (int i = 0; i < route->nWayPoints; i += 1) {
       duration += route->lastStepWpDuration [i];
    }
@@ -437,28 +713,28 @@ static double calcDuration (SailRoute *route) {
 }
 
 /*! add additionnal information to the route */
-static void statRoute (SailRoute *route) {
+static void statRoute (const RoutingContext *ctx, SailRoute *route) {
    bool manoeuvre;
    const double epsilon = 0.00001; // hours
    const double epsilonSog = 0.001; // hours
    Pp p = {0};
    if (route->n == 0) return;
    printf ("route.n = %d\n", route->n);
-   char *polarFileName = g_path_get_basename (par.polarFileName);
+   char *polarFileName = g_path_get_basename (ctx->par.polarFileName);
    g_strlcpy (route->polarFileName, polarFileName, sizeof (route->polarFileName));
    g_free (polarFileName);
-   route->dataDate = zone.dataDate [0]; // save Grib origin
-   route->dataTime = zone.dataTime [0];
+   route->dataDate = ctx->data.zone->dataDate [0]; // save Grib origin
+   route->dataTime = ctx->data.zone->dataTime [0];
    route->nSailChange = 0;
    route->nAmureChange = 0;
-   route->isocTimeStep = par.tStep;
+   route->isocTimeStep = ctx->par.tStep;
    route->totDist = route->motorDist = route->tribordDist = route->babordDist = 0;
    route->maxTws = route->maxGust = route->maxWave = 0;
    route->avrTws = route->avrGust = route->avrWave = 0;
    route->nSailChange = 0;
-   route-> t[0].stamina = par.staminaVR;
+   route-> t[0].stamina = ctx->par.staminaVR;
    route -> t[0].time = 0;
-   double deltaTime = par.tStep;
+   double deltaTime = ctx->par.tStep;
    double sog = 0;
 
    for (int i = 1; i < route->n; i++) {
@@ -473,7 +749,7 @@ static void statRoute (SailRoute *route) {
       }
       else if ((i == route->n - 1) && route->destinationReached)
          deltaTime = route->lastStepDuration;
-      else deltaTime = par.tStep;
+      else deltaTime = ctx->par.tStep;
       
       route->t [i].time = route->t [i-1].time + deltaTime;
 
@@ -514,7 +790,7 @@ static void statRoute (SailRoute *route) {
          else
             route->babordDist += route->t [i-1].od;
       }
-      findWindGrib (p.lat, p.lon, par.startTimeInHours + route->t [i-1].time, 
+      findWindFlow (&ctx->par, ctx->data.zone, ctx->data.windData, p.lat, p.lon, ctx->par.startTimeInHours + route->t [i-1].time, 
                     &route->t [i-1].u, &route->t [i-1].v, &route->t [i-1].g, &route->t [i-1].w, 
                     &route->t [i-1].twd, &route->t [i-1].tws);
 
@@ -545,7 +821,7 @@ static void statRoute (SailRoute *route) {
    }
    p.lat = route->t [route->n - 1].lat;
    p.lon = route->t [route->n - 1].lon;
-   findWindGrib (p.lat, p.lon, par.startTimeInHours + route->t [route->n-1].time, 
+   findWindFlow (&ctx->par, ctx->data.zone, ctx->data.windData, p.lat, p.lon, ctx->par.startTimeInHours + route->t [route->n-1].time, 
                  &route->t [route->n-1].u, &route->t [route->n-1].v, &route->t [route->n-1].g, 
                  &route->t [route->n-1].w, &route->t [route->n-1].twd, &route->t [route->n-1].tws);
    
@@ -567,17 +843,17 @@ static void statRoute (SailRoute *route) {
    route->avrTws /= route->n;
    route->avrGust /= route->n;
    route->avrWave /= route->n;
-   route->duration = calcDuration (route);
+   route->duration = calcDuration (ctx, route);
    route->avrSog = route->totDist / route->duration;
 }
 
 /*! store route 
    response false if error */
-bool storeRoute (SailRoute *route, const Pp *pOr, const Pp *pDest) {
+static bool storeRouteCtx (const RoutingContext *ctx, SailRoute *route, const Pp *pOr, const Pp *pDest) {
    // route->destinationReached = (pDest.id == 0);
    int iFather;
-   route->nIsoc = nIsoc;
-   route->n =  (pDest->id == 0) ? nIsoc + 2 : nIsoc + 1;
+   route->nIsoc = ctx->nIsoc;
+   route->n =  (pDest->id == 0) ? ctx->nIsoc + 2 : ctx->nIsoc + 1;
 
    Pp pt = *pDest;
    Pp ptLast = *pDest;
@@ -593,10 +869,10 @@ bool storeRoute (SailRoute *route, const Pp *pOr, const Pp *pDest) {
    printf ("pDest with id: %d, father: %d, toIndexWp: %d, route.n: %d\n", pDest->id, pDest->father, pDest->toIndexWp, route->n); 
 
    for (int i = route->n - 3; i >= 0; i--) {
-      iFather = findFather (pt.father, i, isoDesc[i].size);
+      iFather = findFather (ctx, &pt, i, ctx->isoDesc[i].size);
       //printf ("ISOC: %d, ID: %d, FATHER: %d, TO_INDEX_WP: %d\n", i, pt.id, pt.father, pt.toIndexWp); 
       if (iFather == -1) return false;
-      pt = isocArray [i * MAX_SIZE_ISOC + iFather];
+      pt = ctx->isocArray [i][iFather];
       if ((pt.toIndexWp < -1) || pt.toIndexWp > route->nWayPoints) {
          printf ("In storeRoute: ERROR isoc: %d pt.toIndexWp: %d\n", i, pt.toIndexWp);
       }
@@ -622,6 +898,12 @@ bool storeRoute (SailRoute *route, const Pp *pOr, const Pp *pDest) {
    return true;
 }
 
+/*! store route from global isochrones */
+bool storeRoute (SailRoute *route, const Pp *pOr, const Pp *pDest) {
+   RoutingContext view = {.isocArray = isocArray, .isoDesc = isoDesc, .nIsoc = nIsoc};
+   return storeRouteCtx (&view, route, pOr, pDest);
+}
+
 /*! produce string that says if Motor, Tribord, Babord */
 static char *motorTribordBabord (bool motor, int amure, char* str, size_t maxLen) {
    if (motor)
@@ -716,7 +998,7 @@ bool routeToStr (const SailRoute *route, char *str, size_t maxLen, char *footer,
 /*! return true if pDest can be reached from pA - in fact segment [pA pB] - in less time than dt
    bestTime give the time to get from pFrom to pDest 
    motor true if goal reached with motor */
-static inline bool goalP (const Pp *pA, const Pp *pB, const Pp *pDest, double t, 
+static inline bool goalP (const RoutingContext *ctx, const Pp *pA, const Pp *pB, const Pp *pDest, double t, 
                           double dt, double *timeTo, double *distance, bool *motor, int *amure, int *sail) {
    double u, v, gust, w, twd, tws, twa, sog, penalty;
    double coeffLat = cos (DEG_TO_RAD * (pB->lat + pDest->lat)/2);
@@ -728,29 +1010,27 @@ static inline bool goalP (const Pp *pA, const Pp *pB, const Pp *pDest, double t,
    double waveCorrection = 1.0;
    int bidon; // useless
    double distToSegment = distSegment (pDest->lat, pDest->lon, pA->lat, pA->lon, pB->lat, pB->lon); 
-   struct tm tm0 = gribDateToTm (zone.dataDate [0], zone.dataTime [0] / 100);
 
    *distance = orthoDist (pDest->lat, pDest->lon, pB->lat, pB->lon);
    
-   findWindGrib (pB->lat, pB->lon, t, &u, &v, &gust, &w, &twd, &tws);
+   findWindSlice (&ctx->windSlice, &ctx->par, ctx->data.zone, ctx->data.windData, pB->lat, pB->lon, t, &u, &v, &gust, &w, &twd, &tws);
    // findCurrentGrib (pFrom->lat, pFrom->lon, t - tDeltaCurrent, &uCurr, &vCurr, &currTwd, &currTws);
    // ATTENTION Courant non pris en compte dans la suite !!!
    twa = fTwa (cog, twd);      // angle of the boat with the wind
    *amure = (twa > 0) ? TRIBORD : BABORD;
-   *motor =  ((maxSpeedInPolarAt (tws * par.xWind, &polMat) < par.threshold) && (par.motorSpeed > 0)); // ATT
+   *motor =  ((maxSpeedInPolarAt (tws * ctx->par.xWind, ctx->data.polMat) < ctx->par.threshold) && (ctx->par.motorSpeed > 0)); // ATT
    // printf ("maxSpeedinPolar: %.2lf\n", maxSpeedInPolarAt (tws, &polMat));
-   struct tm localTm = tm0; // working on local copy improve performances
-   double efficiency = (isDayLight (&localTm, t, pB->lat, pB->lon)) ? par.dayEfficiency : par.nightEfficiency;
+   double efficiency = (isDayLightFast (&ctx->dayLight, t, pB->lat, pB->lon)) ? ctx->par.dayEfficiency : ctx->par.nightEfficiency;
 
    if (*motor) {
-      sog = par.motorSpeed;
+      sog = ctx->par.motorSpeed;
       *sail = 0;
    }
    else {
-      sog = efficiency * findPolar (twa, tws * par.xWind, &polMat, &sailPolMat, sail);
+      sog = efficiency * findPolar (twa, tws * ctx->par.xWind, ctx->data.polMat, ctx->data.sailPolMat, sail);
    } 
 
-   if (par.withWaves && (w > 0) && ((waveCorrection = findPolar (twa, w, &wavePolMat, NULL, &bidon)) > 0)) { 
+   if (ctx->par.withWaves && (w > 0) && ((waveCorrection = findPolar (twa, w, ctx->data.wavePolMat, NULL, &bidon)) > 0)) { 
       sog = sog * (waveCorrection / 100.0);
    }
    if (sog > epsilon)
@@ -763,11 +1043,11 @@ static inline bool goalP (const Pp *pA, const Pp *pB, const Pp *pDest, double t,
    // printf ("distance: %.2lf, twd: %.2lf, twa : %.2lf, tws: %.2lf, cog: %.2lf, sog:%.2lf, timeTo:%.2lf \n", *distance, twd, twa, tws, cog, sog, *timeTo);
    if (! *motor) {
       if (pDest->amure != pB->amure) {                         // changement amure
-         if (fabs (twa) < 90) penalty = par.penalty0 / 3600.0; // Tack
-         else penalty = par.penalty1 / 3600.0;                 // Gybe
+         if (fabs (twa) < 90) penalty = ctx->par.penalty0 / 3600.0; // Tack
+         else penalty = ctx->par.penalty1 / 3600.0;                 // Gybe
       }
       if (pDest->sail != pB->sail)                             // Sail change may bug
-         penalty += par.penalty2 / 3600.0;                      
+         penalty += ctx->par.penalty2 / 3600.0;                      
    }
    else penalty = 0.0;
    double realDt = dt - penalty;
@@ -781,7 +1061,7 @@ static inline bool goalP (const Pp *pA, const Pp *pB, const Pp *pDest, double t,
 /*! true if goal can be reached directly in dt from isochrone 
   update isoDesc
   side effect : pDest.father can be modified ! */
-static inline bool goal (Pp *pDest, const Pp *isoList, int len, double t, double dt,
+static inline bool goal (const RoutingContext *ctx, Pp *pDest, const Pp *isoList, int len, double t, double dt,
                         double *lastStepDuration, bool *motor, int *amure) {
    double bestTime = DBL_MAX;
    double time, distance;
@@ -793,8 +1073,8 @@ static inline bool goal (Pp *pDest, const Pp *isoList, int len, double t, double
    for (int k = 1; k < len; k++) {
       const Pp *curr = &isoList[k];
 
-      if (par.allwaysSea || isSea(tIsSea, curr->lat, curr->lon)) {
-         if (goalP (prev, curr, pDest, t, dt, &time, &distance, motor, amure, &sail)) {
+      if (ctx->par.allwaysSea || isSea(ctx->data.tIsSea, curr->lat, curr->lon)) {
+         if (goalP (ctx, prev, curr, pDest, t, dt, &time, &distance, motor, amure, &sail)) {
             destinationReached = true;
          }
 
@@ -802,6 +1082,7 @@ static inline bool goal (Pp *pDest, const Pp *isoList, int len, double t, double
            bestTime = time;
            if (destinationReached) {
               pDest->father = curr->id; // ATTENTION !!!! prev or curr ? curr better.
+              pDest->fatherIndex = k;
               pDest->motor = *motor;
               pDest->amure = *amure;
               pDest->sail = sail;
@@ -839,41 +1120,125 @@ static int fClosest (const Pp *isoc, int n, const Pp *pDest, Pp *closest) {
    return index;
 }
 
+/*! forget all points stored in arena. Blocks are kept for next routing */
+static void arenaReset (IsocArena *arena) {
+   arena->current = 0;
+   arena->used = 0;
+   arena->nPoints = 0;
+}
+
+/*! return space for n contiguous points in arena, NULL if allocation failed */
+static Pp *arenaAlloc (IsocArena *arena, size_t n) {
+   while (arena->current < arena->nBlock) {
+      if (arena->used + n <= arena->capacity [arena->current]) {
+         Pp *p = arena->block [arena->current] + arena->used;
+         arena->used += n;
+         arena->nPoints += n;
+         return p;
+      }
+      arena->current += 1;
+      arena->used = 0;
+   }
+   if (arena->nBlock >= MAX_N_ARENA_BLOCK) {
+      fprintf (stderr, "In arenaAlloc, Error: MAX_N_ARENA_BLOCK reached: %d\n", MAX_N_ARENA_BLOCK);
+      return NULL;
+   }
+   size_t capacity = (arena->nBlock == 0) ? ARENA_MIN_BLOCK : 2 * arena->capacity [arena->nBlock - 1];
+   capacity = MAX (capacity, n);
+   if ((arena->block [arena->nBlock] = malloc (capacity * sizeof (Pp))) == NULL) {
+      fprintf (stderr, "In arenaAlloc, Error: memory allocation of %zu points failed\n", capacity);
+      return NULL;
+   }
+   arena->capacity [arena->nBlock] = capacity;
+   arena->current = arena->nBlock;
+   arena->nBlock += 1;
+   arena->used = n;
+   arena->nPoints += n;
+   return arena->block [arena->current];
+}
+
+/*! free all blocks of arena */
+static void arenaFree (IsocArena *arena) {
+   for (int i = 0; i < arena->nBlock; i += 1)
+      free (arena->block [i]);
+   memset (arena, 0, sizeof (IsocArena));
+}
+
+/*! store isochrone n with size points copied from list, at exact size. 
+    Return false if allocation failed */
+static bool isocStore (RoutingContext *ctx, int n, const Pp *list, int size) {
+   Pp *dst = arenaAlloc (&ctx->arena, size);
+   if (dst == NULL) return false;
+   memcpy (dst, list, size * sizeof (Pp));
+   ctx->isocArray [n] = dst;
+   ctx->isoDesc [n].size = size;
+   return true;
+}
+
 /*! when no wind, build next isochrone as a replica of previous isochrone 
     Manage carefully id and father fields */
-static void replicate(int n) {
-    if (n <= 0) return;
+static bool replicate(RoutingContext *ctx, int n) {
+    if (n <= 0) return true;
 
-    int len = isoDesc[n - 1].size;
-    Pp *src = &isocArray[(n - 1) * MAX_SIZE_ISOC];
-    Pp *dst = &isocArray[n * MAX_SIZE_ISOC];
-
-    memcpy(dst, src, len * sizeof(Pp));  // copy isochrone n - 1 to isochrone n
+    int len = ctx->isoDesc[n - 1].size;
+    Pp *src = ctx->isocArray[n - 1];
+    if (! isocStore (ctx, n, src, len))  // copy isochrone n - 1 to isochrone n
+       return false;
+    Pp *dst = ctx->isocArray[n];
 
     for (int i = 0; i < len; i++) {
         int idSrc = src [i].id;    // Be careful to specific id and father fields
         dst[i].id = idSrc + len;
         dst[i].father = idSrc;
+        dst[i].fatherIndex = i;
     }
-    isoDesc[n] = isoDesc[n - 1];
+    ctx->isoDesc[n] = ctx->isoDesc[n - 1];
+    return true;
+}
+
+/*! build wind and current slices at time t for the box around isoList points, 
+   so that lookups of goal and buildNextIsochrone at time t do only spatial interpolation */
+static void flowSlicesBuild (RoutingContext *ctx, const Pp *isoList, int isoLen, double t) {
+   double latMin = DBL_MAX, latMax = -DBL_MAX, lonMin = DBL_MAX, lonMax = -DBL_MAX;
+   for (int k = 0; k < isoLen; k++) {
+      latMin = MIN (latMin, isoList [k].lat);
+      latMax = MAX (latMax, isoList [k].lat);
+      lonMin = MIN (lonMin, isoList [k].lon);
+      lonMax = MAX (lonMax, isoList [k].lon);
+   }
+   if (ctx->par.constWindTws == 0)
+      flowSliceBuild (&ctx->windSlice, ctx->data.zone, ctx->data.windData, t, latMin, latMax, lonMin, lonMax);
+   if (ctx->par.withCurrent && (ctx->par.constCurrentS == 0))
+      flowSliceBuild (&ctx->currentSlice, ctx->data.currentZone, ctx->data.currentData, t - ctx->tDeltaCurrent, latMin, latMax, lonMin, lonMax);
 }
 
+/*! true if last isochrone reached after elapsed hours cannot lead to a duration below ctx->pruneDuration.
+   Remaining time bound is orthodromic distance to final destination at ctx->pruneSpeed */
+static bool routingHopeless (const RoutingContext *ctx, double elapsed) {
+   if ((ctx->pruneDuration <= 0) || (ctx->pruneSpeed <= 0)) return false;
+   if (elapsed > ctx->pruneDuration) return true;
+   const Pp *isoc = ctx->isocArray [ctx->nIsoc - 1];
+   double minDist = DBL_MAX;
+   for (int k = 0; k < ctx->isoDesc [ctx->nIsoc - 1].size; k++)
+      minDist = MIN (minDist, orthoDist (isoc [k].lat, isoc [k].lon, ctx->par.pDest.lat, ctx->par.pDest.lon));
+   return elapsed + minDist / ctx->pruneSpeed > ctx->pruneDuration;
+}
 
 /*! find optimal routing from p0 to pDest using grib file and polar
     return number of steps to reach pDest, NIL if unreached, -1 if problem, -2 if stopped by user, 
-    0 reserved for not terminated
+    -3 if pruned (see routingHopeless), 0 reserved for not terminated
     return also lastStepDuration if destination reached (0 if unreached) 
-    side effects: nIsoc, maxNIsoc, pOrToPDestCog, isoDesc, isocArray, route
+    side effects: nIsoc, maxNIsoc, pOrToPDestCog, isoDesc, isocArray, route of ctx
     pOr and pDest modified
 */
-static int routing (Pp *pOr, Pp *pDest, int toIndexWp, double t, double dt, double *lastStepDuration) {
+static int routing (RoutingContext *ctx, Pp *pOr, Pp *pDest, int toIndexWp, double t, double dt, double *lastStepDuration) {
    bool motor = false;
    int amure, sail = 0;
    double distance;
    double timeToReach = 0;
    int lTempList = 0;
    double timeLastStep;
-   Pp *tempList = NULL;             // one dimension array of points
+   int size;
    
    const double minStep = 0.25;
 
@@ -882,322 +1247,852 @@ static int routing (Pp *pOr, Pp *pDest, int toIndexWp, double t, double dt, doub
       return -1;
    }
 
-   if ((tempList = malloc (MAX_SIZE_ISOC * sizeof(Pp))) == NULL) {
+   // working lists are kept in context and reused by next routing
+   if ((ctx->tempList == NULL) && ((ctx->tempList = malloc (MAX_SIZE_ISOC * sizeof(Pp))) == NULL)) {
       fprintf (stderr, "in routing: error in memory templIst allocation\n");
       return -1;
    }
+   if ((ctx->tempMetric == NULL) && ((ctx->tempMetric = malloc (MAX_SIZE_ISOC * sizeof(PpMetric))) == NULL)) {
+      fprintf (stderr, "in routing: error in memory tempMetric allocation\n");
+      return -1;
+   }
+   if ((ctx->optList == NULL) && ((ctx->optList = malloc ((MAX_SIZE_ISOC + 1) * sizeof(Pp))) == NULL)) {
+      fprintf (stderr, "in routing: error in memory optList allocation\n");
+      return -1;
+   }
+   Pp *tempList = ctx->tempList;    // one dimension array of points
+   PpMetric *tempMetric = ctx->tempMetric;
+   Pp *optList = ctx->optList;      // optimized isochrone before storage at exact size
 
-   maxNIsoc = (int) ((1 + zone.timeStamp [zone.nTimeStamp - 1]) / dt);
-   if (maxNIsoc > MAX_N_ISOC) {
+   ctx->maxNIsoc = (int) ((1 + ctx->data.zone->timeStamp [ctx->data.zone->nTimeStamp - 1]) / dt);
+   if (ctx->maxNIsoc > MAX_N_ISOC) {
       fprintf (stderr, "in routing maxNIsoc exeed MAX_N_ISOC\n");
-      free (tempList);
       return -1;
    } 
 
-   Pp *tempIsocArray = (Pp*) realloc (isocArray, maxNIsoc * MAX_SIZE_ISOC * sizeof(Pp));
-   if (tempIsocArray == NULL) {
-      fprintf (stderr, "in routing: realloc error for isocArray\n");
-      free (tempList);
-      return -1;
+   // descriptors only grow. Points are in arena so pOr may point into an isochrone for way points
+   if (ctx->maxNIsoc > ctx->nIsocAlloc) {
+      Pp **tempIsocArray = (Pp **) realloc (ctx->isocArray, ctx->maxNIsoc * sizeof(Pp *));
+      if (tempIsocArray == NULL) {
+         fprintf (stderr, "in routing: realloc error for isocArray\n");
+         return -1;
+      }
+      ctx->isocArray = tempIsocArray;
+      
+      IsoDesc *tempIsoDesc = (IsoDesc *) realloc (ctx->isoDesc, ctx->maxNIsoc * sizeof (IsoDesc));
+      if (tempIsoDesc == NULL) {
+         fprintf (stderr, "in routing: realloc for IsoDesc failed\n");
+         return -1;
+      } 
+      ctx->isoDesc = tempIsoDesc;
+       
+      SailPoint *tempSailPoint = (SailPoint *) realloc (ctx->route.t, (ctx->maxNIsoc + 1) * sizeof(SailPoint));
+      if (tempSailPoint  == NULL) {
+         fprintf (stderr, "in routing: realloc for route.t failed\n");
+         return -1;
+      } 
+      ctx->route.t = tempSailPoint;
+      ctx->nIsocAlloc = ctx->maxNIsoc;
    }
-   isocArray = tempIsocArray;
-   
-   IsoDesc *tempIsoDesc = (IsoDesc *) realloc (isoDesc, maxNIsoc * sizeof (IsoDesc));
-   if (tempIsoDesc == NULL) {
-      fprintf (stderr, "in routing: realloc for IsoDesc failed\n");
-      free (isocArray);
-      free (tempList);
-      return -1;
-   } 
-   isoDesc = tempIsoDesc;
-    
-   SailPoint *tempSailPoint = (SailPoint *) realloc (route.t, (maxNIsoc + 1) * sizeof(SailPoint));
-   if (tempSailPoint  == NULL) {
-      fprintf (stderr, "in routing: realloc for route.t failed\n");
-      free (isoDesc);
-      free (isocArray);
-      free (tempList);
-      return -1;
-   } 
-   route.t = tempSailPoint;
 
-   pOr->dd = orthoDist (pOr->lat, pOr->lon, pDest->lat, pDest->lon);
-   pOr->vmc = 0;
    //pOrToPDestCog = orthoCap (pOr->lat, pOr->lon, pDest->lat, pDest->lon);
-   pOrToPDestCog = directCap (pOr->lat, pOr->lon, pDest->lat, pDest->lon); // better
+   ctx->pOrToPDestCog = directCap (pOr->lat, pOr->lon, pDest->lat, pDest->lon); // better
    pDest->toIndexWp = toIndexWp;
    tempList [0] = *pOr;             // list with just one element;
-   initSector (nIsoc % 2, par.nSectors); 
+   initSector (ctx, ctx->nIsoc % 2, ctx->par.nSectors); 
+   flowSlicesBuild (ctx, pOr, 1, t);
 
-   if (goalP (pOr, pOr, pDest, t, dt, &timeToReach, &distance, &motor, &amure, &sail)) {
+   if (goalP (ctx, pOr, pOr, pDest, t, dt, &timeToReach, &distance, &motor, &amure, &sail)) {
       pDest->father = pOr->id;
+      pDest->fatherIndex = 0;    // pOr is par.pOr or first point of way point isochrone
       pDest->motor = motor;
       pDest->amure = amure;
       pDest->sail = sail;
       *lastStepDuration = timeToReach;
-      free (tempList);
       printf ("destination reached directly. No isochrone\n");
-      return nIsoc + 1;
+      if (! isocStore (ctx, ctx->nIsoc, pOr, 1)) // place for way point
+         return -1;
+      return ctx->nIsoc + 1;
    }
-   isoDesc [nIsoc].size = buildNextIsochrone (pOr, pDest, tempList, 1, t, dt, 
-                          &isocArray [nIsoc * MAX_SIZE_ISOC], &isoDesc [nIsoc].bestVmc, &isoDesc [nIsoc].biggestOrthoVmc);
+   size = buildNextIsochrone (ctx, pOr, pDest, tempList, 1, t, dt, 
+                          optList, tempMetric, &ctx->isoDesc [ctx->nIsoc].bestVmc, &ctx->isoDesc [ctx->nIsoc].biggestOrthoVmc);
 
-   if (isoDesc [nIsoc].size == -1) {
-      free (tempList);
+   if (size == -1) {
       return -1;
    }
+   if (size == 0) { // no wind at the beginning. 
+      size = 1;
+      optList [0] = *pOr;
+   }
+   if (! isocStore (ctx, ctx->nIsoc, optList, size))
+      return -1;
    // printf ("%-20s%d, %d\n", "Isochrone no, len: ", 0, isoDesc [0].size);
    // keep track of closest point in isochrone
-   isoDesc [nIsoc].first = 0;
-   isoDesc [nIsoc].closest = fClosest (&isocArray [nIsoc * MAX_SIZE_ISOC], isoDesc[nIsoc].size, pDest, &lastClosest); 
-   isoDesc [nIsoc].toIndexWp = toIndexWp; 
-   isoDesc [nIsoc].focalLat = pOr->lat;
-   isoDesc [nIsoc].focalLon = pOr->lon;
-   if (isoDesc [nIsoc].size == 0) { // no wind at the beginning. 
-      isoDesc [nIsoc].size = 1;
-      isocArray [nIsoc * MAX_SIZE_ISOC + 0] = *pOr;
-   }
+   ctx->isoDesc [ctx->nIsoc].first = 0;
+   ctx->isoDesc [ctx->nIsoc].closest = fClosest (ctx->isocArray [ctx->nIsoc], ctx->isoDesc[ctx->nIsoc].size, pDest, &ctx->lastClosest); 
+   ctx->isoDesc [ctx->nIsoc].toIndexWp = toIndexWp; 
+   ctx->isoDesc [ctx->nIsoc].focalLat = pOr->lat;
+   ctx->isoDesc [ctx->nIsoc].focalLon = pOr->lon;
    
-   nIsoc += 1;
+   ctx->nIsoc += 1;
+   if (ctx->progress) ctx->progress (ctx);
    //printf ("Routing t = %.2lf, zone: %.2ld\n", t, zone.timeStamp [zone.nTimeStamp-1]);
-   while (t < (zone.timeStamp [zone.nTimeStamp - 1]/* + par.tStep*/) && (nIsoc < maxNIsoc)) { // ATT
-      if (g_atomic_int_get (&route.ret) == ROUTING_STOPPED) { // -2
-         free (tempList);
+   while (t < (ctx->data.zone->timeStamp [ctx->data.zone->nTimeStamp - 1]/* + par.tStep*/) && (ctx->nIsoc < ctx->maxNIsoc)) { // ATT
+      if (g_atomic_int_get (&ctx->route.ret) == ROUTING_STOPPED) { // -2
          return ROUTING_STOPPED; // stopped by user in another thread !!!
       }
       t += dt;
+      flowSlicesBuild (ctx, ctx->isocArray [ctx->nIsoc - 1], ctx->isoDesc[ctx->nIsoc - 1].size, t);
       // printf ("nIsoc = %d\n", nIsoc);
-      if (goal (pDest, &isocArray [(nIsoc - 1) * MAX_SIZE_ISOC], 
-                isoDesc[nIsoc - 1].size, t, dt, &timeLastStep, &motor, &amure)) {
+      if (goal (ctx, pDest, ctx->isocArray [ctx->nIsoc - 1], 
+                ctx->isoDesc[ctx->nIsoc - 1].size, t, dt, &timeLastStep, &motor, &amure)) {
 
-         isoDesc [nIsoc].size = optimize (pOr, pDest, nIsoc, par.opt, tempList, lTempList, &isocArray [nIsoc * MAX_SIZE_ISOC]);
-         if (isoDesc [nIsoc].size == 0) { // no Wind ... we copy
-            fprintf (stderr, "In routing, goal reached but no wind at isoc: %d\n", nIsoc);
-            replicate (nIsoc);
+         size = optimize (ctx, pOr, pDest, ctx->nIsoc, ctx->par.opt, tempList, tempMetric, lTempList, optList);
+         if (size == 0) { // no Wind ... we copy
+            fprintf (stderr, "In routing, goal reached but no wind at isoc: %d\n", ctx->nIsoc);
+            if (! replicate (ctx, ctx->nIsoc))
+               return -1;
          }
-         isoDesc [nIsoc].first = findFirst (nIsoc);
-         isoDesc [nIsoc].closest = fClosest (&isocArray [nIsoc * MAX_SIZE_ISOC], isoDesc[nIsoc].size, pDest, &lastClosest); 
-         isoDesc [nIsoc].toIndexWp = toIndexWp; 
+         else if (! isocStore (ctx, ctx->nIsoc, optList, size))
+            return -1;
+         ctx->isoDesc [ctx->nIsoc].first = findFirst (ctx, ctx->nIsoc);
+         ctx->isoDesc [ctx->nIsoc].closest = fClosest (ctx->isocArray [ctx->nIsoc], ctx->isoDesc[ctx->nIsoc].size, pDest, &ctx->lastClosest); 
+         ctx->isoDesc [ctx->nIsoc].toIndexWp = toIndexWp; 
          *lastStepDuration = timeLastStep;
-         printf ("In routing, Destination reached to WP %d for %s\n", toIndexWp, competitors.t [competitors.runIndex].name);
+         printf ("In routing, Destination reached to WP %d for %s\n", toIndexWp, ctx->competitors.t [ctx->competitors.runIndex].name);
          printf ("pDest.id: %d, pDest.father: %d, pDest.toIndexWP: %d\n", pDest->id, pDest->father, pDest->toIndexWp);
-         free (tempList);
-         return nIsoc + 1;
+         return ctx->nIsoc + 1;
       }
-      lTempList = buildNextIsochrone (pOr, pDest, &isocArray [(nIsoc -1) * MAX_SIZE_ISOC], 
-                                      isoDesc [nIsoc - 1].size, t, dt, tempList, &isoDesc [nIsoc].bestVmc,  &isoDesc [nIsoc].biggestOrthoVmc);
+      lTempList = buildNextIsochrone (ctx, pOr, pDest, ctx->isocArray [ctx->nIsoc - 1], 
+                                      ctx->isoDesc [ctx->nIsoc - 1].size, t, dt, tempList, tempMetric, &ctx->isoDesc [ctx->nIsoc].bestVmc,  &ctx->isoDesc [ctx->nIsoc].biggestOrthoVmc);
       if (lTempList == -1) {
-         free (tempList);
          fprintf (stderr, "In routing: buildNextIsochrone return: -1 value\n");
          return -1;
       }
-      isoDesc [nIsoc].size = optimize (pOr, pDest, nIsoc, par.opt, tempList, lTempList, &isocArray [nIsoc * MAX_SIZE_ISOC]);
-      if (isoDesc [nIsoc].size == 0) { // no Wind ... we copy
-         fprintf (stderr, "In routing, no wind at isoc: %d\n", nIsoc);
-         replicate (nIsoc);
+      size = optimize (ctx, pOr, pDest, ctx->nIsoc, ctx->par.opt, tempList, tempMetric, lTempList, optList);
+      if (size == 0) { // no Wind ... we copy
+         fprintf (stderr, "In routing, no wind at isoc: %d\n", ctx->nIsoc);
+         if (! replicate (ctx, ctx->nIsoc))
+            return -1;
       }
-      isoDesc [nIsoc].first = findFirst (nIsoc);; 
-      isoDesc [nIsoc].closest = fClosest (&isocArray [nIsoc * MAX_SIZE_ISOC], isoDesc[nIsoc].size, pDest, &lastClosest); 
-      isoDesc [nIsoc].toIndexWp = toIndexWp; 
+      else if (! isocStore (ctx, ctx->nIsoc, optList, size))
+         return -1;
+      ctx->isoDesc [ctx->nIsoc].first = findFirst (ctx, ctx->nIsoc);
+      ctx->isoDesc [ctx->nIsoc].closest = fClosest (ctx->isocArray [ctx->nIsoc], ctx->isoDesc[ctx->nIsoc].size, pDest, &ctx->lastClosest); 
+      ctx->isoDesc [ctx->nIsoc].toIndexWp = toIndexWp; 
       // printf ("Isoc: %d Biglist length: %d optimized size: %d\n", nIsoc, lTempList, isoDesc [nIsoc].size);
-      nIsoc += 1;
+      ctx->nIsoc += 1;
+      if (ctx->progress) ctx->progress (ctx);
+      if (routingHopeless (ctx, t + dt - ctx->par.startTimeInHours))
+         return ROUTING_PRUNED;
    }
    *lastStepDuration = 0.0;
-   free (tempList);
    return NIL;
 }
 
-/*! global variable initialization for routing */
-static void initRouting (void) { 
-   isocArray = NULL;
-   isoDesc = NULL;
-   maxNIsoc = 0;
-   nIsoc = 0;
-   pOrToPDestCog = 0;
-   memset (sector, 0, sizeof(sector));
-   lastClosest = par.pOr;
-   tDeltaCurrent = zoneTimeDiff (&currentZone, &zone); // global variable
-   par.pOr.id = -1;
-   par.pOr.father = -1;
-   par.pDest.id = 0;
-   par.pDest.father = 0;
-   pId = 1;
-   memset (&route, 0, sizeof (SailRoute));
-   g_atomic_int_set (&route.ret, ROUTING_RUNNING);
-   route.destinationReached = false;
+/*! context initialization for routing. isocArray, isoDesc, arena and route.t buffers are kept for reuse */
+static void initRouting (RoutingContext *ctx) { 
+   SailPoint *routePoints = ctx->route.t;
+   arenaReset (&ctx->arena);
+   ctx->maxNIsoc = 0;
+   ctx->nIsoc = 0;
+   ctx->pOrToPDestCog = 0;
+   memset (ctx->sector, 0, sizeof(ctx->sector));
+   ctx->lastClosest = ctx->par.pOr;
+   ctx->tDeltaCurrent = zoneTimeDiff (ctx->data.currentZone, ctx->data.zone);
+   ctx->windSlice.valid = false;     // grib data may have changed since last routing
+   ctx->currentSlice.valid = false;
+   if (ctx->data.zone->nTimeStamp > 0)
+      dayLightBuild (&ctx->dayLight, ctx->data.zone->dataDate [0], ctx->data.zone->dataTime [0], 
+         MAX (ctx->data.zone->timeStamp [ctx->data.zone->nTimeStamp - 1], ctx->par.startTimeInHours));
+   ctx->par.pOr.id = -1;
+   ctx->par.pOr.father = -1;
+   ctx->par.pDest.id = 0;
+   ctx->par.pDest.father = 0;
+   ctx->pId = 1;
+   memset (&ctx->route, 0, sizeof (SailRoute));
+   ctx->route.t = routePoints;
+   g_atomic_int_set (&ctx->route.ret, ROUTING_RUNNING);
+   ctx->route.destinationReached = false;
 }
 
-/*! launch routing wih parameters */
-void *routingLaunch () {
+/*! launch routing wih parameters of ctx */
+void routingRun (RoutingContext *ctx) {
    struct timeval t0, t1;
    long ut0, ut1;
    double lastStepDuration;
    Pp pNext;
-   initRouting ();
-   route.competitorIndex = competitors.runIndex;
-   printf ("In routingLaunch: competitor index: %d, name: %s\n", competitors.runIndex, competitors.t[competitors.runIndex].name);
+   initRouting (ctx);
+   ctx->route.competitorIndex = ctx->competitors.runIndex;
+   printf ("In routingLaunch: competitor index: %d, name: %s\n", ctx->competitors.runIndex, ctx->competitors.t[ctx->competitors.runIndex].name);
    int ret = -1;
 
    gettimeofday (&t0, NULL);
    ut0 = t0.tv_sec * MILLION + t0.tv_usec;
-   double wayPointStartTime = par.startTimeInHours;
+   double wayPointStartTime = ctx->par.startTimeInHours;
 
    //Launch routing
-   if (wayPoints.n == 0) {
-      printf ("Before Routing, pDest ID: %d, Father: %d\n", par.pDest.id, par.pDest.father);
-      ret = routing (&par.pOr, &par.pDest, -1, wayPointStartTime, par.tStep, &lastStepDuration);
-      printf ("After Routing, pDest ID: %d, Father: %d\n", par.pDest.id, par.pDest.father);
+   if (ctx->wayPoints.n == 0) {
+      printf ("Before Routing, pDest ID: %d, Father: %d\n", ctx->par.pDest.id, ctx->par.pDest.father);
+      ret = routing (ctx, &ctx->par.pOr, &ctx->par.pDest, -1, wayPointStartTime, ctx->par.tStep, &lastStepDuration);
+      printf ("After Routing, pDest ID: %d, Father: %d\n", ctx->par.pDest.id, ctx->par.pDest.father);
    }
    else {
-      for (int i = 0; i < wayPoints.n; i ++) {
-         pNext.lat = wayPoints.t[i].lat;
-         pNext.lon = wayPoints.t[i].lon;
+      for (int i = 0; i < ctx->wayPoints.n; i ++) {
+         pNext.lat = ctx->wayPoints.t[i].lat;
+         pNext.lon = ctx->wayPoints.t[i].lon;
          pNext.id = -2 - i;
          if (i == 0) {
-            ret = routing (&par.pOr, &pNext, i, wayPointStartTime, par.tStep, &lastStepDuration);
+            ret = routing (ctx, &ctx->par.pOr, &pNext, i, wayPointStartTime, ctx->par.tStep, &lastStepDuration);
          }
          else {
-            ret = routing (&isocArray [(nIsoc-1) * MAX_SIZE_ISOC + 0], &pNext, i, wayPointStartTime, par.tStep, &lastStepDuration);
+            ret = routing (ctx, &ctx->isocArray [ctx->nIsoc-1][0], &pNext, i, wayPointStartTime, ctx->par.tStep, &lastStepDuration);
          }
-         route.lastStepWpDuration [i] = lastStepDuration;
+         ctx->route.lastStepWpDuration [i] = lastStepDuration;
          if (ret > 0) {
-            wayPointStartTime = par.startTimeInHours + (nIsoc * par.tStep) + lastStepDuration;
-            isocArray [nIsoc * MAX_SIZE_ISOC + 0].lat = wayPoints.t[i].lat;
-            isocArray [nIsoc * MAX_SIZE_ISOC + 0].lon = wayPoints.t[i].lon;
-            isocArray [nIsoc * MAX_SIZE_ISOC + 0].father = pNext.father;
-            isocArray [nIsoc * MAX_SIZE_ISOC + 0].id = pId++;
-            isoDesc [nIsoc].size = 1;
-            isoDesc [nIsoc].toIndexWp = (i < (wayPoints.n - 1)) ? i + 1 : -1;
-            isoDesc [nIsoc].first = isoDesc [nIsoc].closest = 0;
-            isoDesc [nIsoc].bestVmc = isoDesc [nIsoc].biggestOrthoVmc = 0.0;
-            isoDesc [nIsoc].focalLat = wayPoints.t[i].lat;
-            isoDesc [nIsoc].focalLon = wayPoints.t[i].lon;
-            nIsoc += 1;
+            wayPointStartTime = ctx->par.startTimeInHours + (ctx->nIsoc * ctx->par.tStep) + lastStepDuration;
+            ctx->isocArray [ctx->nIsoc][0].lat = ctx->wayPoints.t[i].lat;
+            ctx->isocArray [ctx->nIsoc][0].lon = ctx->wayPoints.t[i].lon;
+            ctx->isocArray [ctx->nIsoc][0].father = pNext.father;
+            ctx->isocArray [ctx->nIsoc][0].fatherIndex = pNext.fatherIndex;
+            ctx->isocArray [ctx->nIsoc][0].id = ctx->pId++;
+            ctx->isoDesc [ctx->nIsoc].size = 1;
+            ctx->isoDesc [ctx->nIsoc].toIndexWp = (i < (ctx->wayPoints.n - 1)) ? i + 1 : -1;
+            ctx->isoDesc [ctx->nIsoc].first = ctx->isoDesc [ctx->nIsoc].closest = 0;
+            ctx->isoDesc [ctx->nIsoc].bestVmc = ctx->isoDesc [ctx->nIsoc].biggestOrthoVmc = 0.0;
+            ctx->isoDesc [ctx->nIsoc].focalLat = ctx->wayPoints.t[i].lat;
+            ctx->isoDesc [ctx->nIsoc].focalLon = ctx->wayPoints.t[i].lon;
+            ctx->nIsoc += 1;
          }
          else break;
       }
       if (ret > 0) {
-         ret = routing (&isocArray [(nIsoc-1) * MAX_SIZE_ISOC + 0], &par.pDest, -1, wayPointStartTime, par.tStep, &lastStepDuration);
+         ret = routing (ctx, &ctx->isocArray [ctx->nIsoc-1][0], &ctx->par.pDest, -1, wayPointStartTime, ctx->par.tStep, &lastStepDuration);
       } 
    }
    if (ret == -1) {
-      g_atomic_int_set (&route.ret, ROUTING_ERROR); // -1
-      return NULL;
+      g_atomic_int_set (&ctx->route.ret, ROUTING_ERROR); // -1
+      return;
+   }
+   if (ret == ROUTING_PRUNED) {
+      g_atomic_int_set (&ctx->route.ret, ROUTING_PRUNED); // -3
+      return;
    }
-   route.lastStepDuration = lastStepDuration;
-   route.nWayPoints = wayPoints.n;
-   printf ("Number of wayPoints: %d\n", wayPoints.n);
+   ctx->route.lastStepDuration = lastStepDuration;
+   ctx->route.nWayPoints = ctx->wayPoints.n;
+   printf ("Number of wayPoints: %d\n", ctx->wayPoints.n);
 
    gettimeofday (&t1, NULL);
    ut1 = t1.tv_sec * MILLION + t1.tv_usec;
-   route.calculationTime = (double) ((ut1-ut0)/ 1000000.0); // in seconds
-   route.destinationReached = (ret > 0 && par.pDest.father != 0);
-   if (storeRoute (&route, &par.pOr, (route.destinationReached) ? &par.pDest : &lastClosest))
+   ctx->route.calculationTime = (double) ((ut1-ut0)/ 1000000.0); // in seconds
+   ctx->route.isocMemory = ctx->arena.nPoints * sizeof (Pp) + ctx->nIsoc * (sizeof (Pp *) + sizeof (IsoDesc));
+   ctx->route.destinationReached = (ret > 0 && ctx->par.pDest.father != 0);
+   if (storeRouteCtx (ctx, &ctx->route, &ctx->par.pOr, (ctx->route.destinationReached) ? &ctx->par.pDest : &ctx->lastClosest))
    // if (storeRoute (&route, &par.pOr, &lastClosest))
-      g_atomic_int_set (&route.ret, ret); // route.ret is positionned just before ending. route.ret is shared between threads !
+      g_atomic_int_set (&ctx->route.ret, ret); // route.ret is positionned just before ending. route.ret is shared between threads !
    else 
-      g_atomic_int_set (&route.ret, ROUTING_ERROR);
-   statRoute (&route);
-   return NULL;
+      g_atomic_int_set (&ctx->route.ret, ROUTING_ERROR);
+   statRoute (ctx, &ctx->route);
 }
 
-/*! choose best time to reach pDest in minimum time */
-void *bestTimeDeparture () {
-   double minDuration = DBL_MAX, maxDuration = 0;
-   int localRet;
-   int nUnreachable = 0;
-   chooseDeparture.bestTime = -1.0;
-   chooseDeparture.count = 0;
-   chooseDeparture.bestCount = -1;
-   chooseDeparture.tStop = chooseDeparture.tEnd; // default value
-
-   for (double t = chooseDeparture.tBegin; t < chooseDeparture.tEnd ; t += chooseDeparture.tInterval) {
-      if (chooseDeparture.count > MAX_N_INTERVAL) {
-         fprintf (stderr, "In bestTimeDeparture, chooseDeparture.count exceed limit %d\n", chooseDeparture.count);
+/*! allocate if needed nWorkers private contexts of ctx and copy ctx input in them.
+   Return the number of worker contexts available */
+static int workersPrepare (RoutingContext *ctx, int nWorkers, void (*progress) (RoutingContext *w), void *userData) {
+   for (int k = 0; k < nWorkers; k++) {
+      if ((ctx->worker [k] == NULL) && ((ctx->worker [k] = routingContextNew ()) == NULL)) {
+         nWorkers = k;
          break;
       }
-      par.startTimeInHours = t;
-      routingLaunch ();
-      localRet = g_atomic_int_get (&route.ret);
-      if (localRet == ROUTING_STOPPED) {
-         g_atomic_int_set (&chooseDeparture.ret, STOPPED);
-         return NULL;
+   }
+   for (int k = 0; k < nWorkers; k++) {
+      RoutingContext *w = ctx->worker [k];
+      w->par = ctx->par;
+      w->par.nThreads = MAX (1, ctx->par.nThreads / nWorkers); // remaining threads for isochrone expansion
+      w->wayPoints = ctx->wayPoints;
+      w->competitors = ctx->competitors;
+      w->chooseDeparture = ctx->chooseDeparture;
+      w->data = ctx->data;
+      w->pruneSpeed = ctx->pruneSpeed;
+      w->pruneDuration = 0;
+      w->progress = progress;
+      w->userData = userData;
+   }
+   return nWorkers;
+}
+
+/*! shared state of bestTimeDepartureRun workers */
+typedef struct {
+   int nSlots;                                  // number of departure times to try
+   double tSlot [MAX_N_DEPARTURE];              // departure time of each slot
+   double duration [MAX_N_DEPARTURE];           // route duration of each slot
+   int ret [MAX_N_DEPARTURE];                   // route.ret of each slot
+   bool done [MAX_N_DEPARTURE];                 // true when slot result is available
+   gint next;                                   // next slot to compute
+   gint firstUnreachable;                       // slots after this one are useless
+   gint stop;                                   // true when user stops the search
+   int nRunning;                                // number of workers still running
+   double bestDuration;                         // best duration of slots done, for pruning
+   GMutex mutex;                                // protects ret, duration, done, nRunning and bestDuration
+   GCond cond;                                  // signaled each time a slot is done or a worker ends
+} DepartureJob;
+
+/*! progress callback of departure workers. Abort when user stops or when current slot became useless.
+   In prune mode, take into account best duration found by other workers */
+static void departureWorkerProgress (RoutingContext *w) {
+   DepartureJob *job = w->userData;
+   if (g_atomic_int_get (&job->stop) || (w->chooseDeparture.count > g_atomic_int_get (&job->firstUnreachable)))
+      g_atomic_int_set (&w->route.ret, ROUTING_STOPPED);
+   if (w->chooseDeparture.prune) {
+      g_mutex_lock (&job->mutex);
+      w->pruneDuration = (job->bestDuration < DBL_MAX) ? job->bestDuration : 0;
+      g_mutex_unlock (&job->mutex);
+   }
+}
+
+/*! departure worker: route slots in increasing order until none left. w->chooseDeparture.count is current slot */
+static gpointer departureWorkerThread (gpointer data) {
+   RoutingContext *w = data;
+   DepartureJob *job = w->userData;
+   int i, ret;
+   while (!g_atomic_int_get (&job->stop) && ((i = g_atomic_int_add (&job->next, 1)) < job->nSlots)
+      && (i <= g_atomic_int_get (&job->firstUnreachable))) {
+      w->chooseDeparture.count = i;
+      w->par.startTimeInHours = job->tSlot [i];
+      departureWorkerProgress (w);
+      routingRun (w);
+      ret = g_atomic_int_get (&w->route.ret);
+      if (ret == ROUTING_STOPPED) continue;
+      g_mutex_lock (&job->mutex);
+      job->duration [i] = w->route.duration;
+      job->ret [i] = ret;
+      job->done [i] = true;
+      if ((ret > 0) && (w->route.duration < job->bestDuration))
+         job->bestDuration = w->route.duration;
+      if ((ret <= 0) && (ret != ROUTING_PRUNED) && ! w->chooseDeparture.prune && (i < g_atomic_int_get (&job->firstUnreachable)))
+         g_atomic_int_set (&job->firstUnreachable, i);
+      g_cond_signal (&job->cond);
+      g_mutex_unlock (&job->mutex);
+   }
+   g_mutex_lock (&job->mutex);
+   job->nRunning -= 1;
+   g_cond_signal (&job->cond);
+   g_mutex_unlock (&job->mutex);
+   return NULL;
+}
+
+/*! record in chooseDeparture the result of slot chooseDeparture.count. Return false if search should stop */
+static bool departureRecord (RoutingContext *ctx, double t, int ret, double duration, double *minDuration, double *maxDuration) {
+   if (ret == ROUTING_PRUNED) {
+      ctx->chooseDeparture.t [ctx->chooseDeparture.count] = PRUNED;
+      printf ("Count: %d, time %.2lf, Pruned\n", ctx->chooseDeparture.count, t);
+   }
+   else if (ret <= 0) {
+      printf ("Count: %d, time %.2lf, Unreachable\n", ctx->chooseDeparture.count, t);
+      if (! ctx->chooseDeparture.prune) {
+         ctx->chooseDeparture.tStop = t;
+         return false;
       }
-      if (localRet > 0) {
-         chooseDeparture.t [chooseDeparture.count] = route.duration;
-         if (route.duration < minDuration) {
-            minDuration = route.duration;
-            chooseDeparture.bestTime = t;
-            chooseDeparture.bestCount = chooseDeparture.count;
-            printf ("Count: %d, time %.2lf, duration: %.2lf, min: %.2lf, bestTime: %.2lf\n", \
-                 chooseDeparture.count, t, route.duration, minDuration, chooseDeparture.bestTime);
-         }
-         if (route.duration > maxDuration) {
-            maxDuration = route.duration;
-         }
+      ctx->chooseDeparture.t [ctx->chooseDeparture.count] = NIL;
+   }
+   else {
+      ctx->chooseDeparture.t [ctx->chooseDeparture.count] = duration;
+   }
+   if ((ret > 0) && (duration < *minDuration)) {
+      *minDuration = duration;
+      ctx->chooseDeparture.bestTime = t;
+      ctx->chooseDeparture.bestCount = ctx->chooseDeparture.count;
+      printf ("Count: %d, time %.2lf, duration: %.2lf, min: %.2lf, bestTime: %.2lf\n", \
+           ctx->chooseDeparture.count, t, duration, *minDuration, ctx->chooseDeparture.bestTime);
+   }
+   if ((ret > 0) && (duration > *maxDuration)) {
+      *maxDuration = duration;
+   }
+   ctx->chooseDeparture.count += 1;
+   if (ctx->progress) ctx->progress (ctx);
+   return true;
+}
+
+/*! try departure slots of job with nWorkers private contexts. Results are recorded in slot order as in serial search.
+   Return false if stopped by user */
+static bool departureParallel (RoutingContext *ctx, DepartureJob *job, int nWorkers, double *minDuration, double *maxDuration) {
+   GThread *thread [MAX_N_THREADS];
+   bool stopped = false;
+   int i = 0;
+
+   if ((nWorkers = workersPrepare (ctx, nWorkers, departureWorkerProgress, job)) == 0)
+      return true;                              // nothing computed, no solution
+   job->next = 0;
+   job->firstUnreachable = job->nSlots;
+   job->stop = false;
+   job->nRunning = nWorkers;
+   job->bestDuration = DBL_MAX;
+   g_mutex_init (&job->mutex);
+   g_cond_init (&job->cond);
+   g_atomic_int_set (&ctx->route.ret, ROUTING_RUNNING);
+
+   for (int k = 0; k < nWorkers; k++)
+      thread [k] = g_thread_new ("departure", departureWorkerThread, ctx->worker [k]);
+
+   g_mutex_lock (&job->mutex);
+   while (true) {
+      while ((i < job->nSlots) && job->done [i]) { // record in slot order
+         g_mutex_unlock (&job->mutex);
+         if (!departureRecord (ctx, job->tSlot [i], job->ret [i], job->duration [i], minDuration, maxDuration))
+            i = job->nSlots;
+         else i += 1;
+         g_mutex_lock (&job->mutex);
       }
-      else {
-         chooseDeparture.tStop = t;
-         printf ("Count: %d, time %.2lf, Unreachable\n", chooseDeparture.count, t);
+      if ((i >= job->nSlots) || (job->nRunning == 0) || stopped)
          break;
-         chooseDeparture.t [chooseDeparture.count] = NIL;
-         if (nUnreachable > MAX_UNREACHABLE) {
-            break;
+      g_cond_wait_until (&job->cond, &job->mutex, g_get_monotonic_time () + DEPARTURE_POLL_TIME);
+      g_mutex_unlock (&job->mutex);
+      if (ctx->progress) ctx->progress (ctx);   // forward user stop request
+      if (g_atomic_int_get (&ctx->route.ret) == ROUTING_STOPPED) {
+         g_atomic_int_set (&job->stop, true);
+         stopped = true;
+      }
+      g_mutex_lock (&job->mutex);
+   }
+   g_mutex_unlock (&job->mutex);
+   g_atomic_int_set (&job->stop, true);         // remaining workers are useless
+   for (int k = 0; k < nWorkers; k++)
+      g_thread_join (thread [k]);
+   g_mutex_clear (&job->mutex);
+   g_cond_clear (&job->cond);
+   return !stopped;
+}
+
+/*! return max value of polar mat for all twa and all w up to wMax
+   above last column of mat, findPolar extrapolates linearly: max of extrapolation is at wMax */
+static double maxValInPolUpTo (const PolMat *mat, double wMax) {
+   double max = maxValInPol (mat);
+   if ((mat->nCol > 2) && (wMax > mat->t [0][mat->nCol - 1]))
+      max = MAX (max, maxSpeedInPolarMatAt (wMax, mat));
+   return max;
+}
+
+/*! return admissible max speed in knots of boat in ctx, for pruning
+   isochrone points with tws over par.maxWind are not expanded, so polar is read at tws * xWind <= maxWind * xWind */
+static double departureMaxSpeed (const RoutingContext *ctx) {
+   double speed = maxValInPolUpTo (ctx->data.polMat, ctx->par.maxWind * ctx->par.xWind) * MAX (ctx->par.dayEfficiency, ctx->par.nightEfficiency);
+   double currMax = 0.0, waveMax = 0.0;
+   speed = MAX (speed, ctx->par.motorSpeed);
+   if (ctx->par.withWaves) {
+      if (ctx->par.constWindTws != 0 || ctx->par.constWave < 0)
+         waveMax = 0.0;
+      else if (ctx->par.constWave > 0)
+         waveMax = ctx->par.constWave;
+      else if (ctx->data.windData != NULL) {
+         const Zone *z = ctx->data.zone;
+         const long n = z->nTimeStamp * z->nbLat * z->nbLon;
+         for (long i = 0; i < n; i++)
+            waveMax = MAX (waveMax, ctx->data.windData [i].w);
+      }
+      speed *= MAX (1.0, maxValInPolUpTo (ctx->data.wavePolMat, waveMax) / 100.0);
+   }
+   speed *= MAX (1.0, MIN_DT / ctx->par.tStep);      // realDt may exceed tStep after penalty
+   if (ctx->par.withCurrent && (ctx->data.currentData != NULL)) {
+      const Zone *cz = ctx->data.currentZone;
+      const long n = cz->nTimeStamp * cz->nbLat * cz->nbLon;
+      for (long i = 0; i < n; i++)
+         currMax = MAX (currMax, hypot (ctx->data.currentData [i].u, ctx->data.currentData [i].v));
+   }
+   return PRUNE_SPEED_MARGIN * speed + MS_TO_KN * currMax;
+}
+
+/*! choose best time to reach pDest in minimum time.
+   With par.nThreads > 1, departure slots are routed concurrently with identical chooseDeparture result.
+   With chooseDeparture.prune, tries are abandoned as soon as they cannot beat best so far,
+   and unreachable tries do not stop search. minDuration and bestCount are unchanged, maxDuration ignores pruned tries */
+void bestTimeDepartureRun (RoutingContext *ctx) {
+   double minDuration = DBL_MAX, maxDuration = 0;
+   int localRet;
+   int nWorkers;
+   double t;
+   DepartureJob *job = calloc (1, sizeof (DepartureJob));
+   if (job == NULL) {
+      fprintf (stderr, "In bestTimeDeparture: error in memory allocation\n");
+      g_atomic_int_set (&ctx->chooseDeparture.ret, NO_SOLUTION);
+      return;
+   }
+   ctx->chooseDeparture.bestTime = -1.0;
+   ctx->chooseDeparture.count = 0;
+   ctx->chooseDeparture.bestCount = -1;
+   ctx->chooseDeparture.tStop = ctx->chooseDeparture.tEnd; // default value
+   ctx->pruneDuration = 0;
+   ctx->pruneSpeed = (ctx->chooseDeparture.prune) ? departureMaxSpeed (ctx) : 0;
+
+   for (t = ctx->chooseDeparture.tBegin; (t < ctx->chooseDeparture.tEnd) && (job->nSlots < MAX_N_DEPARTURE); t += ctx->chooseDeparture.tInterval)
+      job->tSlot [job->nSlots++] = t;
+   if (t < ctx->chooseDeparture.tEnd)
+      fprintf (stderr, "In bestTimeDeparture, chooseDeparture.count exceed limit %d\n", job->nSlots);
+
+   nWorkers = MIN (ctx->par.nThreads, job->nSlots);
+   if (nWorkers > 1) {
+      if (!departureParallel (ctx, job, nWorkers, &minDuration, &maxDuration)) {
+         g_atomic_int_set (&ctx->chooseDeparture.ret, STOPPED);
+         free (job);
+         return;
+      }
+   }
+   else {
+      for (int i = 0; i < job->nSlots; i += 1) {
+         ctx->par.startTimeInHours = job->tSlot [i];
+         if (ctx->chooseDeparture.prune && (ctx->chooseDeparture.bestCount >= 0))
+            ctx->pruneDuration = minDuration;
+         routingRun (ctx);
+         localRet = g_atomic_int_get (&ctx->route.ret);
+         if (localRet == ROUTING_STOPPED) {
+            g_atomic_int_set (&ctx->chooseDeparture.ret, STOPPED);
+            ctx->pruneDuration = 0;
+            free (job);
+            return;
          }
-         nUnreachable += 1;
+         if (!departureRecord (ctx, job->tSlot [i], localRet, ctx->route.duration, &minDuration, &maxDuration))
+            break;
       }
-      chooseDeparture.count += 1;
-   }
-   if (chooseDeparture.bestCount >= 0) {
-      par.startTimeInHours = chooseDeparture.bestTime;
-      printf ("Solution exist: best startTime: %.2lf\n", par.startTimeInHours);
-      chooseDeparture.minDuration = minDuration;
-      chooseDeparture.maxDuration = maxDuration;
-      routingLaunch ();
-      g_atomic_int_set (&chooseDeparture.ret, EXIST_SOLUTION);
+   }
+   free (job);
+   ctx->pruneDuration = 0;
+   if (ctx->chooseDeparture.bestCount >= 0) {
+      ctx->par.startTimeInHours = ctx->chooseDeparture.bestTime;
+      printf ("Solution exist: best startTime: %.2lf\n", ctx->par.startTimeInHours);
+      ctx->chooseDeparture.minDuration = minDuration;
+      ctx->chooseDeparture.maxDuration = maxDuration;
+      routingRun (ctx);
+      g_atomic_int_set (&ctx->chooseDeparture.ret, EXIST_SOLUTION);
    }  
    else {
-      g_atomic_int_set (&chooseDeparture.ret, NO_SOLUTION);
+      g_atomic_int_set (&ctx->chooseDeparture.ret, NO_SOLUTION);
       printf ("No solution\n");
    }
-   return NULL;
 }
 
-/*! launch all competitors */
-void *allCompetitors () {
+/*! launch all competitors of ctx */
+void allCompetitorsRun (RoutingContext *ctx) {
    bool existSolution = false;
    int localRet;
-   for (int i = 0; i < competitors.n; i += 1) // reset eta(s)
-      competitors.t [i].strETA [0] = '\0';
+   historyFree (&ctx->historyRoute);
+   for (int i = 0; i < ctx->competitors.n; i += 1) // reset eta(s)
+      ctx->competitors.t [i].strETA [0] = '\0';
    
    // we begin by the end in order to keep main (index 0) competitor as last for display route 
-   for (int i = competitors.n - 1; i >= 0; i -= 1) {
+   for (int i = ctx->competitors.n - 1; i >= 0; i -= 1) {
       printf ("In allCompetitors: competitor: %d\n", i); 
-      competitors.runIndex = i;
-      par.pOr.lat = competitors.t [i].lat;
-      par.pOr.lon = competitors.t [i].lon;
-      routingLaunch ();
-      saveRoute (&route);
-      localRet = g_atomic_int_get (&route.ret);
+      ctx->competitors.runIndex = i;
+      ctx->par.pOr.lat = ctx->competitors.t [i].lat;
+      ctx->par.pOr.lon = ctx->competitors.t [i].lon;
+      routingRun (ctx);
+      historyAdd (&ctx->historyRoute, &ctx->route);
+      localRet = g_atomic_int_get (&ctx->route.ret);
       if (localRet == ROUTING_STOPPED) {
-         g_atomic_int_set (&competitors.ret, STOPPED);
-         return NULL;
+         g_atomic_int_set (&ctx->competitors.ret, STOPPED);
+         return;
       }
       if (localRet < 0) {
          fprintf (stderr, "In allCompetitors, No solution for competitor: %s with return: %d\n",\
-                  competitors.t[i].name, g_atomic_int_get (&route.ret));
-         g_strlcpy (competitors.t [i].strETA, "No Solution", MAX_SIZE_DATE); 
-         competitors.t [i].duration = 0; // hours
-         competitors.t [i].dist = 0;
+                  ctx->competitors.t[i].name, g_atomic_int_get (&ctx->route.ret));
+         g_strlcpy (ctx->competitors.t [i].strETA, "No Solution", MAX_SIZE_DATE); 
+         ctx->competitors.t [i].duration = 0; // hours
+         ctx->competitors.t [i].dist = 0;
          continue;
       }
-      newDate (zone.dataDate [0], zone.dataTime [0] / 100 + par.startTimeInHours + route.duration, 
-         competitors.t [i].strETA, MAX_SIZE_DATE); 
-      competitors.t [i].duration = route.duration; // hours
-      competitors.t [i].dist = orthoDist (competitors.t [i].lat, competitors.t [i].lon, par.pDest.lat, par.pDest.lon);
+      newDate (ctx->data.zone->dataDate [0], ctx->data.zone->dataTime [0] / 100 + ctx->par.startTimeInHours + ctx->route.duration, 
+         ctx->competitors.t [i].strETA, MAX_SIZE_DATE); 
+      ctx->competitors.t [i].duration = ctx->route.duration; // hours
+      ctx->competitors.t [i].dist = orthoDist (ctx->competitors.t [i].lat, ctx->competitors.t [i].lon, ctx->par.pDest.lat, ctx->par.pDest.lon);
       existSolution = true;
    }
-   g_atomic_int_set (&competitors.ret, (existSolution) ? EXIST_SOLUTION : NO_SOLUTION);
+   g_atomic_int_set (&ctx->competitors.ret, (existSolution) ? EXIST_SOLUTION : NO_SOLUTION);
+}
+
+/*! add a boat to fleet. Return false if allocation failed */
+bool fleetAdd (FleetList *fleet, const char *name, double lat, double lon) {
+   if (fleet->n >= fleet->nAlloc) {
+      int nAlloc = MAX (16, 2 * fleet->nAlloc);
+      FleetBoat *newT = realloc (fleet->t, nAlloc * sizeof (FleetBoat));
+      if (newT == NULL) {
+         fprintf (stderr, "In fleetAdd: error in memory allocation\n");
+         return false;
+      }
+      fleet->t = newT;
+      fleet->nAlloc = nAlloc;
+   }
+   FleetBoat *boat = &fleet->t [fleet->n];
+   memset (boat, 0, sizeof (FleetBoat));
+   g_strlcpy (boat->name, name, sizeof (boat->name));
+   boat->lat = lat;
+   boat->lon = lon;
+   boat->duration = HUGE_VAL;
+   fleet->n += 1;
+   return true;
+}
+
+/*! free fleet boats */
+void fleetFree (FleetList *fleet) {
+   free (fleet->t);
+   memset (fleet, 0, sizeof (FleetList));
+}
+
+/*! shared state of fleetRun workers */
+typedef struct {
+   FleetList *fleet;
+   gint next;                                   // next boat to route
+} FleetJob;
+
+/*! progress callback of fleet workers. Abort when user stops */
+static void fleetWorkerProgress (RoutingContext *w) {
+   FleetJob *job = w->userData;
+   if (g_atomic_int_get (&job->fleet->ret) == STOPPED)
+      g_atomic_int_set (&w->route.ret, ROUTING_STOPPED);
+}
+
+/*! fill compact result of boat with last route of w */
+static void fleetBoatSummary (const RoutingContext *w, FleetBoat *boat) {
+   boat->ret = g_atomic_int_get (&w->route.ret);
+   boat->dist = orthoDist (boat->lat, boat->lon, w->par.pDest.lat, w->par.pDest.lon);
+   if (boat->ret <= 0) {
+      boat->duration = HUGE_VAL;
+      g_strlcpy (boat->strETA, "No Solution", MAX_SIZE_DATE); 
+      return;
+   }
+   boat->duration = w->route.duration;
+   boat->totDist = w->route.totDist;
+   boat->avrSog = w->route.avrSog;
+   boat->maxTws = w->route.maxTws;
+   boat->nSailChange = w->route.nSailChange;
+   boat->nAmureChange = w->route.nAmureChange;
+   newDate (w->data.zone->dataDate [0], w->data.zone->dataTime [0] / 100 + w->par.startTimeInHours + boat->duration, 
+      boat->strETA, MAX_SIZE_DATE); 
+}
+
+/*! fleet worker: route boats until none left. Only the compact result of each boat is kept */
+static gpointer fleetWorkerThread (gpointer data) {
+   RoutingContext *w = data;
+   FleetJob *job = w->userData;
+   int i;
+   while ((g_atomic_int_get (&job->fleet->ret) != STOPPED) && ((i = g_atomic_int_add (&job->next, 1)) < job->fleet->n)) {
+      w->competitors.runIndex = 0;
+      g_strlcpy (w->competitors.t [0].name, job->fleet->t [i].name, sizeof (w->competitors.t [0].name));
+      w->par.pOr.lat = job->fleet->t [i].lat;
+      w->par.pOr.lon = job->fleet->t [i].lon;
+      routingRun (w);
+      if (g_atomic_int_get (&w->route.ret) == ROUTING_STOPPED)
+         break;
+      fleetBoatSummary (w, &job->fleet->t [i]);
+      g_atomic_int_inc (&job->fleet->nDone);
+   }
+   return NULL;
+}
+
+/*! compare fleet boats by duration, then by index in fleet */
+static int compareFleetBoat (const void *a, const void *b) {
+   const FleetBoat *boatA = *(const FleetBoat **) a;
+   const FleetBoat *boatB = *(const FleetBoat **) b;
+   if (boatA->duration < boatB->duration) return -1;
+   if (boatA->duration > boatB->duration) return 1;
+   return (boatA < boatB) ? -1 : (boatA > boatB);
+}
+
+/*! return array of fleet boats sorted by rank, boats without solution last. To be freed by caller. NULL if error */
+static FleetBoat **fleetRanked (const FleetList *fleet) {
+   FleetBoat **ranked = malloc (MAX (1, fleet->n) * sizeof (FleetBoat *));
+   if (ranked == NULL) {
+      fprintf (stderr, "In fleetRanked: error in memory allocation\n");
+      return NULL;
+   }
+   for (int i = 0; i < fleet->n; i += 1)
+      ranked [i] = &fleet->t [i];
+   qsort (ranked, fleet->n, sizeof (FleetBoat *), compareFleetBoat);
+   return ranked;
+}
+
+/*! route all boats of fleet from their position to ctx->par.pDest with ctx parameters and data.
+   Boats are routed concurrently by par.nThreads workers, each with a private context reused from boat to boat,
+   so memory does not depend on fleet size. Set rank of each boat */
+void fleetRun (RoutingContext *ctx, FleetList *fleet) {
+   GThread *thread [MAX_N_THREADS];
+   FleetJob job = {.fleet = fleet, .next = 0};
+   int nWorkers = MIN (ctx->par.nThreads, fleet->n);
+   bool existSolution = false;
+   int rank = 0;
+
+   g_atomic_int_set (&fleet->nDone, 0);
+   for (int i = 0; i < fleet->n; i += 1) {        // reset results
+      fleet->t [i].ret = ROUTING_RUNNING;
+      fleet->t [i].rank = 0;
+      fleet->t [i].duration = HUGE_VAL;
+      fleet->t [i].strETA [0] = '\0';
+   }
+   if ((nWorkers = workersPrepare (ctx, MAX (1, nWorkers), fleetWorkerProgress, &job)) == 0) {
+      g_atomic_int_set (&fleet->ret, NO_SOLUTION);
+      return;
+   }
+   for (int k = 1; k < nWorkers; k++)
+      thread [k] = g_thread_new ("fleet", fleetWorkerThread, ctx->worker [k]);
+   fleetWorkerThread (ctx->worker [0]);          // calling thread is first worker
+   for (int k = 1; k < nWorkers; k++)
+      g_thread_join (thread [k]);
+
+   if (g_atomic_int_get (&fleet->ret) == STOPPED)
+      return;
+   FleetBoat **ranked = fleetRanked (fleet);
+   if (ranked != NULL) {
+      for (int i = 0; (i < fleet->n) && (ranked [i]->ret > 0); i += 1)
+         ranked [i]->rank = ++rank;
+      free (ranked);
+   }
+   existSolution = (rank > 0);
+   printf ("In fleetRun: %d boats, %d reach destination\n", fleet->n, rank);
+   g_atomic_int_set (&fleet->ret, (existSolution) ? EXIST_SOLUTION : NO_SOLUTION);
+}
+
+/*! allocate a routing context. Return NULL if allocation failed */
+RoutingContext *routingContextNew (void) {
+   RoutingContext *ctx = calloc (1, sizeof (RoutingContext));
+   if (ctx == NULL) {
+      fprintf (stderr, "In routingContextNew: error in memory allocation\n");
+      return NULL;
+   }
+   ctx->competitors.runIndex = 0;
+   return ctx;
+}
+
+/*! free a routing context and all buffers it owns */
+void routingContextFree (RoutingContext *ctx) {
+   if (ctx == NULL) return;
+   if (ctx->chunkPool != NULL)
+      g_thread_pool_free (ctx->chunkPool, FALSE, TRUE);  // stop and join chunk workers
+   free (ctx->isocArray);
+   free (ctx->isoDesc);
+   free (ctx->route.t);
+   free (ctx->tempList);
+   free (ctx->tempMetric);
+   free (ctx->optList);
+   arenaFree (&ctx->arena);
+   flowSliceFree (&ctx->windSlice);
+   flowSliceFree (&ctx->currentSlice);
+   dayLightFree (&ctx->dayLight);
+   for (int i = 0; i < MAX_N_THREADS; i += 1) {
+      free (ctx->chunkBuffer [i]);
+      free (ctx->chunkMetric [i]);
+      routingContextFree (ctx->worker [i]);
+   }
+   historyFree (&ctx->historyRoute);
+   free (ctx);
+}
+
+/*! fill ctx parameters and read only data from global variables */
+void routingContextFromGlobals (RoutingContext *ctx) {
+   ctx->par = par;
+   ctx->wayPoints = wayPoints;
+   ctx->competitors = competitors;
+   ctx->chooseDeparture = chooseDeparture;
+   ctx->data.zone = &zone;
+   ctx->data.currentZone = &currentZone;
+   ctx->data.windData = tGribData [WIND];
+   ctx->data.currentData = tGribData [CURRENT];
+   ctx->data.polMat = &polMat;
+   ctx->data.sailPolMat = &sailPolMat;
+   ctx->data.wavePolMat = &wavePolMat;
+   ctx->data.tIsSea = tIsSea;
+}
+
+/*! publish legacy context progress in global variables and forward user stop request */
+static int *legacyStopRet = NULL;               // chooseDeparture.ret or competitors.ret when watched
+static void legacyProgress (RoutingContext *ctx) {
+   isocArray = ctx->isocArray;
+   isoDesc = ctx->isoDesc;
+   maxNIsoc = ctx->maxNIsoc;
+   nIsoc = ctx->nIsoc;
+   lastClosest = ctx->lastClosest;
+   historyRoute = ctx->historyRoute;
+   competitors.runIndex = ctx->competitors.runIndex;
+   chooseDeparture.count = ctx->chooseDeparture.count;
+   if ((g_atomic_int_get (&route.ret) == ROUTING_STOPPED) ||
+      ((legacyStopRet != NULL) && (g_atomic_int_get (legacyStopRet) == STOPPED)))
+      g_atomic_int_set (&ctx->route.ret, ROUTING_STOPPED);
+}
+
+/*! prepare legacy context from global variables. Return NULL if allocation failed */
+static RoutingContext *legacyBegin (int *stopRet) {
+   if ((legacyCtx == NULL) && ((legacyCtx = routingContextNew ()) == NULL))
+      return NULL;
+   routingContextFromGlobals (legacyCtx);
+   legacyCtx->progress = legacyProgress;
+   legacyCtx->historyRoute = historyRoute;
+   legacyStopRet = stopRet;
+   nIsoc = 0;
+   memset (&route, 0, sizeof (SailRoute));
+   g_atomic_int_set (&route.ret, ROUTING_RUNNING);
+   return legacyCtx;
+}
+
+/*! copy legacy context results in global variables. route.ret is set last as it is shared between threads */
+static void legacyEnd (RoutingContext *ctx) {
+   int ret = g_atomic_int_get (&ctx->route.ret);
+   legacyProgress (ctx);
+   legacyStopRet = NULL;
+   memset (&ctx->historyRoute, 0, sizeof (HistoryRouteList)); // ownership back to global historyRoute
+   par.pOr = ctx->par.pOr;
+   par.pDest = ctx->par.pDest;
+   par.startTimeInHours = ctx->par.startTimeInHours;
+   route = ctx->route;
+   g_atomic_int_set (&route.ret, ret);
+}
+
+/*! launch routing wih global parameters */
+void *routingLaunch () {
+   RoutingContext *ctx = legacyBegin (NULL);
+   if (ctx == NULL) {
+      g_atomic_int_set (&route.ret, ROUTING_ERROR);
+      return NULL;
+   }
+   routingRun (ctx);
+   legacyEnd (ctx);
+   return NULL;
+}
+
+/*! choose best time to reach pDest in minimum time with global parameters */
+void *bestTimeDeparture () {
+   RoutingContext *ctx = legacyBegin (&chooseDeparture.ret);
+   if (ctx == NULL) {
+      g_atomic_int_set (&chooseDeparture.ret, NO_SOLUTION);
+      return NULL;
+   }
+   bestTimeDepartureRun (ctx);
+   legacyEnd (ctx);
+   int ret = g_atomic_int_get (&ctx->chooseDeparture.ret);
+   chooseDeparture = ctx->chooseDeparture;
+   g_atomic_int_set (&chooseDeparture.ret, ret);
+   return NULL;
+}
+
+/*! launch all global competitors */
+void *allCompetitors () {
+   RoutingContext *ctx = legacyBegin (&competitors.ret);
+   if (ctx == NULL) {
+      g_atomic_int_set (&competitors.ret, NO_SOLUTION);
+      return NULL;
+   }
+   allCompetitorsRun (ctx);
+   legacyEnd (ctx);
+   int ret = g_atomic_int_get (&ctx->competitors.ret);
+   competitors = ctx->competitors;
+   g_atomic_int_set (&competitors.ret, ret);
+   return NULL;
+}
+
+/*! launch fleet routing with global parameters. data is the FleetList */
+void *fleetLaunch (void *data) {
+   FleetList *fleet = data;
+   RoutingContext *ctx = legacyBegin (&fleet->ret);
+   if (ctx == NULL) {
+      g_atomic_int_set (&fleet->ret, NO_SOLUTION);
+      return NULL;
+   }
+   fleetRun (ctx, fleet);
+   legacyEnd (ctx);
    return NULL;
 }
 
@@ -1329,6 +2224,39 @@ void competitorsToStr (CompetitorsList *copyComp, char *buffer, size_t maxLen, c
    g_strlcat (buffer, footer, maxLen);
 }
 
+/*! return ranked table of fleet as text. footer is filled with meta data */
+GString *fleetToStr (const FleetList *fleet, char *footer, size_t maxLenFooter) {
+   char strDep [MAX_SIZE_DATE];
+   char strDelay [MAX_SIZE_LINE];
+   char strLat [MAX_SIZE_NAME], strLon [MAX_SIZE_NAME];
+   GString *res = g_string_new ("Rank; Name;                      Lat.;        Lon.;              ETA;     Dist;  Avr Sog;    To Best Delay\n");
+   FleetBoat **ranked = fleetRanked (fleet);
+   if (ranked == NULL) return res;
+   const double bestDuration = (fleet->n > 0) ? ranked [0]->duration : HUGE_VAL;
+
+   for (int i = 0; i < fleet->n; i++) {
+      const FleetBoat *boat = ranked [i];
+      latToStr (boat->lat, par.dispDms, strLat, sizeof (strLat));
+      lonToStr (boat->lon, par.dispDms, strLon, sizeof (strLon));
+      if (boat->rank == 0)
+         g_strlcpy (strDelay, "NA", sizeof (strDelay));
+      else 
+         delayToStr (boat->duration - bestDuration, strDelay, sizeof (strDelay));
+
+      char *noAccents = g_str_to_ascii (boat->name, NULL); // replace accents...
+      noAccents [MIN (strlen (noAccents), 18)] = '\0';    // trunc
+      g_string_append_printf (res, "%4d; %-19s;%12s; %12s; %16s; %8.2lf; %8.2lf; %16s\n", 
+         boat->rank, noAccents, strLat, strLon, boat->strETA, boat->totDist, boat->avrSog, strDelay);
+      g_free (noAccents);
+   }
+   free (ranked);
+
+   newDate (zone.dataDate [0], zone.dataTime [0]/100 + par.startTimeInHours, strDep, sizeof (strDep)); 
+   snprintf (footer, maxLenFooter, "Number of Boats: %d, Departure Date: %s, Isoc Time Step: %.2lf\n", 
+      fleet->n, strDep, par.tStep);
+   return res;
+}
+
 /*! export route with GPX format */
 bool exportRouteToGpx (const SailRoute *route, const gchar *fileName) {
    FILE *f;
@@ -1374,8 +2302,8 @@ bool exportRouteToGpx (const SailRoute *route, const gchar *fileName) {
    return true;
 }
 
-/*! generate json description of isochrones */
-GString *isochronesToJson () {
+/*! generate json description of isochrones of ctx */
+static GString *isocToJson (const RoutingContext *ctx) {
    Pp pt;
    int index;
    GString *jsonString = g_string_new ("[\n");
@@ -1385,62 +2313,69 @@ GString *isochronesToJson () {
       return NULL;
    }
    
-   for (int i = 0; i < nIsoc; i += 1) {
+   for (int i = 0; i < ctx->nIsoc; i += 1) {
       g_string_append_printf (jsonString, "   [\n"); 
-      index = (isoDesc [i].size <= 1) ?  0 : isoDesc [i].first;
-      for (int j = 0; j < isoDesc [i].size; j++) {
-         newIsoc [j] = isocArray [i * MAX_SIZE_ISOC + index];
+      index = (ctx->isoDesc [i].size <= 1) ?  0 : ctx->isoDesc [i].first;
+      for (int j = 0; j < ctx->isoDesc [i].size; j++) {
+         newIsoc [j] = ctx->isocArray [i][index];
          index += 1;
-         if (index == isoDesc [i].size) index = 0;
+         if (index == ctx->isoDesc [i].size) index = 0;
       }
-      int max = isoDesc [i].size;
+      int max = ctx->isoDesc [i].size;
       for (int k = 0; k < max; k++) {
          pt = newIsoc [k];
          g_string_append_printf (jsonString, "      [%.6lf, %.6lf, %d, %d, %d]%s\n", pt.lat, pt.lon, pt.id, pt.father, k, (k < max - 1) ? ","  : ""); 
       }
-      g_string_append_printf (jsonString, "   ]%s\n", (i < nIsoc -1) ? "," : ""); // no comma for last value 
+      g_string_append_printf (jsonString, "   ]%s\n", (i < ctx->nIsoc -1) ? "," : ""); // no comma for last value 
    }
    g_string_append_printf (jsonString, "]\n"); 
    free (newIsoc);
    return jsonString;
 }
 
+/*! generate json description of global isochrones */
+GString *isochronesToJson () {
+   RoutingContext view = {.isocArray = isocArray, .isoDesc = isoDesc, .nIsoc = nIsoc};
+   return isocToJson (&view);
+}
+
 /*! generate json description of isochrones decriptor */
-GString *isoDescToJson () {
+static GString *isoDescToJson (const RoutingContext *ctx) {
    GString *jsonString = g_string_new ("[\n");
 
-   for (int i = 0; i < nIsoc; i++) {
+   for (int i = 0; i < ctx->nIsoc; i++) {
       //double distance = isoDesc [i].distance;
       //if (distance >= DBL_MAX) distance = -1;
       g_string_append_printf (jsonString, "   [%d, %d, %d, %d, %d, %.2lf, %.2lf, %.6lf, %.6lf]%s\n",
-         i, isoDesc [i].toIndexWp, isoDesc[i].size, isoDesc[i].first, isoDesc[i].closest, 
-         isoDesc[i].bestVmc, isoDesc[i].biggestOrthoVmc, 
-         isoDesc [i].focalLat, 
-         isoDesc [i].focalLon,
-         (i < nIsoc - 1) ? "," : "");
+         i, ctx->isoDesc [i].toIndexWp, ctx->isoDesc[i].size, ctx->isoDesc[i].first, ctx->isoDesc[i].closest, 
+         ctx->isoDesc[i].bestVmc, ctx->isoDesc[i].biggestOrthoVmc, 
+         ctx->isoDesc [i].focalLat, 
+         ctx->isoDesc [i].focalLon,
+         (i < ctx->nIsoc - 1) ? "," : "");
    }
    g_string_append_printf (jsonString, "]\n"); 
    return jsonString;
 }
 
 /*! generate json description of track boats */
-GString *routeToJson (SailRoute *route, int index, bool isoc, bool isoDesc) {
+GString *routeToJson (const RoutingContext *ctx, const SailRoute *route, int index, bool isoc, bool isoDesc) {
    GString *jString = g_string_new ("");
    char strSail [MAX_SIZE_NAME];
    double twa = 0.0, hdg = 0.0, twd = 0.0;
    if (route->n <= 0) return jString;
 
    int iComp = (route->competitorIndex < 0) ? 0 : route->competitorIndex;
-   gchar *gribBaseName = g_path_get_basename (par.gribFileName);
-   gchar *gribCurrentBaseName = g_path_get_basename (par.currentGribFileName);
-   gchar *wavePolarBaseName = g_path_get_basename (par.wavePolFileName);
+   gchar *gribBaseName = g_path_get_basename (ctx->par.gribFileName);
+   gchar *gribCurrentBaseName = g_path_get_basename (ctx->par.currentGribFileName);
+   gchar *wavePolarBaseName = g_path_get_basename (ctx->par.wavePolFileName);
 
    g_string_append_printf (jString, "\"%s\": {\n\"heading\": %.0lf, \"rank\": %d, \"duration\": %d, \"totDist\": %.2lf, \n",
-      competitors.t[iComp].name, route->t [index].lCap, 0, (int) (route->duration * 3600), route->totDist);
+      ctx->competitors.t[iComp].name, route->t [index].lCap, 0, (int) (route->duration * 3600), route->totDist);
 
    g_string_append_printf (jString, "\"routingRet\": %d,\n", route->ret);
    g_string_append_printf (jString, "\"isocTimeStep\": %.2lf,\n", route->isocTimeStep * 3600);
    g_string_append_printf (jString, "\"calculationTime\": %.4lf,\n", route->calculationTime);
+   g_string_append_printf (jString, "\"isocMemory\": %zu,\n", route->isocMemory);
    g_string_append_printf (jString, "\"destinationReached\": %s,\n", (route->destinationReached) ? "true" : "false");
 
    g_string_append_printf (jString, "\"lastStepDuration\": [");
@@ -1454,7 +2389,7 @@ GString *routeToJson (SailRoute *route, int index, bool isoc, bool isoDesc) {
    g_string_append_printf (jString, "\"nSailChange\": %d, \"nAmureChange\": %d,\n", route->nSailChange, route->nAmureChange);
 
    g_string_append_printf (jString, "\"bottomLat\": %.2lf, \"leftLon\": %.2lf, \"topLat\": %.2lf, \"rightLon\": %.2lf,\n",
-      zone.latMin, zone.lonLeft, zone.latMax, zone.lonRight);
+      ctx->data.zone->latMin, ctx->data.zone->lonLeft, ctx->data.zone->latMax, ctx->data.zone->lonRight);
  
    g_string_append_printf (jString, "\"polar\": \"%s\", \"wavePolar\": \"%s\", \"grib\": \"%s\", \"currentGrib\": \"%s\", \"track\": [\n", 
       route->polarFileName, wavePolarBaseName, gribBaseName, gribCurrentBaseName);
@@ -1493,26 +2428,26 @@ GString *routeToJson (SailRoute *route, int index, bool isoc, bool isoDesc) {
    /*if (route->destinationReached)
       g_string_append_printf (jString, "   [%d, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, \"%s\", %s, %d, %d]\n", 
       -1,
-      par.pDest.lat, par.pDest.lon,
+      ctx->par.pDest.lat, ctx->par.pDest.lon,
       (route->t[route->n - 1].time + route->lastStepDuration) * 3600.0,
       0.0, route->t[route->n - 1].sog,        // no other step. Dist = 0, Speed = 0
       twd ,route->t[route->n - 1].tws,       // replicate last
       hdg, twa,
       route->t[route->n - 1].g, route->t[route->n - 1].w , route->t[route->n - 1].stamina,
       strSail, (route->t[route->n - 1].motor) ? "true" : "false",
-      par.pDest.id, par.pDest.father);*/
+      ctx->par.pDest.id, ctx->par.pDest.father);*/
 
    g_string_append_printf (jString, "]\n}\n");
 
    if (isoc) {
-      GString *isocString = isochronesToJson ();
+      GString *isocString = isocToJson (ctx);
       if (isocString != NULL) {
          g_string_append_printf (jString, ",\n\"_isoc\": \n%s", isocString->str);
          g_string_free (isocString, TRUE);
       }
    }
    if (isoDesc) {
-      GString *isoDescString = isoDescToJson ();
+      GString *isoDescString = isoDescToJson (ctx);
       if (isoDescString != NULL) {
          g_string_append_printf (jString, ",\n\"_isodesc\": \n%s", isoDescString->str);
          g_string_free (isoDescString, TRUE);
@@ -1523,7 +2458,7 @@ GString *routeToJson (SailRoute *route, int index, bool isoc, bool isoDesc) {
 }
 
 /*! translate competitor table to Json */
-static GString *competitorsReportJson (CompetitorsList *lComp) {
+static GString *competitorsReportJson (const RoutingContext *ctx, CompetitorsList *lComp) {
    char strDep [MAX_SIZE_DATE];
    GString *jString = g_string_new ("\"_report\": {\n");
    if (lComp->n == 0) {
@@ -1533,10 +2468,10 @@ static GString *competitorsReportJson (CompetitorsList *lComp) {
    Competitor mainCompetitor = lComp->t [0];
    if (lComp->n > 1)
       qsort (lComp->t, lComp->n, sizeof (Competitor), compareDuration);
-   newDate (zone.dataDate [0], zone.dataTime [0]/100 + par.startTimeInHours, strDep, sizeof (strDep)); 
+   newDate (ctx->data.zone->dataDate [0], ctx->data.zone->dataTime [0]/100 + ctx->par.startTimeInHours, strDep, sizeof (strDep)); 
 
    g_string_append_printf (jString, "\"nComp\": %d, \"startTimeStr\": \"%s\", \"isocTimeStep\": %d, \"polar\": \"%s\", \"array\": \n[\n",
-         lComp->n, strDep, (int) (3600 * par.tStep), route.polarFileName);
+         lComp->n, strDep, (int) (3600 * ctx->par.tStep), ctx->route.polarFileName);
    
    for (int i = 0; i < lComp->n; i++) {
       double dist;
@@ -1564,20 +2499,20 @@ static GString *competitorsReportJson (CompetitorsList *lComp) {
 
 /*! Translate routes to Json, including isochrones for most recent competitor only
    and report if number of competitor >= 1 */ 
-GString *allCompetitorsToJson (int n, bool isoc, bool isoDesc) {
+GString *allCompetitorsToJson (RoutingContext *ctx, int n, bool isoc, bool isoDesc) {
    GString *res = g_string_new ("{\n");
-   GString *jRoute = routeToJson (&route, 0, isoc, isoDesc); // only most recent route with isochrones 
+   GString *jRoute = routeToJson (ctx, &ctx->route, 0, isoc, isoDesc); // only most recent route with isochrones 
    g_string_append_printf (res, "%s", jRoute->str);
    g_string_free (jRoute, TRUE);
-   int maxHistory = MIN (n - 1, historyRoute.n);
+   int maxHistory = MIN (n - 1, ctx->historyRoute.n);
    if (n > 0) {
       g_string_append_printf (res, ",\n");
       for (int i = 0; i < maxHistory; i += 1) {
-         GString *jRoute = routeToJson (&historyRoute.r[i], 0, false, false); 
+         GString *jRoute = routeToJson (ctx, &ctx->historyRoute.r[i], 0, false, false); 
          g_string_append_printf (res, "%s, ", jRoute->str);
          g_string_free (jRoute, TRUE);
       }
-      GString *report = competitorsReportJson (&competitors);
+      GString *report = competitorsReportJson (ctx, &ctx->competitors);
       g_string_append_printf (res, "%s", report->str);
       g_string_free (report, TRUE);
    }
@@ -1585,14 +2520,47 @@ GString *allCompetitorsToJson (int n, bool isoc, bool isoDesc) {
    return res;
 }
 
+/*! Produce ranked table of fleet with compact summary of each boat */
+GString *fleetToJson (const RoutingContext *ctx, const FleetList *fleet) {
+   char strDep [MAX_SIZE_DATE];
+   GString *res = g_string_new ("{\n");
+   FleetBoat **ranked = fleetRanked (fleet);
+   if (ranked == NULL) {
+      g_string_append_printf (res, "\"_error\": \"Memory allocation\"}\n");
+      return res;
+   }
+   newDate (ctx->data.zone->dataDate [0], ctx->data.zone->dataTime [0]/100 + ctx->par.startTimeInHours, strDep, sizeof (strDep)); 
+   g_string_append_printf (res, "\"nBoats\": %d, \"startTimeStr\": \"%s\", \"isocTimeStep\": %d, \"array\": \n[\n",
+         fleet->n, strDep, (int) (3600 * ctx->par.tStep));
+
+   for (int i = 0; i < fleet->n; i++) {
+      const FleetBoat *boat = ranked [i];
+      char *name = g_strescape (boat->name, NULL);   // names from dashboard files may contain quotes
+      g_string_append_printf (res, "{\"rank\": %d, \"name\": \"%s\", \"lat\": %.4lf, \"lon\": %.4lf, \"routingRet\": %d, ", 
+         boat->rank, name, boat->lat, boat->lon, boat->ret);
+      g_free (name);
+      if (boat->rank > 0)
+         g_string_append_printf (res, "\"ETA\": \"%s\", \"duration\": %d, \"toBestDelay\": %d, \"dist\": %.2lf, \"totDist\": %.2lf, "
+            "\"avrSog\": %.2lf, \"maxTws\": %.2lf, \"nSailChange\": %d, \"nAmureChange\": %d}%s\n",
+            boat->strETA, (int) (3600 * boat->duration), (int) (3600 * (boat->duration - ranked [0]->duration)), boat->dist,
+            boat->totDist, boat->avrSog, boat->maxTws, boat->nSailChange, boat->nAmureChange, (i < fleet->n - 1) ? "," : "");
+      else
+         g_string_append_printf (res, "\"ETA\": null, \"dist\": %.2lf}%s\n", boat->dist, (i < fleet->n - 1) ? "," : "");
+   }
+   free (ranked);
+   g_string_append_printf (res, "]\n}\n");
+   return res;
+}
+
 /*! Produce meta info and table linked to bestTimeDeparture */ 
-GString *bestTimeReportToJson (ChooseDeparture *chooseDeparture, bool isoc, bool isoDesc) {
+GString *bestTimeReportToJson (const RoutingContext *ctx, bool isoc, bool isoDesc) {
+   const ChooseDeparture *chooseDeparture = &ctx->chooseDeparture;
    GString *res = g_string_new ("{\n");
-   if (chooseDeparture->count == 0) {
+   if (chooseDeparture->bestCount < 0) {
       g_string_append_printf (res, "\"_warning\": \"No Solution found. Destination unreachable.\"}\n");
       return res;
    }
-   GString *jRoute = routeToJson (&route, 0, isoc, isoDesc); // only most recent route with isochrones 
+   GString *jRoute = routeToJson (ctx, &ctx->route, 0, isoc, isoDesc); // only most recent route with isochrones 
    g_string_append_printf (res, "%s,\n", jRoute->str);
    g_string_free (jRoute, TRUE);
 
@@ -1613,13 +2581,17 @@ GString *bestTimeReportToJson (ChooseDeparture *chooseDeparture, bool isoc, bool
 
    for (int count = 0; count < chooseDeparture->count; count += 1) {
       double val = 3600.0 * chooseDeparture->t [count];
-      g_string_append_printf (jString, "%.0lf%s", val, ((count < chooseDeparture->count - 1) ? ", ": ""));
+      const char *sep = (count < chooseDeparture->count - 1) ? ", ": "";
+      if (val < 0) // unreachable or pruned
+         g_string_append_printf (jString, "null%s", sep);
+      else
+         g_string_append_printf (jString, "%.0lf%s", val, sep);
    }
 
    g_string_append_printf (jString, "]\n}\n");
 
    g_string_append_printf (res, "%s}\n", jString->str);
-   g_string_free (jRoute, TRUE);
+   g_string_free (jString, TRUE);
 
    return res;
 }
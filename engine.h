@@ -1,4 +1,4 @@
-extern Pp        *isocArray;                    // two dimensions array for isochrones
+extern Pp        **isocArray;                   // isocArray [i][k] is point k of isochrone i
 extern IsoDesc   *isoDesc;                      // one dimension array for isochrones meta data
 extern int       nIsoc;                         // number of isochrones calculated  by routing
 extern int       maxNIsoc;                      // max number of Isoc considering Grib meta information and timestep
@@ -14,6 +14,17 @@ extern bool    routeToStr (const SailRoute *route, char *str, size_t maxLen, cha
 extern void    *routingLaunch ();
 extern void    *bestTimeDeparture ();
 extern void    *allCompetitors ();
+extern void    *fleetLaunch (void *data);
+extern RoutingContext *routingContextNew (void);
+extern void    routingContextFree (RoutingContext *ctx);
+extern void    routingContextFromGlobals (RoutingContext *ctx);
+extern void    routingRun (RoutingContext *ctx);
+extern void    bestTimeDepartureRun (RoutingContext *ctx);
+extern void    allCompetitorsRun (RoutingContext *ctx);
+extern bool    fleetAdd (FleetList *fleet, const char *name, double lat, double lon);
+extern void    fleetFree (FleetList *fleet);
+extern void    fleetRun (RoutingContext *ctx, FleetList *fleet);
+extern GString *fleetToStr (const FleetList *fleet, char *footer, size_t maxLenFooter);
 extern void    freeHistoryRoute ();
 extern void    competitorsToStr (CompetitorsList *copyComp, char *buffer, size_t maxLen, char *footer, size_t maxLenFooter);
 extern void    logReport (int n);
@@ -21,9 +32,10 @@ extern void    saveRoute (SailRoute *route);
 extern bool    exportRouteToGpx (const SailRoute *route, const gchar *filename);
 extern bool    dumpIsocToFile (const char *fileName);
 extern GString *isochronesToJson ();
-extern GString *routeToJson (SailRoute *route, int index, bool isoc, bool isoDesc);
-extern GString *allCompetitorsToJson (int n, bool isoc, bool isoDesc);
-extern GString *bestTimeReportToJson (ChooseDeparture *chooseDeparture, bool isoc, bool isoDesc);
+extern GString *routeToJson (const RoutingContext *ctx, const SailRoute *route, int index, bool isoc, bool isoDesc);
+extern GString *allCompetitorsToJson (RoutingContext *ctx, int n, bool isoc, bool isoDesc);
+extern GString *fleetToJson (const RoutingContext *ctx, const FleetList *fleet);
+extern GString *bestTimeReportToJson (const RoutingContext *ctx, bool isoc, bool isoDesc);
 
 
 
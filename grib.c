@@ -337,7 +337,7 @@ static inline double arrondiMax (double v, double step) {
 
 /*! provide 4 wind points around p */
 static inline void find4PointsAround (double lat, double lon,  double *latMin, 
-   double *latMax, double *lonMin, double *lonMax, Zone *zone) {
+   double *latMax, double *lonMin, double *lonMax, const Zone *zone) {
 
    *latMin = arrondiMin (lat, zone->latStep);
    *latMax = arrondiMax (lat, zone->latStep);
@@ -367,16 +367,46 @@ static inline long indLon (double lon, const Zone *zone) {
    return (long) round ((lon - zone->lonLeft)/zone->lonStep);
 }
 
+/*! bilinear interpolation of u, v, g (gust), w (waves), msl, prate at point (lat, lon) between 4 grid points
+   p00 north west, p01 north east, p10 south east, p11 south west */
+static inline void interpolate4 (double lat, double lon, const FlowP *p00, const FlowP *p01, const FlowP *p10, const FlowP *p11,
+   double *u, double *v, double *g, double *w, double *msl, double *prate) {
+
+   double a, b;
+   a = interpolate (lon, p00->lon, p01->lon, p00->u, p01->u);
+   b = interpolate (lon, p10->lon, p11->lon, p10->u, p11->u); 
+   *u = interpolate (lat, p00->lat, p10->lat, a, b);
+   
+   a = interpolate (lon, p00->lon, p01->lon, p00->v, p01->v); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->v, p11->v); 
+   *v = interpolate (lat, p00->lat, p10->lat, a, b);
+   
+   a = interpolate (lon, p00->lon, p01->lon, p00->g, p01->g); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->g, p11->g); 
+   *g = interpolate (lat, p00->lat, p10->lat, a, b);
+    
+   a = interpolate (lon, p00->lon, p01->lon, p00->w, p01->w); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->w, p11->w); 
+   *w = interpolate (lat, p00->lat, p10->lat, a, b);
+    
+   a = interpolate (lon, p00->lon, p01->lon, p00->msl, p01->msl); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->msl, p11->msl); 
+   *msl = interpolate (lat, p00->lat, p10->lat, a, b);
+    
+   a = interpolate (lon, p00->lon, p01->lon, p00->prate, p01->prate); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->prate, p11->prate); 
+   *prate = interpolate (lat, p00->lat, p10->lat, a, b);
+}
+
 /*! interpolation to get u, v, g (gust), w (waves) at point (lat, lon)  and time t */
 static bool findFlow (double lat, double lon, double t, double *rU, double *rV, \
-   double *rG, double *rW, double *msl, double *prate, Zone *zone, const FlowP *gribData) {
+   double *rG, double *rW, double *msl, double *prate, const Par *par, const Zone *zone, const FlowP *gribData) {
 
    double t0,t1;
    double latMin, latMax, lonMin, lonMax;
-   double a, b, u0, u1, v0, v1, g0, g1, w0, w1, msl0, msl1, prate0, prate1;
+   double u0, u1, v0, v1, g0, g1, w0, w1, msl0, msl1, prate0, prate1;
    int iT0, iT1;
-   FlowP windP00, windP01, windP10, windP11;
-   if ((!zone->wellDefined) || (zone->nbLat == 0) || (! isInZone (lat, lon, zone) && par.constWindTws == 0) || (t < 0)){
+   if ((!zone->wellDefined) || (zone->nbLat == 0) || (! isInZone (lat, lon, zone) && par->constWindTws == 0) || (t < 0)){
       *rU = 0, *rV = 0, *rG = 0; *rW = 0;
       return false;
    }
@@ -384,73 +414,16 @@ static bool findFlow (double lat, double lon, double t, double *rU, double *rV,
    findTimeAround (t, &iT0, &iT1, zone);
    find4PointsAround (lat, lon, &latMin, &latMax, &lonMin, &lonMax, zone);
    //printf ("lat %lf iT0 %d, iT1 %d, latMin %lf latMax %lf lonMin %lf lonMax %lf\n", p.lat, iT0, iT1, latMin, latMax, lonMin, lonMax);  
-   // 4 points at time t0
-   windP00 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMin, zone)];  
-   windP01 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP10 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP11 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMin, zone)];
-
-   // printf ("00lat %lf  01lat %lf  10lat %lf 11lat %lf\n", windP00.lat, windP01.lat,windP10.lat,windP11.lat); 
-   // printf ("00tws %lf  01tws %lf  10tws %lf 11tws %lf\n", windP00.tws, windP01.tws,windP10.tws,windP11.tws); 
-   // speed longitude interpolation at northern latitudes
-  
-   // interpolation  for u, v, w, g, msl, prate
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.u, windP01.u);
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.u, windP11.u); 
-   u0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.v, windP01.v); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.v, windP11.v); 
-   v0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.g, windP01.g); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.g, windP11.g); 
-   g0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.w, windP01.w); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.w, windP11.w); 
-   w0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.msl, windP01.msl); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.msl, windP11.msl); 
-   msl0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.prate, windP01.prate); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.prate, windP11.prate); 
-   prate0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   //printf ("lat %lf a %lf  b %lf  00lat %lf 10lat %lf  %lf\n", p.lat, a, b, windP00.lat, windP10.lat, tws0); 
-
-   // 4 points at time t1
-   windP00 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMin, zone)];  
-   windP01 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP10 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP11 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMin, zone)];
-
-   // interpolatuon for  for u, v
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.u, windP01.u);
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.u, windP11.u); 
-   u1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.v, windP01.v); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.v, windP11.v); 
-   v1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.g, windP01.g); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.g, windP11.g); 
-   g1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.w, windP01.w); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.w, windP11.w); 
-   w1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.msl, windP01.msl); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.msl, windP11.msl); 
-   msl1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.prate, windP01.prate); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.prate, windP11.prate); 
-   prate1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
+   const long i00 = indLat(latMax, zone) * zone->nbLon + indLon(lonMin, zone);
+   const long i01 = indLat(latMax, zone) * zone->nbLon + indLon(lonMax, zone);
+   const long i10 = indLat(latMin, zone) * zone->nbLon + indLon(lonMax, zone);
+   const long i11 = indLat(latMin, zone) * zone->nbLon + indLon(lonMin, zone);
+
+   // 4 points at time t0 then at time t1
+   const FlowP *layer = &gribData [iT0 * zone->nbLat * zone->nbLon];
+   interpolate4 (lat, lon, &layer [i00], &layer [i01], &layer [i10], &layer [i11], &u0, &v0, &g0, &w0, &msl0, &prate0);
+   layer = &gribData [iT1 * zone->nbLat * zone->nbLon];
+   interpolate4 (lat, lon, &layer [i00], &layer [i01], &layer [i10], &layer [i11], &u1, &v1, &g1, &w1, &msl1, &prate1);
    
    // finally, interpolation twd tws between t0 and t1
    t0 = zone->timeStamp [iT0];
@@ -465,65 +438,180 @@ static bool findFlow (double lat, double lon, double t, double *rU, double *rV,
    return true;
 }
 
-/*! use findflow to get wind and waves */
-void findWindGrib (double lat, double lon, double t, double *u, double *v, \
-   double *gust, double *w, double *twd, double *tws ) {
+/*! copy in slice the grid points of gribData at the two time stamps around t, for the box latMin latMax lonMin lonMax
+   so that findWindSlice and findCurrentSlice avoid time search and read contiguous memory. Slice buffer is reused.
+   Return false if no slice (box crossing lonLeft or error): lookups then fall back to findFlow */
+bool flowSliceBuild (FlowSlice *slice, const Zone *zone, const FlowP *gribData, double t, 
+   double latMin, double latMax, double lonMin, double lonMax) {
+
+   double bLatMin, bLatMax, bLonMin, bLonMax, bidon;
+   int iT0, iT1;
+   slice->valid = false;
+   if ((!zone->wellDefined) || (zone->nbLat == 0) || (gribData == NULL) || (t < 0))
+      return false;
+
+   findTimeAround (t, &iT0, &iT1, zone);
+   find4PointsAround (latMin, lonMin, &bLatMin, &bidon, &bLonMin, &bidon, zone);
+   find4PointsAround (latMax, lonMax, &bidon, &bLatMax, &bidon, &bLonMax, zone);
+   const long iLat0 = indLat (bLatMin, zone), iLat1 = indLat (bLatMax, zone);
+   const long iLon0 = indLon (bLonMin, zone), iLon1 = indLon (bLonMax, zone);
+   if ((iLat0 < 0) || (iLat0 > iLat1) || (iLat1 >= zone->nbLat) || (iLon0 < 0) || (iLon0 > iLon1) || (iLon1 >= zone->nbLon))
+      return false;
+
+   const long nLat = iLat1 - iLat0 + 1, nLon = iLon1 - iLon0 + 1;
+   const size_t n = 2 * nLat * nLon;
+   if (n > slice->nAlloc) {
+      FlowP *node = realloc (slice->node, n * sizeof (FlowP));
+      if (node == NULL) {
+         fprintf (stderr, "In flowSliceBuild, Error realloc: %zu points\n", n);
+         return false;
+      }
+      slice->node = node;
+      slice->nAlloc = n;
+   }
+   const FlowP *layer0 = &gribData [iT0 * zone->nbLat * zone->nbLon];
+   const FlowP *layer1 = &gribData [iT1 * zone->nbLat * zone->nbLon];
+   FlowP *dst = slice->node;
+   for (long i = iLat0; i <= iLat1; i++) {
+      for (long j = iLon0; j <= iLon1; j++) {
+         *dst++ = layer0 [i * zone->nbLon + j];
+         *dst++ = layer1 [i * zone->nbLon + j];
+      }
+   }
+   slice->t = t;
+   slice->t0 = zone->timeStamp [iT0];
+   slice->t1 = zone->timeStamp [iT1];
+   slice->iLat0 = iLat0;
+   slice->iLon0 = iLon0;
+   slice->nLat = nLat;
+   slice->nLon = nLon;
+   slice->valid = true;
+   return true;
+}
+
+/*! free slice buffer */
+void flowSliceFree (FlowSlice *slice) {
+   free (slice->node);
+   memset (slice, 0, sizeof (FlowSlice));
+}
+
+/*! same as findFlow, reading grid points in slice if slice has been built for time t and contains them */
+static bool findFlowSlice (const FlowSlice *slice, double lat, double lon, double t, double *rU, double *rV, \
+   double *rG, double *rW, double *msl, double *prate, const Par *par, const Zone *zone, const FlowP *gribData) {
+
+   double latMin, latMax, lonMin, lonMax;
+   double u0, u1, v0, v1, g0, g1, w0, w1, msl0, msl1, prate0, prate1;
+   if ((slice == NULL) || (! slice->valid) || (t != slice->t))
+      return findFlow (lat, lon, t, rU, rV, rG, rW, msl, prate, par, zone, gribData);
+   if ((!zone->wellDefined) || (zone->nbLat == 0) || (! isInZone (lat, lon, zone) && par->constWindTws == 0) || (t < 0)){
+      *rU = 0, *rV = 0, *rG = 0; *rW = 0;
+      return false;
+   }
+   find4PointsAround (lat, lon, &latMin, &latMax, &lonMin, &lonMax, zone);
+   const long iNorth = indLat (latMax, zone) - slice->iLat0, iSouth = indLat (latMin, zone) - slice->iLat0;
+   const long iWest = indLon (lonMin, zone) - slice->iLon0, iEast = indLon (lonMax, zone) - slice->iLon0;
+   if ((iSouth < 0) || (iNorth >= slice->nLat) || (iWest < 0) || (iEast >= slice->nLon) || (iWest > iEast) || (iSouth > iNorth))
+      return findFlow (lat, lon, t, rU, rV, rG, rW, msl, prate, par, zone, gribData);
+
+   const FlowP *p00 = &slice->node [2 * (iNorth * slice->nLon + iWest)];
+   const FlowP *p01 = &slice->node [2 * (iNorth * slice->nLon + iEast)];
+   const FlowP *p10 = &slice->node [2 * (iSouth * slice->nLon + iEast)];
+   const FlowP *p11 = &slice->node [2 * (iSouth * slice->nLon + iWest)];
+   interpolate4 (lat, lon, p00, p01, p10, p11, &u0, &v0, &g0, &w0, &msl0, &prate0);
+   interpolate4 (lat, lon, p00 + 1, p01 + 1, p10 + 1, p11 + 1, &u1, &v1, &g1, &w1, &msl1, &prate1);
+
+   *rU = interpolate (t, slice->t0, slice->t1, u0, u1);
+   *rV = interpolate (t, slice->t0, slice->t1, v0, v1);
+   *rG = interpolate (t, slice->t0, slice->t1, g0, g1);
+   *rW = interpolate (t, slice->t0, slice->t1, w0, w1);
+   *msl = interpolate (t, slice->t0, slice->t1, msl0, msl1);
+   *prate = interpolate (t, slice->t0, slice->t1, prate0, prate1);
+   return true;
+}
+
+/*! use findFlowSlice to get wind and waves from explicit parameters, zone, grib data and slice (may be NULL). Re-entrant */
+void findWindSlice (const FlowSlice *slice, const Par *par, const Zone *zone, const FlowP *gribData, double lat, double lon, double t, 
+   double *u, double *v, double *gust, double *w, double *twd, double *tws) {
    double msl, prate;
-   if (par.constWindTws != 0) {
-      *twd = par.constWindTwd;
-      *tws = par.constWindTws;
-	   *u = - KN_TO_MS * par.constWindTws * sin (DEG_TO_RAD * par.constWindTwd);
-	   *v = - KN_TO_MS * par.constWindTws * cos (DEG_TO_RAD * par.constWindTwd);
+   if (par->constWindTws != 0) {
+      *twd = par->constWindTwd;
+      *tws = par->constWindTws;
+	   *u = - KN_TO_MS * par->constWindTws * sin (DEG_TO_RAD * par->constWindTwd);
+	   *v = - KN_TO_MS * par->constWindTws * cos (DEG_TO_RAD * par->constWindTwd);
       *w = 0;
       *gust = hypot (*u, *v); // m/s
    }
    else {
-      findFlow (lat, lon, t, u, v, gust, w, &msl, &prate,  &zone, tGribData [WIND]);
+      findFlowSlice (slice, lat, lon, t, u, v, gust, w, &msl, &prate, par, zone, gribData);
       *twd = fTwd (*u, *v);
       *tws = fTws (*u, *v);
    }
-   if (par.constWave < 0) *w = 0;
-   else if (par.constWave != 0) *w = par.constWave;
+   if (par->constWave < 0) *w = 0;
+   else if (par->constWave != 0) *w = par->constWave;
+}
+
+/*! use findflow to get wind and waves from explicit parameters, zone and grib data. Re-entrant */
+void findWindFlow (const Par *par, const Zone *zone, const FlowP *gribData, double lat, double lon, double t, 
+   double *u, double *v, double *gust, double *w, double *twd, double *tws) {
+   findWindSlice (NULL, par, zone, gribData, lat, lon, t, u, v, gust, w, twd, tws);
+}
+
+/*! use findflow to get wind and waves */
+void findWindGrib (double lat, double lon, double t, double *u, double *v, \
+   double *gust, double *w, double *twd, double *tws ) {
+   findWindFlow (&par, &zone, tGribData [WIND], lat, lon, t, u, v, gust, w, twd, tws);
 }
 
 /*! use findflow to get rain */
 double findRainGrib (double lat, double lon, double t) {
    double u, v, g, w, msl, prate;
-   findFlow (lat, lon, t, &u, &v, &g, &w, &msl, &prate, &zone, tGribData [WIND]);
+   findFlow (lat, lon, t, &u, &v, &g, &w, &msl, &prate, &par, &zone, tGribData [WIND]);
    return prate;
 }
 
 /*! use findflow to get pressure */
 double findPressureGrib (double lat, double lon, double t) {
    double u, v, g, w, msl, prate;
-   findFlow (lat, lon, t, &u, &v, &g, &w, &msl, &prate, &zone, tGribData [WIND]);
+   findFlow (lat, lon, t, &u, &v, &g, &w, &msl, &prate, &par, &zone, tGribData [WIND]);
    return msl;
 }
 
-/*! use findflow to get current */
-void findCurrentGrib (double lat, double lon, double t, double *uCurr,\
-   double *vCurr, double *tcd, double *tcs) {
+/*! use findFlowSlice to get current from explicit parameters, zone, grib data and slice (may be NULL). Re-entrant */
+void findCurrentSlice (const FlowSlice *slice, const Par *par, const Zone *currentZone, const FlowP *gribData, double lat, double lon, double t, 
+   double *uCurr, double *vCurr, double *tcd, double *tcs) {
 
    double gust, bidon, msl, prate;
    *uCurr = 0;
    *vCurr = 0;
    *tcd = 0;
    *tcs = 0;
-   if (par.constCurrentS != 0) {
-      *uCurr = -KN_TO_MS * par.constCurrentS * sin (DEG_TO_RAD * par.constCurrentD);
-      *vCurr = -KN_TO_MS * par.constCurrentS * cos (DEG_TO_RAD * par.constCurrentD);
-      *tcd = par.constCurrentD; // direction
-      *tcs = par.constCurrentS; // speed
+   if (par->constCurrentS != 0) {
+      *uCurr = -KN_TO_MS * par->constCurrentS * sin (DEG_TO_RAD * par->constCurrentD);
+      *vCurr = -KN_TO_MS * par->constCurrentS * cos (DEG_TO_RAD * par->constCurrentD);
+      *tcd = par->constCurrentD; // direction
+      *tcs = par->constCurrentS; // speed
    }
    else {
-      if (t <= currentZone.timeStamp [currentZone.nTimeStamp - 1]) {
-         findFlow (lat, lon, t, uCurr, vCurr, &gust, &bidon, &msl, &prate, &currentZone, tGribData [CURRENT]);
+      if (t <= currentZone->timeStamp [currentZone->nTimeStamp - 1]) {
+         findFlowSlice (slice, lat, lon, t, uCurr, vCurr, &gust, &bidon, &msl, &prate, par, currentZone, gribData);
          *tcd = fTwd (*uCurr, *vCurr);
          *tcs = fTws (*uCurr, *vCurr);
       }
    }
 }
 
+/*! use findflow to get current from explicit parameters, zone and grib data. Re-entrant */
+void findCurrentFlow (const Par *par, const Zone *currentZone, const FlowP *gribData, double lat, double lon, double t, 
+   double *uCurr, double *vCurr, double *tcd, double *tcs) {
+   findCurrentSlice (NULL, par, currentZone, gribData, lat, lon, t, uCurr, vCurr, tcd, tcs);
+}
+
+/*! use findflow to get current */
+void findCurrentGrib (double lat, double lon, double t, double *uCurr,\
+   double *vCurr, double *tcd, double *tcs) {
+   findCurrentFlow (&par, &currentZone, tGribData [CURRENT], lat, lon, t, uCurr, vCurr, tcd, tcs);
+}
+
 /*! Modify array with new value if not already in array. Return new array size*/
 static long updateLong (long value, size_t n, size_t maxSize, long array []) {
    bool found = false;
@@ -1,12 +1,30 @@
 /*! grib data description */
+#define  GRIB_CACHE_SUFFIX    ".r3c"      // cache file of readGribStore is grib file name + suffix
+
 extern FlowP *tGribData [];            // wind, current
 
 extern double  zoneTimeDiff (const Zone *zone1, const Zone *zone0);
 extern void    findWindGrib (double lat, double lon, double t, double *u, double *v, double *gust, double *w, double *twd, double *tws );
+extern void    findWindFlow (const Par *par, const Zone *zone, const FlowP *gribData, double lat, double lon, double t,
+                             double *u, double *v, double *gust, double *w, double *twd, double *tws);
+extern void    findWindSlice (const FlowSlice *slice, const Par *par, const Zone *zone, const FlowP *gribData, double lat, double lon, double t,
+                              double *u, double *v, double *gust, double *w, double *twd, double *tws);
+extern bool    flowSliceBuild (FlowSlice *slice, const Zone *zone, const FlowP *gribData, double t,
+                               double latMin, double latMax, double lonMin, double lonMax);
+extern void    flowSliceFree (FlowSlice *slice);
 extern double  findRainGrib (double lat, double lon, double t);
 extern double  findPressureGrib (double lat, double lon, double t);
 extern void    findCurrentGrib (double lat, double lon, double t, double *uCurr, double *vCurr, double *tcd, double *tcs);
+extern void    findCurrentFlow (const Par *par, const Zone *currentZone, const FlowP *gribData, double lat, double lon, double t,
+                                double *uCurr, double *vCurr, double *tcd, double *tcs);
+extern void    findCurrentSlice (const FlowSlice *slice, const Par *par, const Zone *currentZone, const FlowP *gribData, double lat, double lon,
+                                 double t, double *uCurr, double *vCurr, double *tcd, double *tcs);
+extern bool    gribThreadSafe (void);
+extern bool    readGribStore (const char *fileName, int nThreads, Zone *zone, GribStore *store);
+extern void    gribStoreFree (GribStore *store);
 extern bool    readGribAll (const char *fileName, Zone *zone, int iFlow);
+extern bool    readGribAllFlows (GribLoad load [], int n);
+extern void    gribDataFree (int iFlow);
 extern char    *gribToStr (const Zone *zone, char *str, size_t maxLen);
 extern void    printGrib (const Zone *zone, const FlowP *gribData);
 extern bool    checkGribInfoToStr (int type, Zone *zone, char *buffer, size_t maxLen);
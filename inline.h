@@ -3,12 +3,54 @@
 
 #include <math.h>
 
-/*! say if point is in sea */
-static inline bool isSea (char * isSeaArray, double lat, double lon) {
+/*! say if point is in sea. isSeaArray is bit-packed: bit (k & 7) of byte k >> 3 for cell k */
+static inline bool isSea (const char * isSeaArray, double lat, double lon) {
    if (isSeaArray == NULL) return true;
    int iLon = round (lon * 10  + 1800);
    int iLat = round (-lat * 10  + 900);
-   return isSeaArray [(iLat * 3601) + iLon];
+   int k = (iLat * 3601) + iLon;
+   return (((const unsigned char *) isSeaArray) [k >> 3] >> (k & 7)) & 1;
+}
+
+/*! say if segment from P0 (lat0, lon0) to P1 (lat1, lon1) stays in sea: every cell of isSeaArray crossed
+   by the segment is tested, walking cells in order of crossing (Amanatides Woo grid traversal).
+   Cell of a grid node covers +/- 0.05 degree around it, as in isSea. Only P1 tested if segment leaves grid */
+static inline bool isSeaSegment (const char * isSeaArray, double lat0, double lon0, double lat1, double lon1) {
+   if (isSeaArray == NULL) return true;
+   const double x0 = lon0 * 10 + 1800, y0 = -lat0 * 10 + 900;
+   const double x1 = lon1 * 10 + 1800, y1 = -lat1 * 10 + 900;
+   int iX = round (x0), iY = round (y0);
+   const int iX1 = round (x1), iY1 = round (y1);
+   if ((MIN (iX, iX1) < 0) || (MAX (iX, iX1) > 3600) || (MIN (iY, iY1) < 0) || (MAX (iY, iY1) > 1800))
+      return isSea (isSeaArray, lat1, lon1);
+   const double dX = x1 - x0, dY = y1 - y0;
+   const int stepX = (dX > 0) ? 1 : -1, stepY = (dY > 0) ? 1 : -1;
+   const double tDeltaX = (dX != 0) ? stepX / dX : INFINITY;           // segment parameter to cross one cell
+   const double tDeltaY = (dY != 0) ? stepY / dY : INFINITY;
+   double tMaxX = (dX != 0) ? (iX + 0.5 * stepX - x0) / dX : INFINITY; // segment parameter of next cell border
+   double tMaxY = (dY != 0) ? (iY + 0.5 * stepY - y0) / dY : INFINITY;
+   const unsigned char *cell = (const unsigned char *) isSeaArray;
+
+   for (int n = ABS (iX1 - iX) + ABS (iY1 - iY); n > 0; n--) {
+      const int k = iY * 3601 + iX;
+      if (! ((cell [k >> 3] >> (k & 7)) & 1))
+         return false;
+      if ((tMaxX == tMaxY) && (iX != iX1) && (iY != iY1)) {      // through a corner: cell beside diagonal too
+         const int kSide = k + stepX;
+         if (! ((cell [kSide >> 3] >> (kSide & 7)) & 1))
+            return false;
+      }
+      if ((iY == iY1) || ((iX != iX1) && (tMaxX < tMaxY))) {     // never pass target row or column
+         iX += stepX;
+         tMaxX += tDeltaX;
+      }
+      else {
+         iY += stepY;
+         tMaxY += tDeltaY;
+      }
+   }
+   const int k = iY1 * 3601 + iX1;
+   return (cell [k >> 3] >> (k & 7)) & 1;
 }
 
 /*! return lon on ]-180, 180 ] interval */
@@ -31,10 +73,25 @@ static inline double lonNormalize (double lon, bool anteMeridian) {
 }
 
 /*! true if P (lat, lon) is within the zone */
-static inline bool isInZone (double lat, double lon, Zone *zone) {
+static inline bool isInZone (double lat, double lon, const Zone *zone) {
    return (lat >= zone->latMin) && (lat <= zone->latMax) && (lon >= zone->lonLeft) && (lon <= zone->lonRight);
 }
 
+/*! true if day light at time t (hours after grib reference time), table version of isDayLight.
+   Day if table dl not built */
+static inline bool isDayLightFast (const DayLight *dl, double t, double lat, double lon) {
+   if (dl->nDays <= 0) return true;
+   const double solar = dl->hour0 + t + lonCanonize (lon) / 15.0;
+   const double day = floor (solar / 24.0);
+   const double hour = solar - 24.0 * day;
+   int d = (int) day - dl->firstDay;
+   d = (d < 0) ? 0 : (d >= dl->nDays) ? dl->nDays - 1 : d;
+   int band = (int) lround (lat) + 90;
+   band = (band < 0) ? 0 : (band >= N_DAY_LIGHT_LAT) ? N_DAY_LIGHT_LAT - 1 : band;
+   const int k = d * N_DAY_LIGHT_LAT + band;
+   return (hour >= dl->sunRise [k]) && (hour < dl->sunSet [k]);
+}
+
 /*! true wind direction */
 static inline double fTwd (double u, double v) {
 	double val = 180 + RAD_TO_DEG * atan2 (u, v);
@@ -91,6 +148,36 @@ static inline double orthoCap (double lat1, double lon1, double lat2, double lon
     return cap + givryCorrection;
 }
 
+/*! sine and cosine of angle in degrees. Branch free polynomial kernels (fdlibm) after reduction to [-45, 45]
+   so that loops calling it are vectorized by compiler. Absolute error about 1e-15 for |deg| < 1000 */
+static inline void fastSinCosDeg (double deg, double *s, double *c) {
+   const int q = (int) (deg / 90.0 + 1024.5) - 1024;              // nearest quadrant, no floor for vectorization
+   const double r = (deg - 90.0 * q) * DEG_TO_RAD;
+   const double z = r * r;
+   const double sr = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 
+      + z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+   const double cr = 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05
+      + z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+   const int quadrant = q & 3;
+   *s = (quadrant == 0) ? sr : (quadrant == 1) ? cr : (quadrant == 2) ? -sr : -cr;
+   *c = (quadrant == 0) ? cr : (quadrant == 1) ? -sr : (quadrant == 2) ? -cr : sr;
+}
+
+/*! arc cosine in radians of x in [-1, 1]. Branch free rational approximation (fdlibm) so that loops
+   calling it are vectorized by compiler. Absolute error below 1e-15 */
+static inline double fastAcos (double x) {
+   const double a = fabs (x);
+   const bool small = (a <= 0.5);
+   const double z = small ? x * x : 0.5 * (1.0 - a);
+   const double s = small ? x : sqrt (z);
+   const double p = z * (1.66666666666666657415e-01 + z * (-3.25565818622400915405e-01 + z * (2.01212532134862925881e-01
+      + z * (-4.00555345006794114027e-02 + z * (7.91534994289814532176e-04 + z * 3.47933107596021167570e-05)))));
+   const double q = 1.0 + z * (-2.40339491173441421878e+00 + z * (2.02094576023350569471e+00 + z * (-6.88283971605453293030e-01
+      + z * 7.70381505559019352791e-02)));
+   const double asinS = s + s * p / q;                           // asin (s)
+   return small ? G_PI_2 - asinS : (x > 0) ? 2.0 * asinS : G_PI - 2.0 * asinS;
+}
+
 /*! return initial orthodromic cap from origin to destination, no givry correction */
 static inline double orthoCap2 (double lat1, double lon1, double lat2, double lon2) {
     lat1 *= DEG_TO_RAD;
@@ -202,8 +289,9 @@ static inline int binarySearch (const double *arr, int size, double val) {
    return low;  // ✅ `low` est maintenant le premier indice où `arr[low] > val`
 }
 
-/*! find in polar boat speed or wave coeff and sail number if sailMat != NULL */
-static inline double findPolar (double twa, double w, const PolMat *mat, const PolMat *sailMat, int *sail) {
+/*! find in polar boat speed or wave coeff and sail number if sailMat != NULL
+    bilinear interpolation in polar matrix t. Reference for compiled grid */
+static inline double findPolarInMat (double twa, double w, const PolMat *mat, const PolMat *sailMat, int *sail) {
    const int nLine = mat->nLine;   // local copy for perf
    const int nCol = mat->nCol; 
    int l, c, lInf, cInf, lSup, cSup;
@@ -249,6 +337,49 @@ static inline double findPolar (double twa, double w, const PolMat *mat, const P
    return s0 + (w - mat->t [0][cInf]) * (s1 - s0) / (mat->t [0][cSup] - mat->t [0][cInf]);
 }
 
+/*! find in polar boat speed or wave coeff and sail number if sailMat != NULL
+    constant time bilinear read in compiled grid when w is covered, else findPolarInMat */
+static inline double findPolar (double twa, double w, const PolMat *mat, const PolMat *sailMat, int *sail) {
+   if ((mat->grid == NULL) || (w < 0.0) || (w >= mat->gridMaxW))
+      return findPolarInMat (twa, w, mat, sailMat, sail);
+
+   if (twa > 180.0) twa = 360.0 - twa;
+   else if (twa < 0.0) twa = -twa;
+
+   const double x = twa * (1.0 / POL_GRID_TWA_STEP);
+   const double y = w * (1.0 / POL_GRID_W_STEP);
+   int i = (int) x;
+   int j = (int) y;
+   if (i > mat->nGridLine - 2) i = mat->nGridLine - 2;
+   if (j > mat->nGridCol - 2) j = mat->nGridCol - 2;
+
+   // sail: same choice as findPolarInMat with lines and cols found from index tables
+   if (sailMat != NULL && sailMat->nLine == mat->nLine && sailMat->nCol == mat->nCol) {
+      const int nLine = mat->nLine;
+      const int nCol = mat->nCol;
+      int l = mat->lIndex [i];
+      int c = mat->cIndex [j];
+      while ((l < nLine) && (mat->t [l][0] <= twa)) l += 1;
+      while ((c < nCol - 1) && (mat->t [0][c] <= w)) c += 1;
+      const int lSup = (l < nLine - 1) ? l : nLine - 1;
+      const int lInf = (l == 1) ? 1 : l - 1;
+      const int cSup = (c < nCol - 1) ? c : nCol - 1;
+      const int cInf = (c == 1) ? 1 : c - 1;
+      const int bestL = ((twa - mat->t [lInf][0]) < (mat->t [lInf][0] - twa)) ? lInf : lSup;
+      const int bestC = ((w - mat->t [0][cInf]) < (mat->t [0][cSup] - twa)) ? cInf : cSup;
+      *sail = sailMat->t [bestL][bestC];
+   }
+   else *sail = 0;
+
+   const double fx = x - i;
+   const double fy = y - j;
+   const double *g0 = &mat->grid [i * mat->nGridCol + j];
+   const double *g1 = g0 + mat->nGridCol;
+   const double s0 = g0 [0] + fy * (g0 [1] - g0 [0]);
+   const double s1 = g1 [0] + fy * (g1 [1] - g1 [0]);
+   return s0 + fx * (s1 - s0);
+}
+
 /*! return max speed of boat at tws for all twa */
 static inline double oldMaxSpeedInPolarAt (double tws, const PolMat *mat) {
    double max = 0.0;
@@ -263,8 +394,8 @@ static inline double oldMaxSpeedInPolarAt (double tws, const PolMat *mat) {
    return max;
 }
 
-/*! return max speed of boat at tws for all twa */
-static inline double maxSpeedInPolarAt (double tws, const PolMat *mat) {
+/*! return max speed of boat at tws for all twa in polar matrix t */
+static inline double maxSpeedInPolarMatAt (double tws, const PolMat *mat) {
    double max = 0.0;
    double s0, s1, speed;
    const int nCol = mat->nCol; 
@@ -282,4 +413,17 @@ static inline double maxSpeedInPolarAt (double tws, const PolMat *mat) {
    return max;
 }
 
+/*! return max speed of boat at tws for all twa. Linear read in compiled grid when tws is covered 
+    under first tws of polar, maxSpeedInPolarMatAt is not continuous and is used */
+static inline double maxSpeedInPolarAt (double tws, const PolMat *mat) {
+   if ((mat->grid == NULL) || (tws < 0.0) || (tws >= mat->gridMaxW))
+      return maxSpeedInPolarMatAt (tws, mat);
+   const double y = tws * (1.0 / POL_GRID_W_STEP);
+   int j = (int) y;
+   if (j > mat->nGridCol - 2) j = mat->nGridCol - 2;
+   if (j * POL_GRID_W_STEP < mat->t [0][1])
+      return maxSpeedInPolarMatAt (tws, mat);
+   return mat->gridMax [j] + (y - j) * (mat->gridMax [j + 1] - mat->gridMax [j]);
+}
+
 
@@ -249,12 +249,21 @@ void optionManage (char option) {
       if (scanf ("%lf", &t) < 1) break;
       start = clock();
       for (long i = 0; i < iterations; i++) {
-        struct tm localTm = tm0;
-        intRes = isDayLight (&localTm, t, lat, lon);;
+        intRes = isDayLight (&tm0, t, lat, lon);
       }
       end = clock();
       printf("isDayLight:      %.2f, last result = %d\n", 
            (double)(end - start) * 1000.0 / CLOCKS_PER_SEC, intRes);
+      DayLight dayLight = {0};
+      dayLightBuild (&dayLight, zone.dataDate [0], zone.dataTime [0], zone.timeStamp [zone.nTimeStamp - 1]);
+      start = clock();
+      for (long i = 0; i < iterations; i++) {
+        intRes = isDayLightFast (&dayLight, t, lat, lon);
+      }
+      end = clock();
+      printf("isDayLightFast:  %.2f, last result = %d\n", 
+           (double)(end - start) * 1000.0 / CLOCKS_PER_SEC, intRes);
+      dayLightFree (&dayLight);
 
       break;
    case 'T': // test
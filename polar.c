@@ -87,6 +87,72 @@ static bool polarCheck (PolMat *mat, char *report, size_t maxLen) {
    return (report [0] == '\0'); // True if no error found
 }
 
+/*! free compiled grid of polar */
+void polarGridFree (PolMat *mat) {
+   free (mat->grid);
+   free (mat->gridMax);
+   free (mat->lIndex);
+   free (mat->cIndex);
+   mat->grid = mat->gridMax = NULL;
+   mat->lIndex = mat->cIndex = NULL;
+   mat->nGridLine = mat->nGridCol = 0;
+   mat->gridMaxW = mat->gridErr = 0.0;
+}
+
+/*! compile polar matrix in dense grid read by findPolar and maxSpeedInPolarAt 
+   measure max error between grid and matrix interpolation at center of each grid cell
+   return false if no grid compiled */
+static bool polarCompile (PolMat *mat) {
+   int bidon;
+   polarGridFree (mat);
+   if ((mat->nLine < 2) || (mat->nCol < 2) || (mat->t [0][mat->nCol - 1] <= 0))
+      return false;
+
+   const int nGridLine = (int) (180.0 / POL_GRID_TWA_STEP) + 1;
+   const int nGridCol = (int) (mat->t [0][mat->nCol - 1] / POL_GRID_W_STEP) + 1;
+   if (nGridCol < 2)
+      return false;
+
+   mat->grid = malloc (nGridLine * nGridCol * sizeof (double));
+   mat->gridMax = malloc (nGridCol * sizeof (double));
+   mat->lIndex = malloc (nGridLine * sizeof (int));
+   mat->cIndex = malloc (nGridCol * sizeof (int));
+   if (! mat->grid || ! mat->gridMax || ! mat->lIndex || ! mat->cIndex) {
+      fprintf (stderr, "In polarCompile: error in memory allocation\n");
+      polarGridFree (mat);
+      return false;
+   }
+   for (int i = 0; i < nGridLine; i += 1) {
+      double twa = i * POL_GRID_TWA_STEP;
+      int l;
+      for (l = 1; l < mat->nLine; l++)
+         if (mat->t [l][0] > twa) break;
+      mat->lIndex [i] = l;
+      for (int j = 0; j < nGridCol; j += 1)
+         mat->grid [i * nGridCol + j] = findPolarInMat (twa, j * POL_GRID_W_STEP, mat, NULL, &bidon);
+   }
+   for (int j = 0; j < nGridCol; j += 1) {
+      mat->cIndex [j] = binarySearch (&mat->t [0][0], mat->nCol - 1, j * POL_GRID_W_STEP);
+      mat->gridMax [j] = maxSpeedInPolarMatAt (j * POL_GRID_W_STEP, mat);
+   }
+   mat->nGridLine = nGridLine;
+   mat->nGridCol = nGridCol;
+   mat->gridMaxW = (nGridCol - 1) * POL_GRID_W_STEP;
+
+   double err = 0.0;
+   for (int i = 0; i < nGridLine - 1; i += 1) {
+      for (int j = 0; j < nGridCol - 1; j += 1) {
+         double twa = (i + 0.5) * POL_GRID_TWA_STEP;
+         double w = (j + 0.5) * POL_GRID_W_STEP;
+         err = MAX (err, fabs (findPolar (twa, w, mat, NULL, &bidon) - findPolarInMat (twa, w, mat, NULL, &bidon)));
+         if (i == 0)
+            err = MAX (err, fabs (maxSpeedInPolarAt (w, mat) - maxSpeedInPolarMatAt (w, mat)));
+      }
+   }
+   mat->gridErr = err;
+   return true;
+}
+
 /*! read polar file and fill poLMat matrix 
    if check then polarCheck */
 bool readPolar (bool check, const char *fileName, PolMat *mat, char *errMessage, size_t maxLen) {
@@ -98,6 +164,7 @@ bool readPolar (bool check, const char *fileName, PolMat *mat, char *errMessage,
    int c;
 
    errMessage [0] = '\0';
+   polarGridFree (mat);
    mat->nLine = 0;
    mat->nCol = 0;
    if ((f = fopen (fileName, "r")) == NULL) {
@@ -138,6 +205,7 @@ bool readPolar (bool check, const char *fileName, PolMat *mat, char *errMessage,
    fclose (f);
    if (check)
       polarCheck (mat, errMessage, maxLen);
+   polarCompile (mat);
    return true;
 }
 
@@ -197,6 +265,10 @@ char *polToStr (const PolMat *mat, char *str, size_t maxLen) {
    g_strlcat (str, line, maxLen);
    snprintf (line, MAX_SIZE_LINE, "Max                     : %.2lf\n", maxValInPol (mat));
    g_strlcat (str, line, maxLen);
+   if (mat->grid != NULL) {
+      snprintf (line, MAX_SIZE_LINE, "Compiled grid           : %d x %d, max error: %.6lf\n", mat->nGridLine, mat->nGridCol, mat->gridErr);
+      g_strlcat (str, line, maxLen);
+   }
    return str;
 }
 
@@ -204,7 +276,7 @@ char *polToStr (const PolMat *mat, char *str, size_t maxLen) {
 GString *polToJson (const char *fileName, const char *objName) {
    char polarName [MAX_SIZE_FILE_NAME];
    char errMessage [MAX_SIZE_LINE];
-   PolMat mat;
+   PolMat mat = {0};
    GString *jString = g_string_new ("");
    buildRootName (fileName, polarName, sizeof (polarName));
 
@@ -216,6 +288,7 @@ GString *polToJson (const char *fileName, const char *objName) {
    if ((mat.nLine < 2) || (mat.nCol < 2)) {
       fprintf (stderr, "In polToJson Error: no value in: %s\n", polarName);
       g_string_append_printf (jString, "{}\n");
+      polarGridFree (&mat);
       return jString;
    }
    g_string_append_printf (jString, "{\"%s\": \"%s\", \"nLine\": %d, \"nCol\":%d, \"max\":%.2lf, \"array\":\n[\n", 
@@ -229,6 +302,7 @@ GString *polToJson (const char *fileName, const char *objName) {
       g_string_append_printf (jString, "%.4f]%s\n", mat.t [i][mat.nCol -1], (i < mat.nLine - 1) ? "," : "");
    }
    g_string_append_printf (jString, "]}\n");
+   polarGridFree (&mat);
    return jString;
 }
 
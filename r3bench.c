@@ -0,0 +1,422 @@
+/*! \brief Benchmark of routing engine on fixed synthetic scenarios
+ * \li compilation: see ccb file
+ * \li usage: ./r3bench [-v] [-s] [-l] [-n <runs>] [-t <nThreads>] [-g <grib file>] [<scenario> ...]
+ * \li scenarios: coastal, ocean, waypoints, current, forbid. All if none given
+ * \li wind and current are analytic fields written in synthetic grib data, polar is generated
+ * \li coastal scenario sails around a cape of a synthetic land mask, the others are all sea
+ * \li each scenario runs in a forked child: peakMemoryKB is the one of this scenario, runMemoryKB what it added
+ * \li output: one JSON object per line, one line per scenario, so that results can be compared between versions
+ * \li -s: scalar heading sweep instead of vectorized one, to measure the speedup
+ * \li -l: land mask crossed by whole segment of each step, not only its end (SEGMENT_SEA), to measure its cost per step
+ * \li -g: measure also the load time of a real grib file with readGribAll, first decoded after removal
+ *     of its cache file (grib file name + GRIB_CACHE_SUFFIX), then mapped from the cache file written
+ * \li messages of engine on stdout are dropped unless -v */
+
+#define _POSIX_C_SOURCE 200809L // for getopt with -std=c11
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <float.h>
+#include <unistd.h>
+#include <time.h>
+#include <locale.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "rtypes.h"
+#include "r3util.h"
+#include "engine.h"
+#include "grib.h"
+#include "polar.h"
+
+#define SYNOPSYS          "[-v] [-s] [-l] [-n <runs>] [-t <nThreads>] [-g <grib file>] [<scenario> ...]"
+#define BENCH_LAT_MIN     30.0        // synthetic grib zone
+#define BENCH_LAT_MAX     60.0
+#define BENCH_LON_LEFT    -40.0
+#define BENCH_LON_RIGHT   0.0
+#define BENCH_STEP        0.5         // degrees
+#define BENCH_TIME_STEP   3           // hours between grib time stamps
+#define BENCH_N_TIME      81          // 240 hours
+#define BENCH_POLAR       "r3bench.csv"
+
+/*! description of one benchmark scenario */
+typedef struct {
+   const char *name;
+   double latOr, lonOr;
+   double latDest, lonDest;
+   int    nWp;
+   double wp [2][2];                   // lat, lon
+   bool   withCurrent;
+   bool   withLand;                    // synthetic land mask, else all sea
+   int    nForbid;                     // number of points of forbid polygon
+   double forbid [4][2];               // lat, lon
+} BenchScenario;
+
+static const BenchScenario scenarios [] = {
+   {.name = "coastal",   .latOr = 46.0, .lonOr = -5.0, .latDest = 44.5, .lonDest = -9.0, .withLand = true},
+   {.name = "ocean",     .latOr = 46.0, .lonOr = -5.0, .latDest = 40.0, .lonDest = -25.0},
+   {.name = "waypoints", .latOr = 46.0, .lonOr = -5.0, .latDest = 44.5, .lonDest = -9.0,
+                         .nWp = 2, .wp = {{44.0, -15.0}, {42.0, -12.0}}},
+   {.name = "current",   .latOr = 46.0, .lonOr = -5.0, .latDest = 44.0, .lonDest = -10.0, .withCurrent = true},
+   {.name = "forbid",    .latOr = 46.0, .lonOr = -5.0, .latDest = 44.0, .lonDest = -10.0,
+                         .nForbid = 4, .forbid = {{44.5, -8.0}, {46.0, -8.0}, {46.0, -6.5}, {44.5, -6.5}}}
+};
+
+/*! monotonic time in seconds */
+static double monotonicTime (void) {
+   return g_get_monotonic_time () / 1000000.0;
+}
+
+/*! peak resident memory of process in KB */
+static long peakMemoryKB (void) {
+   struct rusage usage;
+   if (getrusage (RUSAGE_SELF, &usage) != 0)
+      return -1;
+   return usage.ru_maxrss;
+}
+
+/*! current resident memory of process in KB */
+static long currentMemoryKB (void) {
+   char line [MAX_SIZE_LINE];
+   long mem = -1;
+   FILE *f = fopen ("/proc/self/status", "r");
+   if (f == NULL)
+      return -1;
+   while (fgets (line, sizeof (line), f) != NULL)
+      if (sscanf (line, "VmRSS: %ld", &mem) == 1)
+         break;
+   fclose (f);
+   return mem;
+}
+
+/*! run fn (out, arg) in forked child so that peak memory measured by fn is the one of this run only
+   return true if child ends with success */
+static bool forkedRun (bool (*fn) (FILE *, const void *), FILE *out, const void *arg) {
+   int status;
+   fflush (NULL);
+   pid_t pid = fork ();
+   if (pid < 0) {
+      perror ("In forkedRun, Error fork");
+      return false;
+   }
+   if (pid == 0) {
+      const bool ok = fn (out, arg);
+      fflush (NULL);
+      _exit (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+   }
+   if (waitpid (pid, &status, 0) != pid) {
+      perror ("In forkedRun, Error waitpid");
+      return false;
+   }
+   return WIFEXITED (status) && (WEXITSTATUS (status) == EXIT_SUCCESS);
+}
+
+/*! fill zone and tGribData [iFlow] with analytic field. Return false if no memory */
+static bool syntheticGrib (Zone *z, int iFlow) {
+   memset (z, 0, sizeof (Zone));
+   z->latMin = BENCH_LAT_MIN;
+   z->latMax = BENCH_LAT_MAX;
+   z->lonLeft = BENCH_LON_LEFT;
+   z->lonRight = BENCH_LON_RIGHT;
+   z->latStep = z->lonStep = BENCH_STEP;
+   z->nbLat = (long) ((z->latMax - z->latMin) / z->latStep) + 1;
+   z->nbLon = (long) ((z->lonRight - z->lonLeft) / z->lonStep) + 1;
+   z->numberOfValues = z->nbLat * z->nbLon;
+   z->nTimeStamp = BENCH_N_TIME;
+   for (size_t i = 0; i < z->nTimeStamp; i += 1)
+      z->timeStamp [i] = i * BENCH_TIME_STEP;
+   z->intervalBegin = z->intervalEnd = BENCH_TIME_STEP;
+   z->nDataDate = z->nDataTime = 1;
+   z->dataDate [0] = 20250601;
+   z->dataTime [0] = 0;
+   z->nShortName = 2;
+   g_strlcpy (z->shortName [0], (iFlow == WIND) ? "10u" : "ucurr", MAX_SIZE_SHORT_NAME);
+   g_strlcpy (z->shortName [1], (iFlow == WIND) ? "10v" : "vcurr", MAX_SIZE_SHORT_NAME);
+   z->allTimeStepOK = true;
+
+   gribDataFree (iFlow);
+   if ((tGribData [iFlow] = calloc ((z->nTimeStamp + 1) * z->nbLat * z->nbLon, sizeof (FlowP))) == NULL) {
+      fprintf (stderr, "In syntheticGrib, Error calloc tGribData [%d]\n", iFlow);
+      return false;
+   }
+   for (size_t iT = 0; iT < z->nTimeStamp; iT += 1) {
+      const double t = z->timeStamp [iT];
+      for (long iLat = 0; iLat < z->nbLat; iLat += 1) {
+         const double lat = z->latMin + iLat * z->latStep;
+         for (long iLon = 0; iLon < z->nbLon; iLon += 1) {
+            const double lon = z->lonLeft + iLon * z->lonStep;
+            FlowP *p = &tGribData [iFlow][(iT * z->nbLat + iLat) * z->nbLon + iLon];
+            p->lat = lat;
+            p->lon = lon;
+            if (iFlow == WIND) {
+               const double tws = 12.0 + 6.0 * sin (lat / 3.0 + t / 20.0) + 3.0 * cos (lon / 4.0);   // knots
+               const double twd = 200.0 + 60.0 * sin (lon / 5.0 - t / 30.0) + 20.0 * cos (lat / 2.0);
+               p->u = -KN_TO_MS * tws * sin (DEG_TO_RAD * twd);
+               p->v = -KN_TO_MS * tws * cos (DEG_TO_RAD * twd);
+               p->g = KN_TO_MS * tws * 1.2;
+               p->w = 1.0 + tws / 10.0;
+            }
+            else {
+               p->u = 0.3 * sin (lat / 3.0 + t / 12.0);   // meter/s
+               p->v = 0.2 * cos (lon / 4.0);
+            }
+         }
+      }
+   }
+   z->wellDefined = true;
+   return true;
+}
+
+/*! clear in tIsSea cells of synthetic land: continent east of an irregular coast line
+   and a cape heading west between latitudes about 44.9 and 45.5, across the way of coastal scenario */
+static void syntheticLand (void) {
+   const int rowMin = (int) ((90.0 - BENCH_LAT_MAX) * 10), rowMax = (int) ((90.0 - BENCH_LAT_MIN) * 10);
+   const int colMin = (int) ((BENCH_LON_LEFT + 180.0) * 10), colMax = (int) ((BENCH_LON_RIGHT + 180.0) * 10);
+   for (int row = rowMin; row <= rowMax; row += 1) {
+      const double lat = 90.0 - row / 10.0;
+      const double coastLon = -1.5 + 0.5 * sin (lat * 2.5) + 0.2 * cos (lat * 7.0);
+      for (int col = colMin; col <= colMax; col += 1) {
+         const double lon = col / 10.0 - 180.0;
+         const bool cape = (lat > 44.9 + 0.1 * sin (lon * 4.0)) && (lat < 45.5 + 0.1 * cos (lon * 3.0)) &&
+                           (lon > -7.0 + 0.3 * sin (lat * 9.0));
+         if (cape || (lon > coastLon)) {
+            const int i = row * 3601 + col;
+            tIsSea [i >> 3] &= ~(1 << (i & 7));
+         }
+      }
+   }
+}
+
+/*! write generated polar file then read it in polMat. Return false if error */
+static bool syntheticPolar (const char *fileName) {
+   const double tws [] = {0, 6, 10, 16, 20, 25, 30, 40};
+   const int nTws = sizeof (tws) / sizeof (tws [0]);
+   char errMessage [MAX_SIZE_TEXT] = "";
+   FILE *f;
+   if ((f = fopen (fileName, "w")) == NULL) {
+      fprintf (stderr, "In syntheticPolar, Error cannot write: %s\n", fileName);
+      return false;
+   }
+   fprintf (f, "TWA/TWS");
+   for (int c = 0; c < nTws; c += 1)
+      fprintf (f, ";%.0lf", tws [c]);
+   fprintf (f, "\n");
+   for (int twa = 0; twa <= 180; twa += 10) {
+      fprintf (f, "%d", twa);
+      for (int c = 0; c < nTws; c += 1) {
+         double speed = (twa < 40) ? 0.0 :
+            0.55 * tws [c] * pow (sin (DEG_TO_RAD * twa), 0.6) * (1.0 - tws [c] / 120.0) * (1.0 + 0.15 * sin (DEG_TO_RAD * (twa - 60)));
+         fprintf (f, ";%.2lf", MAX (0.0, speed));
+      }
+      fprintf (f, "\n");
+   }
+   fclose (f);
+   if (! readPolar (false, fileName, &polMat, errMessage, sizeof (errMessage))) {
+      fprintf (stderr, "In syntheticPolar, Error readPolar: %s\n", errMessage);
+      return false;
+   }
+   return true;
+}
+
+/*! fixed routing parameters shared by all scenarios */
+static void benchParameters (int nThreads, bool vectorSweep, bool segmentSea) {
+   memset (&par, 0, sizeof (Par));
+   par.tStep = 1.0;
+   par.cogStep = 2;
+   par.rangeCog = 90;
+   par.opt = 1;
+   par.nSectors = 720;
+   par.jFactor = 300;
+   par.kFactor = 1;
+   par.xWind = 1.0;
+   par.maxWind = 60;
+   par.dayEfficiency = 1.0;
+   par.nightEfficiency = 0.9;
+   par.penalty0 = 60;
+   par.penalty1 = 60;
+   par.penalty2 = 120;
+   par.allwaysSea = true;
+   par.nThreads = CLAMP (nThreads, 1, MAX_N_THREADS);
+   par.vectorSweep = vectorSweep;
+   par.segmentSea = segmentSea;
+}
+
+/*! set globals for scenario sc. Return false if error */
+static bool scenarioSet (const BenchScenario *sc) {
+   par.pOr.lat = sc->latOr;
+   par.pOr.lon = sc->lonOr;
+   par.pDest.lat = sc->latDest;
+   par.pDest.lon = sc->lonDest;
+   par.withCurrent = sc->withCurrent;
+   wayPoints.n = sc->nWp;
+   for (int i = 0; i < sc->nWp; i += 1) {
+      wayPoints.t [i].lat = sc->wp [i][0];
+      wayPoints.t [i].lon = sc->wp [i][1];
+   }
+   par.nForbidZone = 0;
+   par.allwaysSea = true;
+   if (sc->withLand || (sc->nForbid > 0)) {
+      if (tIsSea == NULL && (tIsSea = malloc (SIZE_T_IS_SEA_BYTES)) == NULL) {
+         fprintf (stderr, "In scenarioSet, Error malloc tIsSea\n");
+         return false;
+      }
+      memset (tIsSea, 0xff, SIZE_T_IS_SEA_BYTES);      // all sea
+      par.allwaysSea = false;
+   }
+   if (sc->withLand)
+      syntheticLand ();
+   if (sc->nForbid > 0) {
+      Point *points = realloc (forbidZones [0].points, sc->nForbid * sizeof (Point));
+      if (points == NULL) {
+         fprintf (stderr, "In scenarioSet, Error realloc forbid zone\n");
+         return false;
+      }
+      forbidZones [0].points = points;
+      forbidZones [0].n = sc->nForbid;
+      for (int i = 0; i < sc->nForbid; i += 1) {
+         forbidZones [0].points [i].lat = sc->forbid [i][0];
+         forbidZones [0].points [i].lon = sc->forbid [i][1];
+      }
+      par.nForbidZone = 1;
+   }
+   return true;
+}
+
+/*! arguments of scenarioRun */
+typedef struct {
+   RoutingContext *ctx;
+   const BenchScenario *sc;
+   int nRuns;
+} ScenarioArg;
+
+/*! run scenario arg->sc arg->nRuns times and print result as one JSON line in out. Run by forkedRun */
+static bool scenarioRun (FILE *out, const void *arg) {
+   const ScenarioArg *a = arg;
+   RoutingContext *ctx = a->ctx;
+   const BenchScenario *sc = a->sc;
+   const int nRuns = a->nRuns;
+   const long baseKB = currentMemoryKB ();
+   double setupTime = 0.0, minTime = DBL_MAX, sumTime = 0.0;
+   double t0 = monotonicTime ();
+   if (! scenarioSet (sc))
+      return false;
+   if (par.nForbidZone > 0)
+      updateIsSeaWithForbiddenAreas ();
+   setupTime = monotonicTime () - t0;
+
+   for (int run = 0; run < nRuns; run += 1) {
+      routingContextFromGlobals (ctx);
+      t0 = monotonicTime ();
+      routingRun (ctx);
+      const double elapsed = monotonicTime () - t0;
+      minTime = MIN (minTime, elapsed);
+      sumTime += elapsed;
+   }
+   long nPoints = 0;
+   int maxPoints = 0;
+   for (int i = 0; i < ctx->nIsoc; i += 1) {
+      nPoints += ctx->isoDesc [i].size;
+      maxPoints = MAX (maxPoints, ctx->isoDesc [i].size);
+   }
+   fprintf (out, "{\"scenario\": \"%s\", \"nThreads\": %d, \"vectorSweep\": %s, \"segmentSea\": %s, \"runs\": %d, \"setupTime\": %.6lf, "
+           "\"minTime\": %.6lf, \"meanTime\": %.6lf, \"stepTime\": %.9lf, "
+           "\"ret\": %d, \"nIsoc\": %d, \"nPoints\": %ld, \"meanPointsPerIsoc\": %.1lf, \"maxPointsPerIsoc\": %d, "
+           "\"duration\": %.4lf, \"totDist\": %.4lf, \"isocMemory\": %zu, \"peakMemoryKB\": %ld, \"runMemoryKB\": %ld}\n",
+           sc->name, par.nThreads, par.vectorSweep ? "true" : "false", par.segmentSea ? "true" : "false", nRuns, setupTime, 
+           minTime, sumTime / nRuns, (ctx->nIsoc > 0) ? minTime / ctx->nIsoc : 0.0,
+           ctx->route.ret, ctx->nIsoc, nPoints, (ctx->nIsoc > 0) ? (double) nPoints / ctx->nIsoc : 0.0, maxPoints,
+           ctx->route.duration, ctx->route.totDist, ctx->route.isocMemory, peakMemoryKB (), peakMemoryKB () - baseKB);
+   fflush (out);
+   return true;
+}
+
+/*! load real grib file arg and print load time as one JSON line in out
+   path is "cache" if cache file of grib file exists before load, else "decode". Run by forkedRun */
+static bool gribLoadRun (FILE *out, const void *arg) {
+   const char *fileName = arg;
+   char cacheName [MAX_SIZE_FILE_NAME + sizeof (GRIB_CACHE_SUFFIX)];
+   struct stat st;
+   Zone gZone;
+   const long baseKB = currentMemoryKB ();
+   snprintf (cacheName, sizeof (cacheName), "%s%s", fileName, GRIB_CACHE_SUFFIX);
+   const bool fromCache = (stat (cacheName, &st) == 0);
+   double t0 = monotonicTime ();
+   bool ok = readGribAll (fileName, &gZone, WIND);
+   fprintf (out, "{\"scenario\": \"gribLoad\", \"nThreads\": %d, \"fileName\": \"%s\", \"path\": \"%s\", \"ok\": %s, \"loadTime\": %.6lf, "
+           "\"nMessage\": %d, \"nTimeStamp\": %zu, \"nbLat\": %ld, \"nbLon\": %ld, \"peakMemoryKB\": %ld, \"runMemoryKB\": %ld}\n",
+           par.nThreads, fileName, fromCache ? "cache" : "decode", ok ? "true" : "false", monotonicTime () - t0,
+           gZone.nMessage, ok ? gZone.nTimeStamp : 0, ok ? gZone.nbLat : 0, ok ? gZone.nbLon : 0, peakMemoryKB (), peakMemoryKB () - baseKB);
+   fflush (out);
+   gribDataFree (WIND);
+   return ok;
+}
+
+/*! time load of real grib file: decoding after removal of its cache file, then from cache file written */
+static void gribLoadBench (FILE *out, const char *fileName, int nThreads) {
+   char cacheName [MAX_SIZE_FILE_NAME + sizeof (GRIB_CACHE_SUFFIX)];
+   par.nThreads = CLAMP (nThreads, 1, MAX_N_THREADS);
+   snprintf (cacheName, sizeof (cacheName), "%s%s", fileName, GRIB_CACHE_SUFFIX);
+   remove (cacheName);
+   if (forkedRun (gribLoadRun, out, fileName))
+      forkedRun (gribLoadRun, out, fileName);
+}
+
+int main (int argc, char *argv []) {
+   int nRuns = 3, nThreads = 1, opt, nDone = 0;
+   bool verbose = false, vectorSweep = true, segmentSea = false;
+   FILE *out = stdout;
+   const char *gribFileName = NULL;
+   char polarFileName [MAX_SIZE_FILE_NAME];
+   setlocale (LC_ALL, "C");
+
+   while ((opt = getopt (argc, argv, "vsln:t:g:")) != -1) {
+      switch (opt) {
+      case 'v': verbose = true; break;
+      case 's': vectorSweep = false; break;
+      case 'l': segmentSea = true; break;
+      case 'n': nRuns = MAX (1, atoi (optarg)); break;
+      case 't': nThreads = atoi (optarg); break;
+      case 'g': gribFileName = optarg; break;
+      default:
+         fprintf (stderr, "Synopsys: %s %s\n", argv [0], SYNOPSYS);
+         return EXIT_FAILURE;
+      }
+   }
+   if (! verbose) {        // results on original stdout, engine messages dropped
+      int fd = dup (STDOUT_FILENO);
+      if ((fd < 0) || ((out = fdopen (fd, "w")) == NULL) || (freopen ("/dev/null", "w", stdout) == NULL)) {
+         fprintf (stderr, "In main, Error redirecting stdout\n");
+         return EXIT_FAILURE;
+      }
+   }
+   if (gribFileName != NULL)
+      gribLoadBench (out, gribFileName, nThreads);
+
+   benchParameters (nThreads, vectorSweep, segmentSea);
+   snprintf (polarFileName, sizeof (polarFileName), "%s/%s", g_get_tmp_dir (), BENCH_POLAR);
+   if (! syntheticPolar (polarFileName) || ! syntheticGrib (&zone, WIND) || ! syntheticGrib (&currentZone, CURRENT))
+      return EXIT_FAILURE;
+
+   RoutingContext *ctx = routingContextNew ();
+   if (ctx == NULL)
+      return EXIT_FAILURE;
+   for (size_t i = 0; i < sizeof (scenarios) / sizeof (scenarios [0]); i += 1) {
+      bool selected = (optind >= argc);
+      for (int k = optind; k < argc; k += 1)
+         if (strcmp (argv [k], scenarios [i].name) == 0)
+            selected = true;
+      ScenarioArg arg = {.ctx = ctx, .sc = &scenarios [i], .nRuns = nRuns};
+      if (selected && forkedRun (scenarioRun, out, &arg))
+         nDone += 1;
+   }
+   routingContextFree (ctx);
+   gribDataFree (WIND);
+   gribDataFree (CURRENT);
+   isSeaFree ();
+   remove (polarFileName);
+   return (nDone > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
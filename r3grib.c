@@ -1,4 +1,5 @@
 /*! compilation: gcc -c grib.c `pkg-config --cflags glib-2.0` */
+#define _POSIX_C_SOURCE 200809L // for mkstemp and fdopen with -std=c11
 #include <glib.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,17 +8,43 @@
 #include <time.h>
 #include <math.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <locale.h>
 #include "eccodes.h"
 #include "rtypes.h"
 #include "r3util.h"
+#include "grib.h"
 #include "inline.h"
 #include <grib_api.h>  // for ProductKind
 
 #define  EPSILON 0.001        // for G_APPROX_VALUE
+#define  GRIB_CACHE_MAGIC     "R3GRIBC"   // 8 bytes with final \0
+#define  GRIB_CACHE_VERSION   2           // increment when format of cache or decoding change
 
 FlowP *tGribData [2] = {NULL, NULL};   // wind, current
 
+static GribStore gribStore [2];              // storage of tGribData [iFlow], map not NULL when mapped from cache file
+static GMutex codesMutex;                    // serializes ecCodes calls when linked ecCodes is not thread safe
+
+/*! header of binary cache file of decoded grib. Followed by nFlowP FlowP values */
+typedef struct {
+   char     magic [8];
+   uint32_t version;
+   uint32_t sizeOfZone;
+   uint32_t sizeOfFlowP;
+   uint32_t reserved;
+   int64_t  srcSize;          // size of source grib file
+   int64_t  srcMtime;         // modification time of source grib file
+   int64_t  srcMtimeNsec;     // nanoseconds of modification time: file rewritten within the same second
+   uint64_t srcIno;           // inode of source grib file
+   uint64_t nFlowP;           // number of FlowP following header
+   Zone     zone;
+} GribCacheHeader;
+
 /*! return difference in hours between two zones (current zone and Wind zone) */
 double zoneTimeDiff (const Zone *zone1, const Zone *zone0) {
    if (zone1->wellDefined && zone0->wellDefined) {
@@ -335,7 +362,7 @@ static inline double arrondiMax (double v, double step) {
 
 /*! provide 4 wind points around p */
 static inline void find4PointsAround (double lat, double lon,  double *latMin, 
-   double *latMax, double *lonMin, double *lonMax, Zone *zone) {
+   double *latMax, double *lonMin, double *lonMax, const Zone *zone) {
 
    *latMin = arrondiMin (lat, zone->latStep);
    *latMax = arrondiMax (lat, zone->latStep);
@@ -365,16 +392,38 @@ static inline long indLon (double lon, const Zone *zone) {
    return (long) round ((lon - zone->lonLeft)/zone->lonStep);
 }
 
+/*! bilinear interpolation of u, v, g (gust), w (waves) at point (lat, lon) between 4 grid points
+   p00 north west, p01 north east, p10 south east, p11 south west */
+static inline void interpolate4 (double lat, double lon, const FlowP *p00, const FlowP *p01, const FlowP *p10, const FlowP *p11,
+   double *u, double *v, double *g, double *w) {
+
+   double a, b;
+   a = interpolate (lon, p00->lon, p01->lon, p00->u, p01->u);
+   b = interpolate (lon, p10->lon, p11->lon, p10->u, p11->u); 
+   *u = interpolate (lat, p00->lat, p10->lat, a, b);
+   
+   a = interpolate (lon, p00->lon, p01->lon, p00->v, p01->v); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->v, p11->v); 
+   *v = interpolate (lat, p00->lat, p10->lat, a, b);
+   
+   a = interpolate (lon, p00->lon, p01->lon, p00->g, p01->g); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->g, p11->g); 
+   *g = interpolate (lat, p00->lat, p10->lat, a, b);
+    
+   a = interpolate (lon, p00->lon, p01->lon, p00->w, p01->w); 
+   b = interpolate (lon, p10->lon, p11->lon, p10->w, p11->w); 
+   *w = interpolate (lat, p00->lat, p10->lat, a, b);
+}
+
 /*! interpolation to get u, v, g (gust), w (waves) at point (lat, lon)  and time t */
 static bool findFlow (double lat, double lon, double t, double *rU, double *rV, \
-   double *rG, double *rW, Zone *zone, const FlowP *gribData) {
+   double *rG, double *rW, const Par *par, const Zone *zone, const FlowP *gribData) {
 
    double t0,t1;
    double latMin, latMax, lonMin, lonMax;
-   double a, b, u0, u1, v0, v1, g0, g1, w0, w1;
+   double u0, u1, v0, v1, g0, g1, w0, w1;
    int iT0, iT1;
-   FlowP windP00, windP01, windP10, windP11;
-   if ((!zone->wellDefined) || (zone->nbLat == 0) || (! isInZone (lat, lon, zone) && par.constWindTws == 0) || (t < 0)){
+   if ((!zone->wellDefined) || (zone->nbLat == 0) || (! isInZone (lat, lon, zone) && par->constWindTws == 0) || (t < 0)){
       *rU = 0, *rV = 0, *rG = 0; *rW = 0;
       return false;
    }
@@ -382,55 +431,16 @@ static bool findFlow (double lat, double lon, double t, double *rU, double *rV,
    findTimeAround (t, &iT0, &iT1, zone);
    find4PointsAround (lat, lon, &latMin, &latMax, &lonMin, &lonMax, zone);
    //printf ("lat %lf iT0 %d, iT1 %d, latMin %lf latMax %lf lonMin %lf lonMax %lf\n", p.lat, iT0, iT1, latMin, latMax, lonMin, lonMax);  
-   // 4 points at time t0
-   windP00 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMin, zone)];  
-   windP01 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP10 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP11 = gribData [iT0 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMin, zone)];
-
-   // printf ("00lat %lf  01lat %lf  10lat %lf 11lat %lf\n", windP00.lat, windP01.lat,windP10.lat,windP11.lat); 
-   // printf ("00tws %lf  01tws %lf  10tws %lf 11tws %lf\n", windP00.tws, windP01.tws,windP10.tws,windP11.tws); 
-   // speed longitude interpolation at northern latitudes
-  
-   // interpolation  for u, v, w, g
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.u, windP01.u);
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.u, windP11.u); 
-   u0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.v, windP01.v); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.v, windP11.v); 
-   v0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.g, windP01.g); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.g, windP11.g); 
-   g0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.w, windP01.w); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.w, windP11.w); 
-   w0 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   // 4 points at time t1
-   windP00 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMin, zone)];  
-   windP01 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMax, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP10 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMax, zone)];
-   windP11 = gribData [iT1 * zone->nbLat * zone->nbLon + indLat(latMin, zone) * zone->nbLon + indLon(lonMin, zone)];
-
-   // interpolatuon for  for u, v
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.u, windP01.u);
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.u, windP11.u); 
-   u1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.v, windP01.v); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.v, windP11.v); 
-   v1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-    
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.g, windP01.g); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.g, windP11.g); 
-   g1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
-   
-   a = interpolate (lon, windP00.lon, windP01.lon, windP00.w, windP01.w); 
-   b = interpolate (lon, windP10.lon, windP11.lon, windP10.w, windP11.w); 
-   w1 = interpolate (lat, windP00.lat, windP10.lat, a, b);
+   const long i00 = indLat(latMax, zone) * zone->nbLon + indLon(lonMin, zone);
+   const long i01 = indLat(latMax, zone) * zone->nbLon + indLon(lonMax, zone);
+   const long i10 = indLat(latMin, zone) * zone->nbLon + indLon(lonMax, zone);
+   const long i11 = indLat(latMin, zone) * zone->nbLon + indLon(lonMin, zone);
+
+   // 4 points at time t0 then at time t1
+   const FlowP *layer = &gribData [iT0 * zone->nbLat * zone->nbLon];
+   interpolate4 (lat, lon, &layer [i00], &layer [i01], &layer [i10], &layer [i11], &u0, &v0, &g0, &w0);
+   layer = &gribData [iT1 * zone->nbLat * zone->nbLon];
+   interpolate4 (lat, lon, &layer [i00], &layer [i01], &layer [i10], &layer [i11], &u1, &v1, &g1, &w1);
    
    // finally, interpolation twd tws between t0 and t1
    t0 = zone->timeStamp [iT0];
@@ -443,48 +453,161 @@ static bool findFlow (double lat, double lon, double t, double *rU, double *rV,
    return true;
 }
 
-/*! use findflow to get wind and waves */
-void findWindGrib (double lat, double lon, double t, double *u, double *v, \
-   double *gust, double *w, double *twd, double *tws ) {
-   if (par.constWindTws != 0) {
-      *twd = par.constWindTwd;
-      *tws = par.constWindTws;
-	   *u = - KN_TO_MS * par.constWindTws * sin (DEG_TO_RAD * par.constWindTwd);
-	   *v = - KN_TO_MS * par.constWindTws * cos (DEG_TO_RAD * par.constWindTwd);
+/*! copy in slice the grid points of gribData at the two time stamps around t, for the box latMin latMax lonMin lonMax
+   so that findWindSlice and findCurrentSlice avoid time search and read contiguous memory. Slice buffer is reused.
+   Return false if no slice (box crossing lonLeft or error): lookups then fall back to findFlow */
+bool flowSliceBuild (FlowSlice *slice, const Zone *zone, const FlowP *gribData, double t, 
+   double latMin, double latMax, double lonMin, double lonMax) {
+
+   double bLatMin, bLatMax, bLonMin, bLonMax, bidon;
+   int iT0, iT1;
+   slice->valid = false;
+   if ((!zone->wellDefined) || (zone->nbLat == 0) || (gribData == NULL) || (t < 0))
+      return false;
+
+   findTimeAround (t, &iT0, &iT1, zone);
+   find4PointsAround (latMin, lonMin, &bLatMin, &bidon, &bLonMin, &bidon, zone);
+   find4PointsAround (latMax, lonMax, &bidon, &bLatMax, &bidon, &bLonMax, zone);
+   const long iLat0 = indLat (bLatMin, zone), iLat1 = indLat (bLatMax, zone);
+   const long iLon0 = indLon (bLonMin, zone), iLon1 = indLon (bLonMax, zone);
+   if ((iLat0 < 0) || (iLat0 > iLat1) || (iLat1 >= zone->nbLat) || (iLon0 < 0) || (iLon0 > iLon1) || (iLon1 >= zone->nbLon))
+      return false;
+
+   const long nLat = iLat1 - iLat0 + 1, nLon = iLon1 - iLon0 + 1;
+   const size_t n = 2 * nLat * nLon;
+   if (n > slice->nAlloc) {
+      FlowP *node = realloc (slice->node, n * sizeof (FlowP));
+      if (node == NULL) {
+         fprintf (stderr, "In flowSliceBuild, Error realloc: %zu points\n", n);
+         return false;
+      }
+      slice->node = node;
+      slice->nAlloc = n;
+   }
+   const FlowP *layer0 = &gribData [iT0 * zone->nbLat * zone->nbLon];
+   const FlowP *layer1 = &gribData [iT1 * zone->nbLat * zone->nbLon];
+   FlowP *dst = slice->node;
+   for (long i = iLat0; i <= iLat1; i++) {
+      for (long j = iLon0; j <= iLon1; j++) {
+         *dst++ = layer0 [i * zone->nbLon + j];
+         *dst++ = layer1 [i * zone->nbLon + j];
+      }
+   }
+   slice->t = t;
+   slice->t0 = zone->timeStamp [iT0];
+   slice->t1 = zone->timeStamp [iT1];
+   slice->iLat0 = iLat0;
+   slice->iLon0 = iLon0;
+   slice->nLat = nLat;
+   slice->nLon = nLon;
+   slice->valid = true;
+   return true;
+}
+
+/*! free slice buffer */
+void flowSliceFree (FlowSlice *slice) {
+   free (slice->node);
+   memset (slice, 0, sizeof (FlowSlice));
+}
+
+/*! same as findFlow, reading grid points in slice if slice has been built for time t and contains them */
+static bool findFlowSlice (const FlowSlice *slice, double lat, double lon, double t, double *rU, double *rV, \
+   double *rG, double *rW, const Par *par, const Zone *zone, const FlowP *gribData) {
+
+   double latMin, latMax, lonMin, lonMax;
+   double u0, u1, v0, v1, g0, g1, w0, w1;
+   if ((slice == NULL) || (! slice->valid) || (t != slice->t))
+      return findFlow (lat, lon, t, rU, rV, rG, rW, par, zone, gribData);
+   if ((!zone->wellDefined) || (zone->nbLat == 0) || (! isInZone (lat, lon, zone) && par->constWindTws == 0) || (t < 0)){
+      *rU = 0, *rV = 0, *rG = 0; *rW = 0;
+      return false;
+   }
+   find4PointsAround (lat, lon, &latMin, &latMax, &lonMin, &lonMax, zone);
+   const long iNorth = indLat (latMax, zone) - slice->iLat0, iSouth = indLat (latMin, zone) - slice->iLat0;
+   const long iWest = indLon (lonMin, zone) - slice->iLon0, iEast = indLon (lonMax, zone) - slice->iLon0;
+   if ((iSouth < 0) || (iNorth >= slice->nLat) || (iWest < 0) || (iEast >= slice->nLon) || (iWest > iEast) || (iSouth > iNorth))
+      return findFlow (lat, lon, t, rU, rV, rG, rW, par, zone, gribData);
+
+   const FlowP *p00 = &slice->node [2 * (iNorth * slice->nLon + iWest)];
+   const FlowP *p01 = &slice->node [2 * (iNorth * slice->nLon + iEast)];
+   const FlowP *p10 = &slice->node [2 * (iSouth * slice->nLon + iEast)];
+   const FlowP *p11 = &slice->node [2 * (iSouth * slice->nLon + iWest)];
+   interpolate4 (lat, lon, p00, p01, p10, p11, &u0, &v0, &g0, &w0);
+   interpolate4 (lat, lon, p00 + 1, p01 + 1, p10 + 1, p11 + 1, &u1, &v1, &g1, &w1);
+
+   *rU = interpolate (t, slice->t0, slice->t1, u0, u1);
+   *rV = interpolate (t, slice->t0, slice->t1, v0, v1);
+   *rG = interpolate (t, slice->t0, slice->t1, g0, g1);
+   *rW = interpolate (t, slice->t0, slice->t1, w0, w1);
+   return true;
+}
+
+/*! use findFlowSlice to get wind and waves from explicit parameters, zone, grib data and slice (may be NULL). Re-entrant */
+void findWindSlice (const FlowSlice *slice, const Par *par, const Zone *zone, const FlowP *gribData, double lat, double lon, double t, 
+   double *u, double *v, double *gust, double *w, double *twd, double *tws) {
+   if (par->constWindTws != 0) {
+      *twd = par->constWindTwd;
+      *tws = par->constWindTws;
+	   *u = - KN_TO_MS * par->constWindTws * sin (DEG_TO_RAD * par->constWindTwd);
+	   *v = - KN_TO_MS * par->constWindTws * cos (DEG_TO_RAD * par->constWindTwd);
       *w = 0;
       *gust = hypot (*u, *v); // m/s
       return;
    }
-   findFlow (lat, lon, t, u, v, gust, w, &zone, tGribData [WIND]);
+   findFlowSlice (slice, lat, lon, t, u, v, gust, w, par, zone, gribData);
    *twd = fTwd (*u, *v);
    *tws = fTws (*u, *v);
-   if (par.constWave < 0) *w = 0;
-   else if (par.constWave != 0) *w = par.constWave;
+   if (par->constWave < 0) *w = 0;
+   else if (par->constWave != 0) *w = par->constWave;
 }
 
-/*! use findflow to get current */
-void findCurrentGrib (double lat, double lon, double t, double *uCurr,\
-   double *vCurr, double *tcd, double *tcs) {
+/*! use findflow to get wind and waves from explicit parameters, zone and grib data. Re-entrant */
+void findWindFlow (const Par *par, const Zone *zone, const FlowP *gribData, double lat, double lon, double t, 
+   double *u, double *v, double *gust, double *w, double *twd, double *tws) {
+   findWindSlice (NULL, par, zone, gribData, lat, lon, t, u, v, gust, w, twd, tws);
+}
+
+/*! use findflow to get wind and waves */
+void findWindGrib (double lat, double lon, double t, double *u, double *v, \
+   double *gust, double *w, double *twd, double *tws ) {
+   findWindFlow (&par, &zone, tGribData [WIND], lat, lon, t, u, v, gust, w, twd, tws);
+}
+
+/*! use findFlowSlice to get current from explicit parameters, zone, grib data and slice (may be NULL). Re-entrant */
+void findCurrentSlice (const FlowSlice *slice, const Par *par, const Zone *currentZone, const FlowP *gribData, double lat, double lon, double t, 
+   double *uCurr, double *vCurr, double *tcd, double *tcs) {
 
    double gust, bidon;
    *uCurr = 0;
    *vCurr = 0;
    *tcd = 0;
    *tcs = 0;
-   if (par.constCurrentS != 0) {
-      *uCurr = -KN_TO_MS * par.constCurrentS * sin (DEG_TO_RAD * par.constCurrentD);
-      *vCurr = -KN_TO_MS * par.constCurrentS * cos (DEG_TO_RAD * par.constCurrentD);
-      *tcd = par.constCurrentD; // direction
-      *tcs = par.constCurrentS; // speed
+   if (par->constCurrentS != 0) {
+      *uCurr = -KN_TO_MS * par->constCurrentS * sin (DEG_TO_RAD * par->constCurrentD);
+      *vCurr = -KN_TO_MS * par->constCurrentS * cos (DEG_TO_RAD * par->constCurrentD);
+      *tcd = par->constCurrentD; // direction
+      *tcs = par->constCurrentS; // speed
       return;
    }
-   if (t > currentZone.timeStamp [currentZone.nTimeStamp - 1]) return;
+   if (t > currentZone->timeStamp [currentZone->nTimeStamp - 1]) return;
 
-   findFlow (lat, lon, t, uCurr, vCurr, &gust, &bidon, &currentZone, tGribData [CURRENT]);
+   findFlowSlice (slice, lat, lon, t, uCurr, vCurr, &gust, &bidon, par, currentZone, gribData);
    *tcd = fTwd (*uCurr, *vCurr);
    *tcs = fTws (*uCurr, *vCurr);
 }
 
+/*! use findflow to get current from explicit parameters, zone and grib data. Re-entrant */
+void findCurrentFlow (const Par *par, const Zone *currentZone, const FlowP *gribData, double lat, double lon, double t, 
+   double *uCurr, double *vCurr, double *tcd, double *tcs) {
+   findCurrentSlice (NULL, par, currentZone, gribData, lat, lon, t, uCurr, vCurr, tcd, tcs);
+}
+
+/*! use findflow to get current */
+void findCurrentGrib (double lat, double lon, double t, double *uCurr,\
+   double *vCurr, double *tcd, double *tcs) {
+   findCurrentFlow (&par, &currentZone, tGribData [CURRENT], lat, lon, t, uCurr, vCurr, tcd, tcs);
+}
+
 /*! Modify array with new value if not already in array. Return new array size*/
 static long updateLong (long value, size_t n, size_t maxSize, long array []) {
    bool found = false;
@@ -501,51 +624,35 @@ static long updateLong (long value, size_t n, size_t maxSize, long array []) {
    return n;
 }
 
-/*! Read lists zone.timeStamp, shortName, zone.dataDate, dataTime before full grib reading */
-static bool readGribLists (const char *fileName, Zone *zone) {
-   FILE* f = NULL;
-   int err = 0;
+/*! update lists zone.timeStamp, shortName, zone.dataDate, dataTime with message h */
+static void gribListsUpdate (codes_handle *h, Zone *zone) {
    long timeStep, dataDate, dataTime;
    char shortName [MAX_SIZE_SHORT_NAME];
-   size_t lenName;
+   size_t lenName = MAX_SIZE_SHORT_NAME;
    bool found = false;
-   // Message handle. Required in all the ecCodes calls acting on a message.
-   codes_handle* h = NULL;
 
-   if ((f = fopen (fileName, "rb")) == NULL) {
-       fprintf (stderr, "In readGribLists, ErrorUnable to open file %s\n", fileName);
-       return false;
-   }
-   memset (zone, 0,  sizeof (Zone));
+   CODES_CHECK(codes_get_string(h, "shortName", shortName, &lenName), 0);
+   CODES_CHECK(codes_get_long(h, "step", &timeStep), 0);
+   CODES_CHECK(codes_get_long(h, "dataDate", &dataDate), 0);
+   CODES_CHECK(codes_get_long(h, "dataTime", &dataTime), 0);
 
-   // Loop on all the messages in a file
-   while ((h = codes_handle_new_from_file(0, f, PRODUCT_GRIB, &err)) != NULL) {
-      if (err != CODES_SUCCESS) CODES_CHECK (err, 0);
-      lenName = MAX_SIZE_SHORT_NAME;
-
-      CODES_CHECK(codes_get_string(h, "shortName", shortName, &lenName), 0);
-      CODES_CHECK(codes_get_long(h, "step", &timeStep), 0);
-      CODES_CHECK(codes_get_long(h, "dataDate", &dataDate), 0);
-      CODES_CHECK(codes_get_long(h, "dataTime", &dataTime), 0);
-      codes_handle_delete (h);
-
-      found = false;
-      for (size_t i = 0; i < zone->nShortName; i++) {
-         if (strcmp (shortName, zone->shortName [i]) == 0) {
-            found = true;
-            break;
-         }
-      } 
-      if ((! found) && (zone->nShortName < MAX_N_SHORT_NAME)) { // new shortName
-         g_strlcpy (zone->shortName [zone->nShortName], shortName, MAX_SIZE_SHORT_NAME); 
-         zone->nShortName += 1;
+   for (size_t i = 0; i < zone->nShortName; i++) {
+      if (strcmp (shortName, zone->shortName [i]) == 0) {
+         found = true;
+         break;
       }
-      zone->nTimeStamp = updateLong (timeStep, zone->nTimeStamp, MAX_N_TIME_STAMPS, zone->timeStamp); 
-      zone->nDataDate = updateLong (dataDate, zone->nDataDate, MAX_N_DATA_DATE, zone->dataDate); 
-      zone->nDataTime = updateLong (dataTime, zone->nDataTime, MAX_N_DATA_TIME, zone->dataTime); 
+   } 
+   if ((! found) && (zone->nShortName < MAX_N_SHORT_NAME)) { // new shortName
+      g_strlcpy (zone->shortName [zone->nShortName], shortName, MAX_SIZE_SHORT_NAME); 
+      zone->nShortName += 1;
    }
- 
-   fclose (f);
+   zone->nTimeStamp = updateLong (timeStep, zone->nTimeStamp, MAX_N_TIME_STAMPS, zone->timeStamp); 
+   zone->nDataDate = updateLong (dataDate, zone->nDataDate, MAX_N_DATA_DATE, zone->dataDate); 
+   zone->nDataTime = updateLong (dataTime, zone->nDataTime, MAX_N_DATA_TIME, zone->dataTime); 
+}
+
+/*! complete lists after last message: gust name and time intervals */
+static void gribListsFinish (Zone *zone) {
    // Replace unknown by gust ? (GFS case where gust identified by specific indicatorOfParameter)
    for (size_t i = 0; i < zone->nShortName; i++) {
       if (strcmp (zone->shortName[i], "unknown") == 0)
@@ -564,36 +671,15 @@ static bool readGribLists (const char *fileName, Zone *zone) {
    }
    else {
       zone->intervalBegin = zone->intervalEnd = 3;
-      fprintf (stderr, "In readGribLists, Error nTimeStamp = %zu\n", zone->nTimeStamp);
-      //return false;
+      fprintf (stderr, "In gribListsFinish, Error nTimeStamp = %zu\n", zone->nTimeStamp);
    }
-
    //printf ("intervalBegin: %ld, intervalEnd: %ld, intervalLimit: %zu\n", 
       //zone->intervalBegin, zone->intervalEnd, zone->intervalLimit -1); 
-   return true;
 }
 
-/*! Read grib parameters in zone before full grib reading */
-static bool readGribParameters (const char *fileName, Zone *zone) {
-   int err = 0;
-   FILE* f = NULL;
+/*! Read grib parameters in zone from message h (first message of file) */
+static void gribParameters (codes_handle *h, Zone *zone) {
    double lat1, lat2;
-   codes_handle *h = NULL;
- 
-   if ((f = fopen (fileName, "rb")) == NULL) {
-       fprintf (stderr, "In readGribParameters, Error unable to open file %s\n",fileName);
-       return false;
-   }
- 
-   // create new handle from the first message in the file
-   if ((h = codes_handle_new_from_file(0, f, PRODUCT_GRIB, &err)) == NULL) {
-       fprintf (stderr, "In readGribParameters, Error code handle from file : %s Code error: %s\n",\
-         fileName, codes_get_error_message(err)); 
-       fclose (f);
-       return false;
-   }
-   fclose (f);
- 
    CODES_CHECK(codes_get_long (h, "centre", &zone->centreId),0);
    CODES_CHECK(codes_get_long (h, "editionNumber", &zone->editionNumber),0);
    CODES_CHECK(codes_get_long (h, "stepUnits", &zone->stepUnits),0);
@@ -618,92 +704,405 @@ static bool readGribParameters (const char *fileName, Zone *zone) {
    }
    zone->latMin = MIN (lat1, lat2);
    zone->latMax = MAX (lat1, lat2);
+}
+
+/*! true if linked ecCodes is built thread safe (ENABLE_ECCODES_THREADS or ENABLE_ECCODES_OMP_THREADS)
+   ecCodes without codes_get_features cannot tell and is considered not thread safe. Checked once */
+bool gribThreadSafe (void) {
+   static gsize checked = 0;
+   static bool threadSafe = false;
+   if (g_once_init_enter (&checked)) {
+#ifdef CODES_FEATURES_ENABLED
+      char features [MAX_SIZE_TEXT] = "";
+      size_t len = sizeof (features);
+      threadSafe = (codes_get_features (features, &len, CODES_FEATURES_ENABLED) == CODES_SUCCESS) &&
+                   (strstr (features, "THREADS") != NULL);
+#endif
+      g_once_init_leave (&checked, 1);
+   }
+   return threadSafe;
+}
 
-   codes_handle_delete (h);
+/*! enter section calling ecCodes: exclusive of all others if ecCodes is not thread safe */
+static void codesLock (void) {
+   if (! gribThreadSafe ())
+      g_mutex_lock (&codesMutex);
+}
+
+/*! leave section calling ecCodes */
+static void codesUnlock (void) {
+   if (! gribThreadSafe ())
+      g_mutex_unlock (&codesMutex);
+}
+
+/*! message of grib file recorded by traversal: location in file and metadata, not the message itself */
+typedef struct {
+   long   offset;                         // in file
+   size_t length;
+   bool   bitmapPresent;
+   long   timeStep;
+   int    iT;                             // time slot of message in zone timeStamp
+   double indicatorOfParameter;
+   char   shortName [MAX_SIZE_SHORT_NAME];
+} GribMessage;
+
+/*! messages recorded between traversal and decoding of grib file */
+typedef struct {
+   GribMessage *msg;
+   size_t n;
+   size_t maxN;
+} GribMessages;
+
+/*! free array of messages */
+static void gribMessagesFree (GribMessages *messages) {
+   free (messages->msg);
+   memset (messages, 0, sizeof (GribMessages));
+}
+
+/*! record location and metadata of message h. Return false if no memory */
+static bool gribMessagesAdd (GribMessages *messages, codes_handle *h) {
+   long bitmapPresent = 0;
+   size_t lenName = MAX_SIZE_SHORT_NAME;
+   if (messages->n >= messages->maxN) {
+      size_t newMax = (messages->maxN == 0) ? 256 : 2 * messages->maxN;
+      GribMessage *newMsg = realloc (messages->msg, newMax * sizeof (GribMessage));
+      if (newMsg == NULL) {
+         fprintf (stderr, "In gribMessagesAdd: error in memory allocation\n");
+         return false;
+      }
+      messages->msg = newMsg;
+      messages->maxN = newMax;
+   }
+   GribMessage *msg = &messages->msg [messages->n];
+   memset (msg, 0, sizeof (GribMessage));
+   CODES_CHECK (codes_get_long (h, "offset", &msg->offset), 0);
+   CODES_CHECK (codes_get_message_size (h, &msg->length), 0);
+   CODES_CHECK (codes_get_long (h, "bitmapPresent", &bitmapPresent), 0);
+   msg->bitmapPresent = bitmapPresent;
+   CODES_CHECK (codes_get_string (h, "shortName", msg->shortName, &lenName), 0);
+   CODES_CHECK (codes_get_long (h, "step", &msg->timeStep), 0);
+   if (codes_get_double (h, "indicatorOfParameter", &msg->indicatorOfParameter) != CODES_SUCCESS) 
+      msg->indicatorOfParameter = -1;
+   messages->n += 1;
    return true;
 }
 
-/*! find index in gribData table */
-static inline long indexOf (int timeStep, double lat, double lon, const Zone *zone) {
-   long iLat = indLat (lat, zone);
-   long iLon = indLon (lon, zone);
-   int iT = -1;
-   for (iT = 0; iT < (int) zone->nTimeStamp; iT++) {
-      if (timeStep == zone->timeStamp [iT])
-         break;
+/*! Read lists zone.timeStamp, shortName, zone.dataDate, dataTime and grib parameters 
+   in one traversal of the messages of the file
+   if messages != NULL, location and metadata of each message are recorded in it for decoding
+   message handles are deleted as soon as read: encoded file is never kept in memory
+   return false if file cannot be open or has no message */
+static bool readGribMessages (const char *fileName, Zone *zone, GribMessages *messages) {
+   FILE* f = NULL;
+   int err = 0;
+   // Message handle. Required in all the ecCodes calls acting on a message.
+   codes_handle* h = NULL;
+   int nMessage = 0;
+
+   if ((f = fopen (fileName, "rb")) == NULL) {
+       fprintf (stderr, "In readGribMessages, Error unable to open file %s\n", fileName);
+       return false;
    }
-   if (iT == -1) {
-      fprintf (stderr, "In indexOf, Error Cannot find index of time: %d\n", timeStep);
-      return -1;
+   memset (zone, 0,  sizeof (Zone));
+
+   // Loop on all the messages in a file
+   while ((h = codes_handle_new_from_file(0, f, PRODUCT_GRIB, &err)) != NULL) {
+      if (err != CODES_SUCCESS) CODES_CHECK (err, 0);
+      if (nMessage == 0)
+         gribParameters (h, zone);
+      gribListsUpdate (h, zone);
+      nMessage += 1;
+      bool ok = (messages == NULL) || gribMessagesAdd (messages, h);
+      codes_handle_delete (h);
+      if (! ok) {
+         fclose (f);
+         return false;
+      }
+   }
+   fclose (f);
+   if (nMessage == 0) {
+       fprintf (stderr, "In readGribMessages, Error code handle from file : %s Code error: %s\n",\
+         fileName, codes_get_error_message(err)); 
+       return false;
    }
-   //printf ("iT: %d iLon :%d iLat: %d\n", iT, iLon, iLat); 
-   return  (iT * zone->nbLat * zone->nbLon) + (iLat * zone->nbLon) + iLon;
+   gribListsFinish (zone);
+   return true;
 }
 
-/*! read grib file using eccodes C API 
-   return true if OK */
-bool readGribAll (const char *fileName, Zone *zone, int iFlow) {
-   FILE* f = NULL;
+/*! free decoded data of store, either allocated or mapped from cache file */
+void gribStoreFree (GribStore *store) {
+   if (store->map != NULL)
+      munmap (store->map, store->mapLen);
+   else free (store->data);
+   *store = (GribStore) {NULL, NULL, 0};
+}
+
+/*! free tGribData [iFlow], either allocated or mapped from cache file */
+void gribDataFree (int iFlow) {
+   gribStore [iFlow].data = tGribData [iFlow];      // tGribData [iFlow] may have been allocated by caller
+   gribStoreFree (&gribStore [iFlow]);
+   tGribData [iFlow] = NULL;
+}
+
+/*! fill header with version and identification of source grib file
+   return false if source grib file cannot be stat */
+static bool gribCacheHeader (const char *fileName, const Zone *zone, size_t nFlowP, GribCacheHeader *header) {
+   struct stat st;
+   if (stat (fileName, &st) != 0)
+      return false;
+   memset (header, 0, sizeof (GribCacheHeader));
+   memcpy (header->magic, GRIB_CACHE_MAGIC, sizeof (header->magic));
+   header->version = GRIB_CACHE_VERSION;
+   header->sizeOfZone = sizeof (Zone);
+   header->sizeOfFlowP = sizeof (FlowP);
+   header->srcSize = st.st_size;
+   header->srcMtime = st.st_mtim.tv_sec;
+   header->srcMtimeNsec = st.st_mtim.tv_nsec;
+   header->srcIno = st.st_ino;
+   header->nFlowP = nFlowP;
+   if (zone != NULL)
+      header->zone = *zone;
+   return true;
+}
+
+/*! map cache file of fileName in store and fill zone
+   return false if no cache or cache invalid (other version, source grib changed) */
+static bool readGribCache (const char *fileName, Zone *zone, GribStore *store) {
+   char cacheName [MAX_SIZE_FILE_NAME + sizeof (GRIB_CACHE_SUFFIX)];
+   GribCacheHeader ref, header;
+   struct stat st;
+   int fd;
+
+   if (! gribCacheHeader (fileName, NULL, 0, &ref))
+      return false;
+   snprintf (cacheName, sizeof (cacheName), "%s%s", fileName, GRIB_CACHE_SUFFIX);
+   if ((fd = open (cacheName, O_RDONLY)) < 0)
+      return false;
+   if ((fstat (fd, &st) != 0) || (st.st_size < (off_t) sizeof (GribCacheHeader)) ||
+      (read (fd, &header, sizeof (header)) != (ssize_t) sizeof (header))) {
+      close (fd);
+      return false;
+   }
+   if ((memcmp (header.magic, ref.magic, sizeof (ref.magic)) != 0) || (header.version != ref.version) ||
+      (header.sizeOfZone != ref.sizeOfZone) || (header.sizeOfFlowP != ref.sizeOfFlowP) ||
+      (header.srcSize != ref.srcSize) || (header.srcMtime != ref.srcMtime) || (header.srcMtimeNsec != ref.srcMtimeNsec) ||
+      (header.srcIno != ref.srcIno) || ((uint64_t) st.st_size != sizeof (GribCacheHeader) + header.nFlowP * sizeof (FlowP))) {
+      close (fd);
+      printf ("In readGribCache: %s obsolete\n", cacheName);
+      return false;
+   }
+   void *map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close (fd);
+   if (map == MAP_FAILED) {
+      fprintf (stderr, "In readGribCache, Error mmap: %s\n", cacheName);
+      return false;
+   }
+   gribStoreFree (store);
+   store->map = map;
+   store->mapLen = st.st_size;
+   store->data = (FlowP *) ((char *) map + sizeof (GribCacheHeader));
+   *zone = header.zone;
+   printf ("In readGribCache: %s mapped\n", cacheName);
+   return true;
+}
+
+/*! write decoded gribData and zone in cache file of fileName
+   written in temporary file of unique name then renamed so that a reader never see a partial cache
+   and concurrent writers (threads or processes sharing grib directory) never mix their content */
+static bool writeGribCache (const char *fileName, const Zone *zone, const FlowP *gribData) {
+   char cacheName [MAX_SIZE_FILE_NAME + sizeof (GRIB_CACHE_SUFFIX)];
+   char tmpName [MAX_SIZE_FILE_NAME + sizeof (GRIB_CACHE_SUFFIX) + 8];
+   GribCacheHeader header;
+   FILE *f = NULL;
+   int fd;
+   const size_t nFlowP = (zone->nTimeStamp + 1) * zone->nbLat * zone->nbLon;
+
+   if (! gribCacheHeader (fileName, zone, nFlowP, &header))
+      return false;
+   snprintf (cacheName, sizeof (cacheName), "%s%s", fileName, GRIB_CACHE_SUFFIX);
+   snprintf (tmpName, sizeof (tmpName), "%s.XXXXXX", cacheName);
+   if (((fd = mkstemp (tmpName)) < 0) || (fchmod (fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) != 0) || 
+      ((f = fdopen (fd, "wb")) == NULL)) {
+      fprintf (stderr, "In writeGribCache, Error unable to open: %s\n", tmpName);
+      if (fd >= 0) {
+         close (fd);
+         remove (tmpName);
+      }
+      return false;
+   }
+   bool ok = (fwrite (&header, sizeof (header), 1, f) == 1) &&
+             (fwrite (gribData, sizeof (FlowP), nFlowP, f) == nFlowP);
+   ok = (fclose (f) == 0) && ok;
+   if (! ok || (rename (tmpName, cacheName) != 0)) {
+      fprintf (stderr, "In writeGribCache, Error writing: %s\n", cacheName);
+      remove (tmpName);
+      return false;
+   }
+   printf ("In writeGribCache: %s written\n", cacheName);
+   return true;
+}
+
+/*! work of one decoding thread: messages whose time slot modulo nWorkers is iWorker
+   each thread reads its messages from its own stream of the file */
+typedef struct {
+   const char *fileName;
+   const Zone *zone;
+   FlowP *gribData;
+   GribMessage *msg;
+   size_t nMsg;
+   int iWorker;
+   int nWorkers;
+   bool ok;
+} GribDecodeJob;
+
+/*! offset in FlowP of the field of message, -1 if message has no field stored */
+static long fieldOffset (const GribMessage *msg) {
+   const long GUST_GFS = 180;
+   const char *shortName = msg->shortName;
+   if ((strcmp (shortName, "10u") == 0) || (strcmp (shortName, "ucurr") == 0))
+      return offsetof (FlowP, u);
+   if ((strcmp (shortName, "10v") == 0) || (strcmp (shortName, "vcurr") == 0))
+      return offsetof (FlowP, v);
+   if (strcmp (shortName, "gust") == 0)
+      return offsetof (FlowP, g);
+   if (strcmp (shortName, "swh") == 0)          // waves
+      return offsetof (FlowP, w);
+   if (msg->indicatorOfParameter == GUST_GFS)   // find gust in GFS file specific parameter = 180
+      return offsetof (FlowP, g);
+   return -1;
+}
+
+/*! read message msg of file f in buffer, enlarged if needed, and create its handle
+   buffer must be kept until handle is deleted. Return NULL if error */
+static codes_handle *gribMessageHandle (FILE *f, const GribMessage *msg, unsigned char **buffer, size_t *bufferLen) {
+   if (msg->length > *bufferLen) {
+      unsigned char *newBuffer = realloc (*buffer, msg->length);
+      if (newBuffer == NULL) {
+         fprintf (stderr, "In gribMessageHandle: error in memory allocation\n");
+         return NULL;
+      }
+      *buffer = newBuffer;
+      *bufferLen = msg->length;
+   }
+   if ((fseek (f, msg->offset, SEEK_SET) != 0) || (fread (*buffer, 1, msg->length, f) != msg->length)) {
+      fprintf (stderr, "In gribMessageHandle: Error reading message at offset: %ld\n", msg->offset);
+      return NULL;
+   }
+   codes_handle *h = codes_handle_new_from_message (0, *buffer, msg->length);
+   if ((h != NULL) && msg->bitmapPresent)
+      CODES_CHECK (codes_set_double (h, "missingValue", MISSING), 0);
+   return h;
+}
+
+/*! decode values of message handle h in gribData
+   time slot and field are resolved once for the message
+   return false if a value is outside the time slot of the message */
+static bool decodeMessage (codes_handle *h, const GribMessage *msg, const Zone *zone, FlowP *gribData) {
    int err = 0;
    long iGrib;
-   long bitmapPresent  = 0, timeStep, oldTimeStep;
-   double lat, lon, val, indicatorOfParameter;
-   char shortName [MAX_SIZE_SHORT_NAME];
-   size_t lenName;
-   const long GUST_GFS = 180;
+   double lat, lon, val;
+   const long slotSize = zone->nbLat * zone->nbLon;
+   FlowP *slot = gribData + msg->iT * slotSize;  // iT = nTimeStamp (time not found) is the spare slot
+   const long offset = fieldOffset (msg);
+
+   // A new iterator on lat/lon/values is created from the message handle h.
+   codes_iterator* iter = codes_grib_iterator_new (h, 0, &err);
+   if (err != CODES_SUCCESS) CODES_CHECK(err, 0);
+
+   // Loop on all the lat/lon/values.
+   while (codes_grib_iterator_next(iter, &lat, &lon, &val)) {
+      if (! (zone -> anteMeridian))
+         lon = lonCanonize (lon);
+      iGrib = indLat (lat, zone) * zone->nbLon + indLon (lon, zone);
+      if ((iGrib < 0) || (iGrib >= slotSize)) {
+         fprintf (stderr, "In decodeMessage: Error iGrib : %ld\n", iGrib); 
+         codes_grib_iterator_delete (iter);
+         return false;
+      }
+      // printf("%.2f %.2f %.2lf %ld %ld %s\n", lat, lon, val, msg->timeStep, iGrib, msg->shortName);
+      slot [iGrib].lat = lat; 
+      slot [iGrib].lon = lon; 
+      if (offset >= 0)
+         *(float *) ((char *) &slot [iGrib] + offset) = val;
+   }
+   codes_grib_iterator_delete (iter);
+   return true;
+}
+
+/*! thread entry: decode in file order all messages of the time slots of the job 
+   so that each time slot of gribData is written by one thread only */
+static gpointer decodeMessagesThread (gpointer data) {
+   GribDecodeJob *job = (GribDecodeJob *) data;
+   unsigned char *buffer = NULL;                  // one message at a time
+   size_t bufferLen = 0;
+   FILE *f = fopen (job->fileName, "rb");
+   if (f == NULL) {
+      fprintf (stderr, "In decodeMessagesThread, Error unable to open file %s\n", job->fileName);
+      job->ok = false;
+      return NULL;
+   }
+   for (size_t i = 0; i < job->nMsg; i += 1) {
+      if ((job->msg [i].iT % job->nWorkers) != job->iWorker)
+         continue;
+      codes_handle *h = gribMessageHandle (f, &job->msg [i], &buffer, &bufferLen);
+      bool ok = (h != NULL) && decodeMessage (h, &job->msg [i], job->zone, job->gribData);
+      if (h != NULL)
+         codes_handle_delete (h);
+      if (! ok) {
+         job->ok = false;
+         break;
+      }
+   }
+   free (buffer);
+   fclose (f);
+   return NULL;
+}
+
+/*! decode grib file using eccodes C API: one traversal recording messages, then decoding
+   messages are read again from their location and decoded concurrently by nThreads threads, 
+   each one owning a set of time slots, or by calling thread only if ecCodes is not thread safe
+   Only one message per thread is in memory with decoded data
+   return true if OK */
+static bool decodeGrib (const char *fileName, int nThreads, Zone *zone, GribStore *store) {
+   long timeStep, oldTimeStep;
    char str [MAX_SIZE_LINE];
+   GribDecodeJob job [MAX_N_THREADS];
+   GThread *worker [MAX_N_THREADS];
+   
    zone->wellDefined = false;
-   if (! readGribLists (fileName, zone)) {
-      return false;
-   }
-   if (! readGribParameters (fileName, zone)) {
+   GribMessages messages = {NULL, 0, 0};
+   if (! readGribMessages (fileName, zone, &messages)) {
+      gribMessagesFree (&messages);
       return false;
    }
    if (zone -> nDataDate > 1) {
-      fprintf (stderr, "In readGribAll, Error Grib file with more than 1 dataDate not supported nDataDate: %zu\n", 
+      fprintf (stderr, "In decodeGrib, Error Grib file with more than 1 dataDate not supported nDataDate: %zu\n", 
          zone -> nDataDate);
+      gribMessagesFree (&messages);
       return false;
    }
 
-   if (tGribData [iFlow] != NULL) {
-      free (tGribData [iFlow]); 
-      tGribData [iFlow] = NULL;
-   }
-   if ((tGribData [iFlow] = calloc ((zone->nTimeStamp + 1) * zone->nbLat * zone->nbLon, sizeof (FlowP))) == NULL) { // nTimeStamp + 1
-      fprintf (stderr, "In readGribAll, Error calloc tGribData [iFlow]\n");
+   gribStoreFree (store);
+   if ((store->data = calloc ((zone->nTimeStamp + 1) * zone->nbLat * zone->nbLon, sizeof (FlowP))) == NULL) { // nTimeStamp + 1
+      fprintf (stderr, "In decodeGrib, Error calloc gribData\n");
+      gribMessagesFree (&messages);
       return false;
    }
-   printf ("In readGribAll.: %s allocated\n", 
+   printf ("In decodeGrib: %s allocated\n", 
       formatThousandSep (str, sizeof (str), sizeof(FlowP) * (zone->nTimeStamp + 1) * zone->nbLat * zone->nbLon));
    
-   // Message handle. Required in all the ecCodes calls acting on a message.
-   codes_handle* h = NULL;
-   // Iterator on lat/lon/values.
-   codes_iterator* iter = NULL;
-   if ((f = fopen (fileName, "rb")) == NULL) {
-      free (tGribData [iFlow]); 
-      tGribData [iFlow] = NULL;
-      fprintf (stderr, "In readGribAll, Error Unable to open file %s\n", fileName);
-      return false;
-   }
    zone->nMessage = 0;
    zone->allTimeStepOK = true;
    timeStep = zone->timeStamp [0];
    oldTimeStep = timeStep;
 
-   // Loop on all the messages in a file
-   while ((h = codes_handle_new_from_file (0, f, PRODUCT_GRIB, &err)) != NULL) {
-      if (err != CODES_SUCCESS) CODES_CHECK (err, 0);
-
-      // Check if a bitmap applies
-      CODES_CHECK (codes_get_long (h, "bitmapPresent", &bitmapPresent), 0);
-      if (bitmapPresent) {
-          CODES_CHECK(codes_set_double (h, "missingValue", MISSING), 0);
-      }
-
-      lenName = MAX_SIZE_SHORT_NAME;
-      CODES_CHECK(codes_get_string (h, "shortName", shortName, &lenName), 0);
-      CODES_CHECK(codes_get_long (h, "step", &timeStep), 0);
+   // Loop on all the messages recorded by readGribMessages: checks in file order before decoding
+   for (size_t iMsg = 0; iMsg < messages.n; iMsg += 1) {
+      GribMessage *msg = &messages.msg [iMsg];
+      timeStep = msg->timeStep;
+      for (msg->iT = 0; msg->iT < (int) zone->nTimeStamp; msg->iT += 1)
+         if (zone->timeStamp [msg->iT] == timeStep)
+            break;
 
       long progressTime = timeStep - oldTimeStep;
 
@@ -714,65 +1113,85 @@ bool readGribAll (const char *fileName, Zone *zone, int iFlow) {
          ) { // check timeStep progress well 
 
          zone->allTimeStepOK = false;
-         fprintf (stderr, "In readGribAll: All time Step Are Not defined message: %d, timeStep: %ld, oldTimeStep: %ld, shortName: %s\n", 
-            zone->nMessage, timeStep, oldTimeStep, shortName);
+         fprintf (stderr, "In decodeGrib: All time Step Are Not defined message: %d, timeStep: %ld, oldTimeStep: %ld, shortName: %s\n", 
+            zone->nMessage, timeStep, oldTimeStep, msg->shortName);
       }
       oldTimeStep = timeStep;
-
-      err = codes_get_double(h, "indicatorOfParameter", &indicatorOfParameter);
-      if (err != CODES_SUCCESS) 
-         indicatorOfParameter = -1;
- 
-      // A new iterator on lat/lon/values is created from the message handle h.
-      iter = codes_grib_iterator_new(h, 0, &err);
-      if (err != CODES_SUCCESS) CODES_CHECK(err, 0);
- 
-      // Loop on all the lat/lon/values.
-      while (codes_grib_iterator_next(iter, &lat, &lon, &val)) {
-         if (! (zone -> anteMeridian))
-            lon = lonCanonize (lon);
-         // printf ("lon : %.2lf\n", lon);
-         iGrib = indexOf (timeStep, lat, lon, zone);
-   
-         if (iGrib == -1) {
-            fprintf (stderr, "In readGribAll: Error iGrib : %ld\n", iGrib); 
-            free (tGribData [iFlow]); 
-            tGribData [iFlow] = NULL;
-            codes_handle_delete (h);
-            codes_grib_iterator_delete (iter);
-            iter = NULL;
-            h = NULL;
-            fclose (f);
-            return false;
-         }
-         // printf("%.2f %.2f %.2lf %ld %ld %s\n", lat, lon, val, timeStep, iGrib, shortName);
-         tGribData [iFlow] [iGrib].lat = lat; 
-         tGribData [iFlow] [iGrib].lon = lon; 
-         if ((strcmp (shortName, "10u") == 0) || (strcmp (shortName, "ucurr") == 0))
-            tGribData [iFlow] [iGrib].u = val;
-         else if ((strcmp (shortName, "10v") == 0) || (strcmp (shortName, "vcurr") == 0))
-            tGribData [iFlow] [iGrib].v = val;
-         else if (strcmp (shortName, "gust") == 0)
-            tGribData [iFlow] [iGrib].g = val;
-         else if (strcmp (shortName, "swh") == 0)     // waves
-            tGribData [iFlow] [iGrib].w = val;
-         else if (indicatorOfParameter == GUST_GFS)   // find gust in GFS file specific parameter = 180
-            tGribData [iFlow] [iGrib].g = val;
-      }
-      codes_grib_iterator_delete (iter);
-      codes_handle_delete (h);
-      iter = NULL;
-      h = NULL;
       // printf ("nMessage: %d\n", zone->nMessage);
       zone->nMessage += 1;
    }
-   // printf ("readGribAll:%s done.\n", fileName);
- 
-   fclose (f);
+
+   int nWorkers = gribThreadSafe () ? MIN (CLAMP (nThreads, 1, MAX_N_THREADS), (int) zone->nTimeStamp) : 1;
+   if (nWorkers < 1) nWorkers = 1;
+   for (int i = 0; i < nWorkers; i += 1)
+      job [i] = (GribDecodeJob) {.fileName = fileName, .zone = zone, .gribData = store->data, .msg = messages.msg, .nMsg = messages.n,
+         .iWorker = i, .nWorkers = nWorkers, .ok = true};
+   for (int i = 1; i < nWorkers; i += 1)
+      worker [i] = g_thread_new ("gribDecode", decodeMessagesThread, &job [i]);
+   decodeMessagesThread (&job [0]);                // calling thread takes the first job
+   for (int i = 1; i < nWorkers; i += 1)
+      g_thread_join (worker [i]);
+   gribMessagesFree (&messages);
+
+   for (int i = 0; i < nWorkers; i += 1) {
+      if (! job [i].ok) {
+         gribStoreFree (store);
+         return false;
+      }
+   }
+   // printf ("readGribStore:%s done.\n", fileName);
    zone->wellDefined = true;
    return true;
 }
 
+/*! read grib file in store, decoded by up to nThreads threads
+   decoded data are taken from cache file if valid, else decoded and cache file written
+   decoding of several files is concurrent only if ecCodes is thread safe
+   return true if OK */
+bool readGribStore (const char *fileName, int nThreads, Zone *zone, GribStore *store) {
+   if (readGribCache (fileName, zone, store))
+      return true;
+   codesLock ();
+   bool ok = decodeGrib (fileName, nThreads, zone, store);
+   codesUnlock ();
+   if (ok)
+      writeGribCache (fileName, zone, store->data);
+   return ok;
+}
+
+/*! read grib file in tGribData [iFlow] with readGribStore. Return true if OK */
+bool readGribAll (const char *fileName, Zone *zone, int iFlow) {
+   gribStore [iFlow].data = tGribData [iFlow];      // tGribData [iFlow] may have been allocated by caller
+   bool ret = readGribStore (fileName, par.nThreads, zone, &gribStore [iFlow]);
+   tGribData [iFlow] = gribStore [iFlow].data;
+   return ret;
+}
+
+/*! thread entry for readGribAllFlows */
+static gpointer readGribAllThread (gpointer data) {
+   GribLoad *load = (GribLoad *) data;
+   load->ret = readGribAll (load->fileName, load->zone, load->iFlow);
+   return NULL;
+}
+
+/*! load concurrently the grib files of load [0..n-1], each one in its own tGribData [iFlow]
+   typically wind and current. iFlow of loads must be different
+   return true if all loads are OK. Result of each load in load [i].ret */
+bool readGribAllFlows (GribLoad load [], int n) {
+   GThread *worker [2];
+   bool ok = true;
+   n = MIN (n, 2);
+   for (int i = 1; i < n; i += 1)
+      worker [i] = g_thread_new ("gribLoad", readGribAllThread, &load [i]);
+   if (n > 0)
+      readGribAllThread (&load [0]);                // calling thread takes the first file
+   for (int i = 1; i < n; i += 1)
+      g_thread_join (worker [i]);
+   for (int i = 0; i < n; i += 1)
+      ok = ok && load [i].ret;
+   return ok;
+}
+
 /*! write Grib information in string */
 char *gribToStr (const Zone *zone, char *str, size_t maxLen) {
    char line [MAX_SIZE_LINE] = "";
@@ -846,12 +1265,10 @@ GString *gribToJson (const char *fileName) {
       g_string_append_printf (jString, "{}\n");
       return jString;
    }
-   if (! readGribLists (gribName, &gZone)) {
-      fprintf (stderr, "In gribToJson Error reading: %s\n", gribName);
-      g_string_append_printf (jString, "{}\n");
-      return jString;
-   }
-   if (! readGribParameters (gribName, &gZone)) {
+   codesLock ();
+   bool ok = readGribMessages (gribName, &gZone, NULL);
+   codesUnlock ();
+   if (! ok) {
       fprintf (stderr, "In gribToJson Error reading: %s\n", gribName);
       g_string_append_printf (jString, "{}\n");
       return jString;
@@ -0,0 +1,197 @@
+/*! \brief Load generator for r3server: concurrent clients posting the same request
+ * \li compilation: see ccl file
+ * \li usage: ./r3load [-k] [-c <clients>] [-n <requests>] [-h <host>] [-b <body>] <port>
+ * \li each client is a thread sending <requests> POST requests in sequence, one connection per request
+ * \li -k: HTTP keep-alive, one connection per client reused for all its requests
+ * \li default body "type=0" (REQ_TEST) measures the server itself, not the routing engine
+ * \li output: one JSON object with throughput and latency percentiles in milliseconds */
+
+#define _POSIX_C_SOURCE 200809L // for getopt and getaddrinfo with -std=c11
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <locale.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#define SYNOPSYS          "[-k] [-c <clients>] [-n <requests>] [-h <host>] [-b <body>] <port>"
+#define MAX_N_CLIENTS     1024
+#define MAX_SIZE_RESPONSE 65536       // read buffer, body is counted but not kept
+
+/*! shared description of load */
+typedef struct {
+   const char *host;
+   const char *port;
+   const char *body;
+   int nRequests;                     // per client
+   bool keepAlive;                    // one connection per client instead of one per request
+} LoadSpec;
+
+/*! one client thread */
+typedef struct {
+   const LoadSpec *spec;
+   double *latency;                   // in seconds, nRequests slots. Negative if error
+} LoadClient;
+
+/*! connect to host:port. Return socket or -1 */
+static int connectServer (const char *host, const char *port) {
+   struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM}, *res, *p;
+   int fd = -1;
+   if (getaddrinfo (host, port, &hints, &res) != 0)
+      return -1;
+   for (p = res; p != NULL; p = p->ai_next) {
+      if ((fd = socket (p->ai_family, p->ai_socktype, p->ai_protocol)) < 0)
+         continue;
+      if (connect (fd, p->ai_addr, p->ai_addrlen) == 0)
+         break;
+      close (fd);
+      fd = -1;
+   }
+   freeaddrinfo (res);
+   return fd;
+}
+
+/*! send whole buffer. Return false if error */
+static bool sendAll (int fd, const char *buffer, size_t len) {
+   while (len > 0) {
+      ssize_t n = send (fd, buffer, len, MSG_NOSIGNAL);
+      if (n <= 0)
+         return false;
+      buffer += n;
+      len -= n;
+   }
+   return true;
+}
+
+/*! read response until Content-Length body received or connection closed. Return false if not HTTP 200 */
+static bool readResponse (int fd) {
+   char buffer [MAX_SIZE_RESPONSE];
+   size_t len = 0;
+   ssize_t n;
+   char *endHeader = NULL;
+   while ((endHeader == NULL) && (len < sizeof (buffer) - 1) && ((n = recv (fd, buffer + len, sizeof (buffer) - len - 1, 0)) > 0)) {
+      len += n;
+      buffer [len] = '\0';
+      endHeader = strstr (buffer, "\r\n\r\n");
+   }
+   if ((endHeader == NULL) || (strncmp (buffer, "HTTP/1.1 200", 12) != 0))
+      return false;
+   size_t received = len - (endHeader + 4 - buffer);
+   const char *cl = g_strstr_len (buffer, endHeader - buffer, "Content-Length:");
+   if (cl == NULL) {                            // no length: read until close
+      while (recv (fd, buffer, sizeof (buffer), 0) > 0);
+      return true;
+   }
+   size_t expected = strtoul (cl + strlen ("Content-Length:"), NULL, 10);
+   while ((received < expected) && ((n = recv (fd, buffer, sizeof (buffer), 0)) > 0))
+      received += n;
+   return received >= expected;
+}
+
+/*! client thread: send requests in sequence and record latency of each */
+static gpointer clientRun (gpointer data) {
+   LoadClient *client = data;
+   const LoadSpec *spec = client->spec;
+   char *request = g_strdup_printf ("POST / HTTP/1.1\r\nHost: %s\r\nUser-Agent: r3load\r\nConnection: %s\r\n"
+      "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %zu\r\n\r\n%s",
+      spec->host, spec->keepAlive ? "keep-alive" : "close", strlen (spec->body), spec->body);
+   size_t requestLen = strlen (request);
+   int fd = -1;
+
+   for (int i = 0; i < spec->nRequests; i += 1) {
+      gint64 start = g_get_monotonic_time ();
+      if (fd < 0)
+         fd = connectServer (spec->host, spec->port);
+      bool ok = (fd >= 0) && sendAll (fd, request, requestLen) && readResponse (fd);
+      if ((fd >= 0) && (! ok || ! spec->keepAlive)) {
+         close (fd);
+         fd = -1;
+      }
+      client->latency [i] = ok ? (g_get_monotonic_time () - start) / 1e6 : -1.0;
+   }
+   if (fd >= 0)
+      close (fd);
+   g_free (request);
+   return NULL;
+}
+
+/*! for qsort of latencies */
+static int compareDouble (const void *a, const void *b) {
+   const double x = *(const double *) a, y = *(const double *) b;
+   return (x > y) - (x < y);
+}
+
+/*! value at percentile p of sorted array of n values */
+static double percentile (const double *sorted, int n, double p) {
+   int i = (int) (p / 100.0 * (n - 1) + 0.5);
+   return sorted [CLAMP (i, 0, n - 1)];
+}
+
+int main (int argc, char *argv []) {
+   int nClients = 8, opt;
+   LoadSpec spec = {.host = "127.0.0.1", .body = "type=0", .nRequests = 100};
+   setlocale (LC_ALL, "C");
+
+   while ((opt = getopt (argc, argv, "kc:n:h:b:")) != -1) {
+      switch (opt) {
+      case 'k': spec.keepAlive = true; break;
+      case 'c': nClients = CLAMP (atoi (optarg), 1, MAX_N_CLIENTS); break;
+      case 'n': spec.nRequests = MAX (1, atoi (optarg)); break;
+      case 'h': spec.host = optarg; break;
+      case 'b': spec.body = optarg; break;
+      default:
+         fprintf (stderr, "Synopsys: %s %s\n", argv [0], SYNOPSYS);
+         return EXIT_FAILURE;
+      }
+   }
+   if (optind != argc - 1) {
+      fprintf (stderr, "Synopsys: %s %s\n", argv [0], SYNOPSYS);
+      return EXIT_FAILURE;
+   }
+   spec.port = argv [optind];
+
+   const int nTotal = nClients * spec.nRequests;
+   double *latency = malloc (nTotal * sizeof (double));
+   LoadClient *clients = malloc (nClients * sizeof (LoadClient));
+   GThread **threads = malloc (nClients * sizeof (GThread *));
+   if ((latency == NULL) || (clients == NULL) || (threads == NULL)) {
+      fprintf (stderr, "In main, Error: no memory\n");
+      return EXIT_FAILURE;
+   }
+
+   gint64 start = g_get_monotonic_time ();
+   for (int i = 0; i < nClients; i += 1) {
+      clients [i] = (LoadClient) {.spec = &spec, .latency = latency + i * spec.nRequests};
+      threads [i] = g_thread_new ("r3load", clientRun, &clients [i]);
+   }
+   for (int i = 0; i < nClients; i += 1)
+      g_thread_join (threads [i]);
+   double elapsed = (g_get_monotonic_time () - start) / 1e6;
+
+   // keep successful requests only, sorted for percentiles
+   int nOk = 0;
+   double sum = 0.0;
+   for (int i = 0; i < nTotal; i += 1) {
+      if (latency [i] >= 0.0) {
+         latency [nOk++] = latency [i];
+         sum += latency [i];
+      }
+   }
+   qsort (latency, nOk, sizeof (double), compareDouble);
+
+   printf ("{\"clients\": %d, \"requests\": %d, \"keepAlive\": %s, \"errors\": %d, \"elapsed\": %.3lf, \"throughput\": %.1lf",
+      nClients, nTotal, spec.keepAlive ? "true" : "false", nTotal - nOk, elapsed, nOk / elapsed);
+   if (nOk > 0)
+      printf (", \"latencyMs\": {\"min\": %.3lf, \"mean\": %.3lf, \"p50\": %.3lf, \"p90\": %.3lf, \"p99\": %.3lf, \"max\": %.3lf}",
+         1000 * latency [0], 1000 * sum / nOk, 1000 * percentile (latency, nOk, 50), 1000 * percentile (latency, nOk, 90),
+         1000 * percentile (latency, nOk, 99), 1000 * latency [nOk - 1]);
+   printf ("}\n");
+
+   free (threads);
+   free (clients);
+   free (latency);
+   return (nOk == nTotal) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L // for st_mtim with -std=c11
 #include <stdbool.h>
 #include <time.h>
 #include <stdio.h>
@@ -20,9 +21,15 @@
 #include <curl/curl.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/epoll.h>
 
 #define SYNOPSYS               "<port> [<parameter file>]"
-#define MAX_SIZE_REQUEST       2048        // Max size from request client
+#define MAX_SIZE_HEADER        8192        // Max size of HTTP header from client
+#define MAX_SIZE_BODY          (1 << 20)   // Max size of POST body from client
+#define KEEP_ALIVE_TIMEOUT     30          // seconds without activity before closing idle or slow connection
+#define MAX_N_EVENTS           64          // epoll events per wait
+#define RESULT_KEY_SIZE        65          // SHA-256 in hexa with terminating null
 #define MAX_SIZE_RESOURCE_NAME 256         // Max size polar or grib name
 #define PATTERN                "GFS"
 #define MAX_SIZE_FEED_BACK     1024
@@ -31,9 +38,21 @@
 
 const char *filter[] = {".csv", ".pol", ".grb", ".grb2", ".log", ".txt", ".par", NULL}; // global filter for REQ_DIR request
 
+static GAsyncQueue *idleContexts = NULL;   // routing contexts recycled between requests, one per heavyPool thread at most
+
+/*! globals par, land mask and forbidden zones are written by REQ_INIT under writer lock,
+   read by routings under way and by other requests under reader lock. Grib and polars are residents */
+static GRWLock dataLock;
+static GMutex logMutex;                    // log and feedback files
+static GMutex tempFileMutex;               // TEMP_FILE_NAME used by REQ_PAR_RAW
+static GThreadPool *lightPool = NULL;      // decode requests and serve short ones
+static GThreadPool *heavyPool = NULL;      // par.routingWorkers threads for long requests: routings and REQ_INIT
+static int epollFd = -1;                   // event loop of all connections
+static gint serverStop = false;            // set by REQ_KILL
+
 enum {REQ_KILL = -1793, REQ_TEST = 0, REQ_ROUTING = 1, REQ_BEST_DEP = 2, REQ_RACE = 3, REQ_POLAR = 4, 
       REQ_GRIB = 5, REQ_DIR = 6, REQ_PAR_RAW = 7, REQ_PAR_JSON = 8, 
-      REQ_INIT = 9, REQ_FEEDBACK = 10, REQ_DUMP_FILE = 11}; // type of request
+      REQ_INIT = 9, REQ_FEEDBACK = 10, REQ_DUMP_FILE = 11, REQ_FLEET = 12}; // type of request
 
 char parameterFileName [MAX_SIZE_FILE_NAME];
 
@@ -58,6 +77,7 @@ typedef struct {
    bool forbid;                              // true if forbid zone (polygons or Earth) are considered
    bool withWaves;                           // true if waves specified in wavePolName file are considered
    bool withCurrent;                         // true if current specified in currentGribName is considered
+   bool prune;                               // for REQ_BEST_DEP true if tries that cannot beat best are abandoned
    double staminaVR;                         // Init stamina
    double motorSpeed;                        // motor speed if used
    double threshold;                         // threshold for motor use
@@ -90,7 +110,26 @@ typedef struct {
    char feedback [MAX_SIZE_FEED_BACK];             // for feed back info
 } ClientRequest; 
 
-ClientRequest clientReq;
+/*! one client connection, kept alive for several requests if client wants. Only the event loop reads
+   and writes the socket. A complete request is handled by lightPool, then heavyPool if long, and the
+   response is given back to the loop with EPOLLOUT. EPOLLONESHOT ensures one thread at a time uses it */
+typedef struct {
+   int fd;                                   // client socket, non blocking
+   int serverPort;
+   char peerIPAddress [INET_ADDRSTRLEN];     // from accept
+   char clientIPAddress [MAX_SIZE_LINE];     // from proxy header if any, else peer
+   GString *in;                              // bytes received not yet consumed by a request
+   char *request;                            // current request, header and body
+   char *postData;                           // body of POST request in request
+   char *userAgent;
+   bool keepAlive;                           // connection stays open after response
+   bool busy;                                // request in a pool thread. Event loop only
+   bool continueSent;                        // interim 100 Continue sent for current request
+   GString *out;                             // response being sent, NULL if none
+   size_t outSent;
+   gint64 lastActive;                        // monotonic time of last read or write
+   ClientRequest clientReq;
+} Connection;
 
 /*! Structure to store file information. */
 typedef struct {
@@ -269,52 +308,602 @@ GString *listDirToJson (char *root, char *dir, bool sortByName, const char **fil
    return json;
 }
 
+enum {RESIDENT_GRIB, RESIDENT_POLAR, RESIDENT_WAVE_POLAR};   // kind of resident file
+enum {BOUND_WIND, BOUND_CURRENT, BOUND_POLAR, BOUND_WAVE_POLAR, N_BOUND};   // residents bound to a request
+
+/*! grib or polar file kept loaded between requests. Data are read only once loaded, so requests
+   bound to it share them without lock. Freed when no more bound and retired: evicted or file changed */
+typedef struct {
+   char key [MAX_SIZE_FILE_NAME + 4];        // kind and file name
+   char fileName [MAX_SIZE_FILE_NAME];
+   int kind;
+   struct stat st;                           // identity of file when loaded, see sameFileVersion
+   size_t bytes;                             // memory used by data
+   int refCount;                             // number of requests bound
+   bool retired;                             // no more in residents table
+   bool loading;                             // in table but data not yet loaded, not in lru
+   GList *link;                              // in residents.lru
+   Zone zone;                                // grib
+   GribStore store;                          // grib
+   PolMat *polMat;                           // polar or wave polar
+   PolMat *sailPolMat;                       // sail polar of polar, NULL if none
+} Resident;
+
+/*! grib and polar files loaded, keyed by kind and file name, least recently used retired beyond RESIDENT_MB.
+   Counters read by REQ_TEST */
+static struct {
+   GMutex mutex;
+   GCond loaded;                             // signaled at end of each load
+   GHashTable *table;                        // key -> Resident
+   GQueue lru;                               // most recently used at head
+   size_t bytes;                             // sum of bytes of residents in table
+   size_t maxBytes;                          // RESIDENT_MB, copied by residentsBudgetSet: loaders do not read par
+   guint64 hits;
+   guint64 loads;
+   guint64 evictions;
+} residents;
+
+/*! one file to acquire by residentAcquireGribs */
+typedef struct {
+   const char *fileName;
+   int nThreads;                             // threads decoding grib
+   Resident *r;                              // result, NULL if error
+   char errMessage [MAX_SIZE_TEXT];
+} ResidentLoad;
+
+/*! free resident and its data */
+static void residentFree (Resident *r) {
+   gribStoreFree (&r->store);
+   if (r->polMat != NULL)
+      polarGridFree (r->polMat);
+   if (r->sailPolMat != NULL)
+      polarGridFree (r->sailPolMat);
+   g_free (r->polMat);
+   g_free (r->sailPolMat);
+   g_free (r);
+}
+
+/*! memory used by polar matrix and its compiled grid */
+static size_t polMatBytes (const PolMat *mat) {
+   return sizeof (PolMat) + (mat->nGridLine + 1) * mat->nGridCol * sizeof (double) 
+      + (mat->nGridLine + mat->nGridCol) * sizeof (int);
+}
+
+/*! load data of resident r from its file, grib decoded by nThreads threads. May take time, called without lock
+   other threads wait for end of load while r->loading. Return false if error */
+static bool residentLoad (Resident *r, int nThreads, char *errMessage, size_t maxLen) {
+   char sailPolFileName [MAX_SIZE_NAME] = "";
+   char sailErrMessage [MAX_SIZE_TEXT] = "";
+   const char *fileName = r->fileName;
+
+   if (r->kind == RESIDENT_GRIB) {
+      if (! readGribStore (fileName, nThreads, &r->zone, &r->store)) {
+         snprintf (errMessage, maxLen, "Error reading grib: %s", fileName);
+         return false;
+      }
+      r->bytes = (r->store.map != NULL) ? r->store.mapLen 
+         : (r->zone.nTimeStamp + 1) * r->zone.nbLat * r->zone.nbLon * sizeof (FlowP);
+      printf ("Grib loaded    : %s\n", fileName);
+      return true;
+   }
+   r->polMat = g_new0 (PolMat, 1);
+   if (! readPolar (false, fileName, r->polMat, errMessage, maxLen))
+      return false;
+   r->bytes = polMatBytes (r->polMat);
+   printf ("Polar loaded   : %s\n", fileName);
+   if (r->kind == RESIDENT_POLAR) {
+      newFileNameSuffix (fileName, "sailpol", sailPolFileName, sizeof (sailPolFileName));
+      r->sailPolMat = g_new0 (PolMat, 1);
+      if (readPolar (false, sailPolFileName, r->sailPolMat, sailErrMessage, sizeof (sailErrMessage))) {
+         r->bytes += polMatBytes (r->sailPolMat);
+         printf ("Sail Pol.loaded: %s\n", sailPolFileName);
+      }
+      else {
+         g_free (r->sailPolMat);
+         r->sailPolMat = NULL;
+      }
+   }
+   return true;
+}
+
+/*! remove resident from table, freed now if not bound, else by last residentRelease. Mutex locked by caller */
+static void residentRetire (Resident *r) {
+   g_hash_table_remove (residents.table, r->key);
+   g_queue_delete_link (&residents.lru, r->link);
+   residents.bytes -= r->bytes;
+   r->retired = true;
+   if (r->refCount == 0)
+      residentFree (r);
+}
+
+/*! retire least recently used residents not bound while beyond RESIDENT_MB. Mutex locked by caller */
+static void residentEvict (void) {
+   GList *l = residents.lru.tail;
+   while ((residents.bytes > residents.maxBytes) && (l != NULL)) {
+      Resident *r = l->data;
+      l = l->prev;
+      if (r->refCount == 0) {
+         residentRetire (r);
+         residents.evictions += 1;
+      }
+   }
+}
+
+/*! set memory budget of residents to residentMB and retire beyond. Writer lock held by caller */
+static void residentsBudgetSet (int residentMB) {
+   g_mutex_lock (&residents.mutex);
+   residents.maxBytes = (size_t) MAX (0, residentMB) * 1024 * 1024;
+   residentEvict ();
+   g_mutex_unlock (&residents.mutex);
+}
+
+/*! true if st is same version of file as ref: inode, size and modification time to the nanosecond
+   so that a file rewritten within the same second is seen as changed */
+static inline bool sameFileVersion (const struct stat *st, const struct stat *ref) {
+   return (st->st_ino == ref->st_ino) && (st->st_size == ref->st_size) &&
+      (st->st_mtim.tv_sec == ref->st_mtim.tv_sec) && (st->st_mtim.tv_nsec == ref->st_mtim.tv_nsec);
+}
+
+/*! bind file of kind: resident if already loaded and file unchanged, else loaded, grib decoded by nThreads threads
+   a file is loaded once: threads asking for it during its load wait for the end of this load
+   return resident to release by residentRelease, or NULL with errMessage */
+static Resident *residentAcquire (int kind, const char *fileName, int nThreads, char *errMessage, size_t maxLen) {
+   char key [MAX_SIZE_FILE_NAME + 4];
+   struct stat st;
+   if (stat (fileName, &st) != 0) {
+      snprintf (errMessage, maxLen, "Error cannot open: %s", fileName);
+      return NULL;
+   }
+   snprintf (key, sizeof (key), "%d:%s", kind, fileName);
+   g_mutex_lock (&residents.mutex);
+   if (residents.table == NULL)
+      residents.table = g_hash_table_new (g_str_hash, g_str_equal);
+   Resident *r;
+   while (((r = g_hash_table_lookup (residents.table, key)) != NULL) && r->loading)
+      g_cond_wait (&residents.loaded, &residents.mutex);
+   if ((r != NULL) && sameFileVersion (&r->st, &st)) {
+      r->refCount += 1;
+      g_queue_unlink (&residents.lru, r->link);
+      g_queue_push_head_link (&residents.lru, r->link);
+      residents.hits += 1;
+      g_mutex_unlock (&residents.mutex);
+      return r;
+   }
+   if (r != NULL)                            // file changed on disk, requests bound keep old data
+      residentRetire (r);
+   r = g_new0 (Resident, 1);                 // placeholder in table until loaded
+   r->kind = kind;
+   r->st = st;
+   r->loading = true;
+   g_strlcpy (r->fileName, fileName, sizeof (r->fileName));
+   g_strlcpy (r->key, key, sizeof (r->key));
+   g_hash_table_insert (residents.table, r->key, r);
+   g_mutex_unlock (&residents.mutex);
+
+   const bool ok = residentLoad (r, nThreads, errMessage, maxLen);
+
+   g_mutex_lock (&residents.mutex);
+   r->loading = false;
+   if (ok) {
+      r->refCount = 1;
+      g_queue_push_head (&residents.lru, r);
+      r->link = residents.lru.head;
+      residents.bytes += r->bytes;
+      residents.loads += 1;
+      residentEvict ();
+   }
+   else g_hash_table_remove (residents.table, r->key);
+   g_cond_broadcast (&residents.loaded);
+   g_mutex_unlock (&residents.mutex);
+   if (! ok) {
+      residentFree (r);
+      return NULL;
+   }
+   return r;
+}
+
+/*! unbind resident, NULL accepted */
+static void residentRelease (Resident *r) {
+   if (r == NULL)
+      return;
+   g_mutex_lock (&residents.mutex);
+   r->refCount -= 1;
+   if (r->retired && (r->refCount == 0))
+      residentFree (r);
+   else residentEvict ();
+   g_mutex_unlock (&residents.mutex);
+}
+
+/*! release all residents of bound and reset them to NULL */
+static void residentsRelease (Resident *bound []) {
+   for (int i = 0; i < N_BOUND; i += 1) {
+      residentRelease (bound [i]);
+      bound [i] = NULL;
+   }
+}
+
+/*! retire all residents, files are loaded again when next bound */
+static void residentsRetireAll (void) {
+   g_mutex_lock (&residents.mutex);
+   while (residents.lru.head != NULL)
+      residentRetire (residents.lru.head->data);
+   g_mutex_unlock (&residents.mutex);
+}
+
+/*! thread entry for residentAcquireGribs */
+static gpointer residentAcquireThread (gpointer data) {
+   ResidentLoad *load = (ResidentLoad *) data;
+   load->r = residentAcquire (RESIDENT_GRIB, load->fileName, load->nThreads, load->errMessage, sizeof (load->errMessage));
+   return NULL;
+}
+
+/*! acquire concurrently the grib files of load [0..n-1], typically wind and current
+   return true if all are OK. Result of each one in load [i].r */
+static bool residentAcquireGribs (ResidentLoad load [], int n) {
+   GThread *worker [2];
+   bool ok = true;
+   n = MIN (n, 2);
+   for (int i = 1; i < n; i += 1)
+      worker [i] = g_thread_new ("gribLoad", residentAcquireThread, &load [i]);
+   if (n > 0)
+      residentAcquireThread (&load [0]);     // calling thread takes the first file
+   for (int i = 1; i < n; i += 1)
+      g_thread_join (worker [i]);
+   for (int i = 0; i < n; i += 1)
+      ok = ok && (load [i].r != NULL);
+   return ok;
+}
+
+/*! residents state and counters for REQ_TEST */
+static void residentsToJson (GString *res) {
+   g_mutex_lock (&residents.mutex);
+   g_string_append_printf (res, "   \"Residents\": {\"bytes\": %zu, \"maxMB\": %d, \"hits\": %" G_GUINT64_FORMAT 
+      ", \"loads\": %" G_GUINT64_FORMAT ", \"evictions\": %" G_GUINT64_FORMAT ", \"files\": [", 
+      residents.bytes, (int) (residents.maxBytes / (1024 * 1024)), residents.hits, residents.loads, residents.evictions);
+   for (GList *l = residents.lru.head; l != NULL; l = l->next) {
+      const Resident *r = l->data;
+      g_string_append_printf (res, "%s\n      [\"%s\", %zu, %d]", (l == residents.lru.head) ? "" : ",", 
+         r->fileName, r->bytes, r->refCount);
+   }
+   g_string_append (res, "]},\n");
+   g_mutex_unlock (&residents.mutex);
+}
+
+/*! one cached result: JSON response of a routing, best departure or race request */
+typedef struct {
+   char key [RESULT_KEY_SIZE];
+   GString *json;
+   GList *link;                              // in resultCache.lru
+} ResultEntry;
+
+/*! LRU cache of results, keyed by hash of request, parameters and files bound. Used by heavyPool threads
+   under mutex, counters read by REQ_TEST. Emptied by REQ_INIT */
+static struct {
+   GMutex mutex;
+   GHashTable *table;                        // key -> ResultEntry
+   GQueue lru;                               // most recently used at head
+   size_t bytes;                             // sum of JSON lengths
+   guint64 hits;
+   guint64 misses;
+   guint64 evictions;
+   guint64 invalidations;
+} resultCache;
+
+/*! free cache entry, called by hash table */
+static void resultEntryFree (gpointer data) {
+   ResultEntry *entry = data;
+   g_string_free (entry->json, TRUE);
+   g_free (entry);
+}
+
+/*! key of request once context bound by checkParamAndBind: request as decoded (memset, so canonical
+   whatever the order of fields), effective parameters, zones and identity of files bound */
+static char *resultCacheKey (int type, const ClientRequest *clientReq, const RoutingContext *ctx, Resident *bound [], char *key) {
+   GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA256);
+   g_checksum_update (checksum, (const guchar *) &type, sizeof (type));
+   g_checksum_update (checksum, (const guchar *) clientReq, sizeof (ClientRequest));
+   g_checksum_update (checksum, (const guchar *) &ctx->par, sizeof (Par));
+   g_checksum_update (checksum, (const guchar *) ctx->data.zone, sizeof (Zone));
+   g_checksum_update (checksum, (const guchar *) ctx->data.currentZone, sizeof (Zone));
+   for (int i = 0; i < N_BOUND; i += 1) {
+      if (bound [i] != NULL) {
+         g_checksum_update (checksum, (const guchar *) &bound [i]->st.st_mtim.tv_sec, sizeof (time_t));
+         g_checksum_update (checksum, (const guchar *) &bound [i]->st.st_mtim.tv_nsec, sizeof (long));
+         g_checksum_update (checksum, (const guchar *) &bound [i]->st.st_size, sizeof (off_t));
+         g_checksum_update (checksum, (const guchar *) &bound [i]->st.st_ino, sizeof (ino_t));
+      }
+   }
+   g_strlcpy (key, g_checksum_get_string (checksum), RESULT_KEY_SIZE);
+   g_checksum_free (checksum);
+   return key;
+}
+
+/*! append cached result of key to res. Return false if not found */
+static bool resultCacheGet (const char *key, GString *res) {
+   if (par.resultCacheMB <= 0)
+      return false;
+   g_mutex_lock (&resultCache.mutex);
+   ResultEntry *entry = (resultCache.table != NULL) ? g_hash_table_lookup (resultCache.table, key) : NULL;
+   if (entry != NULL) {
+      g_queue_unlink (&resultCache.lru, entry->link);
+      g_queue_push_head_link (&resultCache.lru, entry->link);
+      g_string_append_len (res, entry->json->str, entry->json->len);
+      resultCache.hits += 1;
+   }
+   else resultCache.misses += 1;
+   g_mutex_unlock (&resultCache.mutex);
+   if (entry != NULL)
+      printf ("Result from cache: %s\n", key);
+   return entry != NULL;
+}
+
+/*! store copy of res with key, evicting least recently used results beyond RESULT_CACHE_MB */
+static void resultCachePut (const char *key, const GString *res) {
+   const size_t maxBytes = (size_t) MAX (0, par.resultCacheMB) * 1024 * 1024;
+   if (res->len > maxBytes)
+      return;
+   g_mutex_lock (&resultCache.mutex);
+   if (resultCache.table == NULL)
+      resultCache.table = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, resultEntryFree);
+   if (! g_hash_table_contains (resultCache.table, key)) {
+      ResultEntry *entry = g_new (ResultEntry, 1);
+      g_strlcpy (entry->key, key, RESULT_KEY_SIZE);
+      entry->json = g_string_new_len (res->str, res->len);
+      g_queue_push_head (&resultCache.lru, entry);
+      entry->link = resultCache.lru.head;
+      g_hash_table_insert (resultCache.table, entry->key, entry);
+      resultCache.bytes += res->len;
+   }
+   while (resultCache.bytes > maxBytes) {
+      ResultEntry *oldest = g_queue_pop_tail (&resultCache.lru);
+      resultCache.bytes -= oldest->json->len;
+      resultCache.evictions += 1;
+      g_hash_table_remove (resultCache.table, oldest->key);
+   }
+   g_mutex_unlock (&resultCache.mutex);
+}
+
+/*! remove all results, after grib or polar reload */
+static void resultCacheClear (void) {
+   g_mutex_lock (&resultCache.mutex);
+   if ((resultCache.table != NULL) && (g_hash_table_size (resultCache.table) > 0)) {
+      g_queue_clear (&resultCache.lru);
+      g_hash_table_remove_all (resultCache.table);
+      resultCache.bytes = 0;
+      resultCache.invalidations += 1;
+   }
+   g_mutex_unlock (&resultCache.mutex);
+}
+
+/*! cache state and counters for REQ_TEST */
+static void resultCacheToJson (GString *res) {
+   g_mutex_lock (&resultCache.mutex);
+   g_string_append_printf (res, 
+      "   \"Result cache\": {\"entries\": %u, \"bytes\": %zu, \"maxMB\": %d, \"hits\": %" G_GUINT64_FORMAT 
+      ", \"misses\": %" G_GUINT64_FORMAT ", \"evictions\": %" G_GUINT64_FORMAT ", \"invalidations\": %" G_GUINT64_FORMAT "},\n",
+      (resultCache.table != NULL) ? g_hash_table_size (resultCache.table) : 0, resultCache.bytes, par.resultCacheMB,
+      resultCache.hits, resultCache.misses, resultCache.evictions, resultCache.invalidations);
+   g_mutex_unlock (&resultCache.mutex);
+}
+
+enum {SWAP_NONE, SWAP_LOADING, SWAP_READY, SWAP_DONE, SWAP_FAILED};   // state of grib hot swap
+
+/*! default gribs of REQ_INIT loaded by a background thread while requests are served with previous ones.
+   Once loaded and valid, switched over by gribSwapApply when no routing holds globals.
+   Routings already bound keep the data they started with. A new REQ_INIT during a load supersedes it:
+   the loader drops its result and loads the new names */
+static struct {
+   GMutex mutex;
+   GThread *thread;                          // loader, created and joined under writer lock by REQ_INIT, or by main
+   bool running;                             // loader has not yet published its result
+   int generation;                           // incremented by each REQ_INIT, result of older one dropped
+   gint state;                               // SWAP_...
+   char gribFileName [MAX_SIZE_FILE_NAME];   // new default wind grib, empty if none
+   char currentGribFileName [MAX_SIZE_FILE_NAME];
+   int nThreads;                             // threads decoding gribs: loader does not read par
+   Resident *bound [N_BOUND];                // gribs loaded, held until switched over
+   char message [MAX_SIZE_TEXT];             // for REQ_TEST
+} gribSwap;
+
+/*! true if grib loaded seems usable for routing */
+static bool gribValid (const Zone *zone) {
+   return zone->wellDefined && (zone->nbLat > 0) && (zone->nbLon > 0) && (zone->nTimeStamp > 0);
+}
+
+/*! acquire concurrently wind and current gribs (empty name: none) in bound [BOUND_WIND] and bound [BOUND_CURRENT]
+   return false with errMessage if one is not readable or not valid */
+static bool gribPairAcquire (const char *gribFileName, const char *currentGribFileName, int nThreads, Resident *bound [], 
+   char *errMessage, size_t maxLen) {
+   ResidentLoad load [2];
+   int bind [2];
+   int nLoad = 0;
+   bool ok = true;
+   if (gribFileName [0] != '\0') {
+      bind [nLoad] = BOUND_WIND;
+      load [nLoad++] = (ResidentLoad) {.fileName = gribFileName, .nThreads = nThreads};
+   }
+   if (currentGribFileName [0] != '\0') {
+      bind [nLoad] = BOUND_CURRENT;
+      load [nLoad++] = (ResidentLoad) {.fileName = currentGribFileName, .nThreads = nThreads};
+   }
+   residentAcquireGribs (load, nLoad);
+   for (int i = 0; i < nLoad; i += 1) {
+      bound [bind [i]] = load [i].r;
+      if (ok && (load [i].r == NULL)) {
+         g_strlcpy (errMessage, load [i].errMessage, maxLen);
+         ok = false;
+      }
+      else if (ok && ! gribValid (&load [i].r->zone)) {
+         snprintf (errMessage, maxLen, "Error grib not valid: %s", load [i].fileName);
+         ok = false;
+      }
+   }
+   return ok;
+}
+
+/*! make gribs of bound the default ones: names in par, zones in globals for REQ_PAR_JSON. Writer lock held by caller */
+static void gribDefaultsSet (Resident *bound []) {
+   char str [MAX_SIZE_LINE];
+   if (bound [BOUND_WIND] != NULL) {
+      g_strlcpy (par.gribFileName, bound [BOUND_WIND]->fileName, sizeof (par.gribFileName));
+      zone = bound [BOUND_WIND]->zone;
+      printf ("Grib DateTime0 : %s\n", gribDateTimeToStr (zone.dataDate [0], zone.dataTime [0], str, sizeof (str)));
+   }
+   if (bound [BOUND_CURRENT] != NULL) {
+      g_strlcpy (par.currentGribFileName, bound [BOUND_CURRENT]->fileName, sizeof (par.currentGribFileName));
+      currentZone = bound [BOUND_CURRENT]->zone;
+      printf ("Cur grib loaded: %s\n", par.currentGribFileName);
+      printf ("Grib DateTime0 : %s\n", gribDateTimeToStr (currentZone.dataDate [0], currentZone.dataTime [0], str, sizeof (str)));
+   }
+}
+
+/*! switch over to gribs loaded by gribSwapThread if ready. Writer lock held by caller */
+static void gribSwapApply (void) {
+   g_mutex_lock (&gribSwap.mutex);
+   if (g_atomic_int_get (&gribSwap.state) == SWAP_READY) {
+      gribDefaultsSet (gribSwap.bound);
+      residentsRelease (gribSwap.bound);     // stay loaded, now bound by requests
+      snprintf (gribSwap.message, sizeof (gribSwap.message), "switched to: %s", par.gribFileName);
+      g_atomic_int_set (&gribSwap.state, SWAP_DONE);
+      printf ("Grib switched  : %s\n", par.gribFileName);
+   }
+   g_mutex_unlock (&gribSwap.mutex);
+}
+
+/*! background load of new default gribs without lock on globals. Switch over now if no request holds globals,
+   else done by next routing request. Loads again while names changed by a later REQ_INIT during load */
+static gpointer gribSwapThread (gpointer data) {
+   (void) data;
+   char gribFileName [MAX_SIZE_FILE_NAME];
+   char currentGribFileName [MAX_SIZE_FILE_NAME];
+   char errMessage [MAX_SIZE_TEXT];
+   Resident *bound [N_BOUND];
+   gint64 start;
+   int nThreads;
+   bool ok;
+
+   g_mutex_lock (&gribSwap.mutex);
+   for (;;) {
+      const int generation = gribSwap.generation;
+      g_strlcpy (gribFileName, gribSwap.gribFileName, sizeof (gribFileName));
+      g_strlcpy (currentGribFileName, gribSwap.currentGribFileName, sizeof (currentGribFileName));
+      nThreads = gribSwap.nThreads;
+      g_mutex_unlock (&gribSwap.mutex);
+
+      memset (bound, 0, sizeof (bound));
+      errMessage [0] = '\0';
+      start = g_get_monotonic_time ();
+      ok = gribPairAcquire (gribFileName, currentGribFileName, nThreads, bound, errMessage, sizeof (errMessage));
+
+      g_mutex_lock (&gribSwap.mutex);
+      if (generation == gribSwap.generation)
+         break;
+      residentsRelease (bound);              // superseded, new names to load
+      printf ("Grib swap superseded: %s\n", gribFileName);
+   }
+   if (ok) {
+      memcpy (gribSwap.bound, bound, sizeof (bound));
+      snprintf (gribSwap.message, sizeof (gribSwap.message), "ready in %.3lf s: %s", 
+         (g_get_monotonic_time () - start) / 1e6, gribSwap.gribFileName);
+      g_atomic_int_set (&gribSwap.state, SWAP_READY);
+   }
+   else {
+      residentsRelease (bound);
+      snprintf (gribSwap.message, sizeof (gribSwap.message), "failed, previous grib kept: %s", errMessage);
+      g_atomic_int_set (&gribSwap.state, SWAP_FAILED);
+      fprintf (stderr, "In gribSwapThread, %s\n", errMessage);
+   }
+   gribSwap.running = false;
+   g_mutex_unlock (&gribSwap.mutex);
+
+   if (ok && g_rw_lock_writer_trylock (&dataLock)) {
+      gribSwapApply ();
+      g_rw_lock_writer_unlock (&dataLock);
+   }
+   return NULL;
+}
+
+/*! wait for end of background load if any, at exit. Gribs not switched over are released */
+static void gribSwapJoin (void) {
+   if (gribSwap.thread == NULL)
+      return;
+   g_thread_join (gribSwap.thread);
+   gribSwap.thread = NULL;
+   g_mutex_lock (&gribSwap.mutex);
+   residentsRelease (gribSwap.bound);
+   if (g_atomic_int_get (&gribSwap.state) == SWAP_READY)
+      g_atomic_int_set (&gribSwap.state, SWAP_NONE);
+   g_mutex_unlock (&gribSwap.mutex);
+}
+
+/*! grib hot swap state for REQ_TEST */
+static void gribSwapToJson (GString *res) {
+   const char *stateName [] = {"none", "loading", "ready", "done", "failed"};
+   g_mutex_lock (&gribSwap.mutex);
+   g_string_append_printf (res, "   \"Grib swap\": {\"state\": \"%s\", \"message\": \"%s\"},\n", 
+      stateName [g_atomic_int_get (&gribSwap.state)], gribSwap.message);
+   g_mutex_unlock (&gribSwap.mutex);
+}
+
 /*! Make initialization  
-   return false if readParam or readGribAll fail */
-static bool initContext (const char *parameterFileName, const char *pattern) {
+   default grib and polars are loaded as residents, zones copied in globals for REQ_PAR_JSON
+   if background, gribs are loaded by gribSwapThread while requests go on with previous ones.
+   A background load in progress is not waited for: its loader takes the new names
+   return false if readParam or default grib load fail */
+static bool initContext (const char *parameterFileName, const char *pattern, bool background) {
    char directory [MAX_SIZE_DIR_NAME];
-   char str [MAX_SIZE_LINE];
    char errMessage [MAX_SIZE_TEXT] = "";
-   bool readGribRet;
-   char sailPolFileName [MAX_SIZE_NAME] = "";
+   char oldGribFileName [MAX_SIZE_FILE_NAME];
+   char oldCurrentGribFileName [MAX_SIZE_FILE_NAME];
+   Resident *bound [N_BOUND] = {NULL};
 
+   g_strlcpy (oldGribFileName, par.gribFileName, sizeof (oldGribFileName));
+   g_strlcpy (oldCurrentGribFileName, par.currentGribFileName, sizeof (oldCurrentGribFileName));
    if (! readParam (parameterFileName)) {
       fprintf (stderr, "In initContext, Error readParam: %s\n", parameterFileName);
       return false;
    }
    printf ("Parameters File: %s\n", parameterFileName);
+   residentsBudgetSet (par.residentMB);
    if (par.mostRecentGrib) {  // most recent grib will replace existing grib
       snprintf (directory, sizeof (directory), "%sgrib", par.workingDir); 
       mostRecentFile (directory, ".gr", pattern, par.gribFileName, sizeof (par.gribFileName));
    }
-   if (par.gribFileName [0] != '\0') {
-      readGribRet = readGribAll (par.gribFileName, &zone, WIND);
-      if (! readGribRet) {
-         fprintf (stderr, "In initContext, Error: Unable to read grib file: %s\n ", par.gribFileName);
-         return false;
+   resultCacheClear ();                // polars, land mask and parameters reloaded
+
+   if (background) {                   // previous gribs stay the default ones until switch over
+      g_mutex_lock (&gribSwap.mutex);
+      g_strlcpy (gribSwap.gribFileName, par.gribFileName, sizeof (gribSwap.gribFileName));
+      g_strlcpy (gribSwap.currentGribFileName, par.currentGribFileName, sizeof (gribSwap.currentGribFileName));
+      gribSwap.nThreads = par.nThreads;
+      gribSwap.generation += 1;
+      residentsRelease (gribSwap.bound);     // ready but not switched over: superseded
+      snprintf (gribSwap.message, sizeof (gribSwap.message), "loading: %s", gribSwap.gribFileName);
+      g_atomic_int_set (&gribSwap.state, SWAP_LOADING);
+      const bool running = gribSwap.running;
+      gribSwap.running = true;
+      g_mutex_unlock (&gribSwap.mutex);
+      g_strlcpy (par.gribFileName, oldGribFileName, sizeof (par.gribFileName));
+      g_strlcpy (par.currentGribFileName, oldCurrentGribFileName, sizeof (par.currentGribFileName));
+      if (! running) {                 // else running loader takes new names
+         if (gribSwap.thread != NULL)  // previous loader has ended or only tries switch over
+            g_thread_join (gribSwap.thread);
+         gribSwap.thread = g_thread_new ("gribSwap", gribSwapThread, NULL);
       }
-      printf ("Grib loaded    : %s\n", par.gribFileName);
-      printf ("Grib DateTime0 : %s\n", gribDateTimeToStr (zone.dataDate [0], zone.dataTime [0], str, sizeof (str)));
    }
-
-   if (par.currentGribFileName [0] != '\0') {
-      readGribRet = readGribAll (par.currentGribFileName, &zone, WIND);
-      printf ("Cur grib loaded: %s\n", par.currentGribFileName);
-      printf ("Grib DateTime0 : %s\n", gribDateTimeToStr (currentZone.dataDate [0], currentZone.dataTime [0], str, sizeof (str)));
-   }
-   if (readPolar (true, par.polarFileName, &polMat, errMessage, sizeof (errMessage))) {
-      printf ("Polar loaded   : %s\n", par.polarFileName);
-      newFileNameSuffix (par.polarFileName, "sailpol", sailPolFileName, sizeof (sailPolFileName));
-      if (readPolar (false, sailPolFileName, &sailPolMat, errMessage, sizeof (errMessage)))
-         printf ("Sail Pol.loaded: %s\n", sailPolFileName);
+   else {
+      if (! gribPairAcquire (par.gribFileName, par.currentGribFileName, par.nThreads, bound, errMessage, sizeof (errMessage))) {
+         fprintf (stderr, "In initContext, Error: Unable to read grib file: %s\n ", errMessage);
+         residentsRelease (bound);
+         return false;
+      }
+      gribDefaultsSet (bound);
    }
-   else
+   if ((bound [BOUND_POLAR] = residentAcquire (RESIDENT_POLAR, par.polarFileName, 1, errMessage, sizeof (errMessage))) == NULL)
       fprintf (stderr, "In initContext, Error readPolar: %s\n", errMessage);
-      
-   if (readPolar (true, par.wavePolFileName, &wavePolMat, errMessage, sizeof (errMessage)))
-      printf ("Polar loaded   : %s\n", par.wavePolFileName);
-   else
+   if ((bound [BOUND_WAVE_POLAR] = residentAcquire (RESIDENT_WAVE_POLAR, par.wavePolFileName, 1, errMessage, sizeof (errMessage))) == NULL)
       fprintf (stderr, "In initContext, Error readPolar: %s\n", errMessage);
+   residentsRelease (bound);           // stay loaded for next requests
   
    printf ("par.web        : %s\n", par.web);
    nIsoc = 0;
@@ -327,23 +916,27 @@ static bool initContext (const char *parameterFileName, const char *pattern) {
 }
 
 /*! date for logging */
-static const char* getCurrentDate () {
-   static char dateBuffer [100];
-   time_t now = time (NULL);
-   struct tm *tm_info = gmtime(&now);
-   strftime (dateBuffer, sizeof(dateBuffer), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+static const char* getCurrentDate (char *dateBuffer, size_t maxLen) {
+   GDateTime *now = g_date_time_new_now_utc ();
+   gchar *str = g_date_time_format (now, "%Y-%m-%d %H:%M:%S UTC");
+   g_strlcpy (dateBuffer, str, maxLen);
+   g_free (str);
+   g_date_time_unref (now);
    return dateBuffer;
 }
 
 /*! store feeed back information */
 static void handleFeedbackRequest (const char *fileName, const char *date, const char *clientIPAddress, const char *string) {
+   g_mutex_lock (&logMutex);
    FILE *file = fopen (fileName, "a");
    if (file == NULL) {
+      g_mutex_unlock (&logMutex);
       fprintf (stderr, "handleFeedbackRequest, Error opening file: %s\n", fileName);
       return;
    }
    fprintf (file, "%s; %s; \n%s\n\n", date, clientIPAddress, string);
    fclose (file);
+   g_mutex_unlock (&logMutex);
 }
 
 /*! log client Request 
@@ -351,17 +944,19 @@ static void handleFeedbackRequest (const char *fileName, const char *date, const
 static void logRequest (const char* fileName, const char *date, int serverPort, const char *remote_addr, \
    char *dataReq, const char *userAgent, ClientRequest *client, double duration) {
 
+   g_strstrip (dataReq);
+   g_strdelimit (dataReq, "\r\n", ' ');
+   g_mutex_lock (&logMutex);
    FILE *logFile = fopen (fileName, "a");
    if (logFile == NULL) {
+      g_mutex_unlock (&logMutex);
       fprintf (stderr, "In logRequest, Error opening log file: %s\n", fileName);
       return;
    }
-   g_strstrip (dataReq);
-   g_strdelimit (dataReq, "\r\n", ' ');
-   
    fprintf (logFile, "%s; %d; %-16.16s; %-30.30s; %2d; %6.2lf, %.50s\n", 
       date, serverPort, remote_addr, userAgent, client->type, duration, dataReq);
    fclose (logFile);
+   g_mutex_unlock (&logMutex);
 }
 
 /*! decode request from client and fill ClientRequest structure 
@@ -457,6 +1052,8 @@ static bool decodeHttpReq (const char *req, ClientRequest *clientReq) {
       else if (g_str_has_prefix (parts[i], "forbid=false")) clientReq->forbid = false;          // Default false
       else if (g_str_has_prefix (parts[i], "withWaves=true")) clientReq->withWaves = true;      // Default false
       else if (g_str_has_prefix (parts[i], "withWaves=false")) clientReq->withWaves = false;    // Default false
+      else if (g_str_has_prefix (parts[i], "prune=true")) clientReq->prune = true;              // Default false
+      else if (g_str_has_prefix (parts[i], "prune=false")) clientReq->prune = false;            // Default false
       else if (g_str_has_prefix (parts[i], "withCurrent=true")) clientReq->withCurrent = true;  // Default false
       else if (g_str_has_prefix (parts[i], "withCurrent=false")) clientReq->withCurrent = false;// Default false
       else if (g_str_has_prefix (parts[i], "sortByName=true")) clientReq->sortByName = true;    // Default false
@@ -480,177 +1077,180 @@ static bool decodeHttpReq (const char *req, ClientRequest *clientReq) {
    return clientReq->type != -1;  
 }
 
-/*! check validity of parameters */
-static bool checkParamAndUpdate (ClientRequest *clientReq, char *checkMessage, size_t maxLen) {
-   char strPolar [MAX_SIZE_FILE_NAME];
-   char strGrib [MAX_SIZE_FILE_NAME];
-   char sailPolFileName [MAX_SIZE_NAME] = "";
+/*! check validity of parameters and bind ctx, initialized from globals, to request parameters and to
+   grib and polar files named by request, or default ones. Files not resident are loaded, MAY TAKE TIME.
+   Globals are not modified. Residents bound are to be released by caller, even if error */
+static bool checkParamAndBind (ClientRequest *clientReq, RoutingContext *ctx, Resident *bound [], char *checkMessage, size_t maxLen) {
    char errMessage [MAX_SIZE_TEXT] = "";
+   Par *p = &ctx->par;
    // printf ("startInfo after: %s, startTime: %lf\n", asctime (&startInfo), par.startTimeInHours);
    if ((clientReq->nBoats == 0) || (clientReq->nWp == 0)) {
       snprintf (checkMessage, maxLen, "\"1: No boats or no Waypoints\"");
       return false;
    }
-   par.allwaysSea = !clientReq->forbid;
-   par.cogStep = MAX (1, clientReq->cogStep);
-   par.rangeCog = clientReq->rangeCog;
-   par.jFactor = clientReq->jFactor; 
-   par.kFactor = clientReq->kFactor; 
-   par.nSectors = clientReq->nSectors; 
-   par.penalty0 = clientReq->penalty0;  // seconds
-   par.penalty1 = clientReq->penalty1;  // seconds 
-   par.penalty2 = clientReq->penalty2;  // seconds
-   par.motorSpeed = clientReq->motorSpeed;
-   par.threshold = clientReq->threshold;
-   par.nightEfficiency = clientReq->nightEfficiency;
-   par.dayEfficiency = clientReq->dayEfficiency;
-   par.xWind = clientReq->xWind;
-   par.maxWind = clientReq->maxWind;
-   par.withWaves = clientReq->withWaves;
-   par.withCurrent = clientReq->withCurrent;
-   par.constWindTws = clientReq->constWindTws;
-   par.constWindTwd = clientReq->constWindTwd;
-   par.constWave = clientReq->constWave;
-   par.constCurrentS = clientReq->constCurrentS;
-   par.constCurrentD = clientReq->constCurrentD;
-
-   // change polar if requested
-   if (clientReq->polarName [0] != '\0') {
-      buildRootName (clientReq->polarName, strPolar, sizeof (strPolar));
-      printf ("polar found: %s\n", strPolar);
-      if (strncmp (par.polarFileName, strPolar, strlen (strPolar)) != 0) {
-         printf ("read polar: %s\n", strPolar);
-         if (readPolar (false, strPolar, &polMat, checkMessage, maxLen)) {
-            g_strlcpy (par.polarFileName, strPolar, sizeof (par.polarFileName));
-            printf ("Polar loaded   : %s\n", strPolar);
-            newFileNameSuffix (par.polarFileName, "sailpol", sailPolFileName, sizeof (sailPolFileName));
-            if (readPolar (false, sailPolFileName, &sailPolMat, errMessage, sizeof (errMessage)))
-               printf ("Sail Pol.loaded: %s\n", sailPolFileName);
-         }
-         else {
-            snprintf (checkMessage, maxLen, "\"2: Error reading Polar: %s\"", clientReq->polarName);
-            return false;
-         }
-      }  
-   }
-   if (clientReq->wavePolName [0] != '\0') {
-      buildRootName (clientReq->wavePolName, strPolar, sizeof (strPolar));
-      printf ("wave polar found: %s\n", strPolar);
-      if (strncmp (par.wavePolFileName, strPolar, strlen (strPolar)) != 0) {
-         printf ("read wave polar: %s\n", strPolar);
-         if (readPolar (false, strPolar, &wavePolMat, checkMessage, maxLen)) {
-            g_strlcpy (par.wavePolFileName, strPolar, sizeof (par.wavePolFileName));
-            printf ("Wave Polar loaded : %s\n", strPolar);
-         }
-         else {
-            snprintf (checkMessage, maxLen, "\"2: Error reading Wave Polar: %s\"", clientReq->wavePolName);
-            return false;
-         }
-      }  
-   }
-   // change grib if requested MAY TAKE TIME !!!!
-   if (clientReq->gribName [0] != '\0') {
-      buildRootName (clientReq->gribName, strGrib, sizeof (strGrib));
-      printf ("grib found: %s\n", strGrib);
-      if (strncmp (par.gribFileName, strGrib, strlen (strGrib)) != 0) {
-         printf ("readGrib: %s\n", strGrib);
-         if (readGribAll (strGrib, &zone, WIND)) {
-            g_strlcpy (par.gribFileName, strGrib, sizeof (par.gribFileName));
-            printf ("Grib loaded   : %s\n", strGrib);
-         }
-         else {
-            snprintf (checkMessage, maxLen, "\"3: Error reading Grib: %s\"", clientReq->gribName);
-            return false;
-         }
-      }  
+   p->allwaysSea = !clientReq->forbid;
+   p->cogStep = MAX (1, clientReq->cogStep);
+   p->rangeCog = clientReq->rangeCog;
+   p->jFactor = clientReq->jFactor; 
+   p->kFactor = clientReq->kFactor; 
+   p->nSectors = clientReq->nSectors; 
+   p->penalty0 = clientReq->penalty0;  // seconds
+   p->penalty1 = clientReq->penalty1;  // seconds 
+   p->penalty2 = clientReq->penalty2;  // seconds
+   p->motorSpeed = clientReq->motorSpeed;
+   p->threshold = clientReq->threshold;
+   p->nightEfficiency = clientReq->nightEfficiency;
+   p->dayEfficiency = clientReq->dayEfficiency;
+   p->xWind = clientReq->xWind;
+   p->maxWind = clientReq->maxWind;
+   p->withWaves = clientReq->withWaves;
+   p->withCurrent = clientReq->withCurrent;
+   p->constWindTws = clientReq->constWindTws;
+   p->constWindTwd = clientReq->constWindTwd;
+   p->constWave = clientReq->constWave;
+   p->constCurrentS = clientReq->constCurrentS;
+   p->constCurrentD = clientReq->constCurrentD;
+
+   // polars: named by request, else default. A default one not readable leaves the global one
+   if (clientReq->polarName [0] != '\0')
+      buildRootName (clientReq->polarName, p->polarFileName, sizeof (p->polarFileName));
+   if ((p->polarFileName [0] != '\0') && 
+      ((bound [BOUND_POLAR] = residentAcquire (RESIDENT_POLAR, p->polarFileName, 1, errMessage, sizeof (errMessage))) == NULL)) {
+      fprintf (stderr, "In checkParamAndBind, Error readPolar: %s\n", errMessage);
+      if (clientReq->polarName [0] != '\0') {
+         snprintf (checkMessage, maxLen, "\"2: Error reading Polar: %s\"", clientReq->polarName);
+         return false;
+      }
+   }
+   if (clientReq->wavePolName [0] != '\0')
+      buildRootName (clientReq->wavePolName, p->wavePolFileName, sizeof (p->wavePolFileName));
+   if ((p->wavePolFileName [0] != '\0') && 
+      ((bound [BOUND_WAVE_POLAR] = residentAcquire (RESIDENT_WAVE_POLAR, p->wavePolFileName, 1, errMessage, sizeof (errMessage))) == NULL)) {
+      fprintf (stderr, "In checkParamAndBind, Error readPolar: %s\n", errMessage);
+      if (clientReq->wavePolName [0] != '\0') {
+         snprintf (checkMessage, maxLen, "\"2: Error reading Wave Polar: %s\"", clientReq->wavePolName);
+         return false;
+      }
    }
 
-   if (clientReq->currentGribName [0] != '\0') {
-      buildRootName (clientReq->currentGribName, strGrib, sizeof (strGrib));
-      printf ("current grib found: %s\n", strGrib);
-      if (strncmp (par.currentGribFileName, strGrib, strlen (strGrib)) != 0) {
-         printf ("current readGrib: %s\n", strGrib);
-         if (readGribAll (strGrib, &currentZone, CURRENT)) {
-            g_strlcpy (par.currentGribFileName, strGrib, sizeof (par.currentGribFileName));
-            printf ("Current Grib loaded   : %s\n", strGrib);
-         }
-         else {
-            snprintf (checkMessage, maxLen, "\"3: Error reading Current Grib: %s\"", clientReq->currentGribName);
-            return false;
-         }
-      }  
+   // gribs: named by request, else default. Wind and current grib loaded concurrently
+   ResidentLoad load [2];
+   int bind [2];
+   int nLoad = 0;
+   if (clientReq->gribName [0] != '\0')
+      buildRootName (clientReq->gribName, p->gribFileName, sizeof (p->gribFileName));
+   if (p->gribFileName [0] != '\0') {
+      bind [nLoad] = BOUND_WIND;
+      load [nLoad++] = (ResidentLoad) {.fileName = p->gribFileName, .nThreads = p->nThreads};
+   }
+   if (clientReq->currentGribName [0] != '\0')
+      buildRootName (clientReq->currentGribName, p->currentGribFileName, sizeof (p->currentGribFileName));
+   if (p->currentGribFileName [0] != '\0') {
+      bind [nLoad] = BOUND_CURRENT;
+      load [nLoad++] = (ResidentLoad) {.fileName = p->currentGribFileName, .nThreads = p->nThreads};
+   }
+   residentAcquireGribs (load, nLoad);
+   for (int i = 0; i < nLoad; i += 1) {
+      const bool isWind = (bind [i] == BOUND_WIND);
+      bound [bind [i]] = load [i].r;
+      if (load [i].r == NULL) {
+         fprintf (stderr, "In checkParamAndBind, %s\n", load [i].errMessage);
+         snprintf (checkMessage, maxLen, "\"3: Error reading %s: %s\"", isWind ? "Grib" : "Current Grib", 
+            isWind ? clientReq->gribName : clientReq->currentGribName);
+         return false;
+      }
    }
 
+   if (bound [BOUND_WIND] != NULL) {
+      ctx->data.zone = &bound [BOUND_WIND]->zone;
+      ctx->data.windData = bound [BOUND_WIND]->store.data;
+   }
+   if (bound [BOUND_CURRENT] != NULL) {
+      ctx->data.currentZone = &bound [BOUND_CURRENT]->zone;
+      ctx->data.currentData = bound [BOUND_CURRENT]->store.data;
+   }
+   if (bound [BOUND_POLAR] != NULL) {
+      ctx->data.polMat = bound [BOUND_POLAR]->polMat;
+      ctx->data.sailPolMat = bound [BOUND_POLAR]->sailPolMat;
+   }
+   if (bound [BOUND_WAVE_POLAR] != NULL)
+      ctx->data.wavePolMat = bound [BOUND_WAVE_POLAR]->polMat;
+   const Zone *z = ctx->data.zone;
+
    if (clientReq->epochStart <= 0)
       clientReq->epochStart = time (NULL); // default value if empty is now
-   time_t theTime0 = gribDateTimeToEpoch (zone.dataDate [0], zone.dataTime [0]);
-   par.startTimeInHours = (clientReq->epochStart - theTime0) / 3600.0;
+   time_t theTime0 = gribDateTimeToEpoch (z->dataDate [0], z->dataTime [0]);
+   p->startTimeInHours = (clientReq->epochStart - theTime0) / 3600.0;
    printf ("Start Time Epoch: %ld, theTime0: %ld\n", clientReq->epochStart, theTime0);
-   printf ("Start Time in Hours after Grib: %.2lf\n", par.startTimeInHours);
-   gchar *gribBaseName = g_path_get_basename (par.gribFileName);
+   printf ("Start Time in Hours after Grib: %.2lf\n", p->startTimeInHours);
+   gchar *gribBaseName = g_path_get_basename (p->gribFileName);
 
-   competitors.n = clientReq->nBoats;
+   ctx->competitors.n = clientReq->nBoats;
    for (int i = 0; i < clientReq->nBoats; i += 1) {
-      if (! par.allwaysSea && ! isSea (tIsSea,  clientReq -> boats [i].lat,  clientReq -> boats [i].lon)) {
+      if (! p->allwaysSea && ! isSea (ctx->data.tIsSea,  clientReq -> boats [i].lat,  clientReq -> boats [i].lon)) {
          snprintf (checkMessage, maxLen, 
             "\"5: Competitor not in sea.\",\n\"name\": \"%s\", \"lat\": %.2lf, \"lon\": %.2lf\n",
             clientReq -> boats [i].name, clientReq -> boats [i].lat, clientReq -> boats [i].lon);
+         g_free (gribBaseName);
          return false;
       }
-      if (! isInZone (clientReq -> boats [i].lat, clientReq -> boats [i].lon, &zone) && (par.constWindTws == 0)) { 
+      if (! isInZone (clientReq -> boats [i].lat, clientReq -> boats [i].lon, z) && (p->constWindTws == 0)) { 
          snprintf (checkMessage, maxLen, 
             "\"6: Competitor not in Grib wind zone.\",\n\"grib\": \"%s\", \"bottomLat\": %.2lf, \"leftLon\": %.2lf, \"topLat\": %.2lf, \"rightLon\": %.2lf\n",
-            gribBaseName, zone.latMin, zone.lonLeft, zone.latMax, zone.lonRight);
+            gribBaseName, z->latMin, z->lonLeft, z->latMax, z->lonRight);
          g_free (gribBaseName);
          return false;
       }
-      g_strlcpy (competitors.t [i].name, clientReq -> boats [i].name, MAX_SIZE_NAME);
-      printf ("competitor name: %s\n", competitors.t [i].name);
-      competitors.t [i].lat = clientReq -> boats [i].lat;
-      competitors.t [i].lon = clientReq -> boats [i].lon;
+      g_strlcpy (ctx->competitors.t [i].name, clientReq -> boats [i].name, MAX_SIZE_NAME);
+      printf ("competitor name: %s\n", ctx->competitors.t [i].name);
+      ctx->competitors.t [i].lat = clientReq -> boats [i].lat;
+      ctx->competitors.t [i].lon = clientReq -> boats [i].lon;
    }
  
    for (int i = 0; i < clientReq->nWp; i += 1) {
-      if (! par.allwaysSea && ! isSea (tIsSea, clientReq->wp [i].lat, clientReq->wp [i].lon)) {
+      if (! p->allwaysSea && ! isSea (ctx->data.tIsSea, clientReq->wp [i].lat, clientReq->wp [i].lon)) {
          snprintf (checkMessage, maxLen, 
             "\"7: WP or Dest. not in sea.\",\n\"lat\": %.2lf, \"lon\": %.2lf\n",
             clientReq->wp [i].lat, clientReq->wp [i].lon);
+         g_free (gribBaseName);
          return false;
       }
-      if (! isInZone (clientReq->wp [i].lat , clientReq->wp [i].lon , &zone) && (par.constWindTws == 0)) {
+      if (! isInZone (clientReq->wp [i].lat , clientReq->wp [i].lon , z) && (p->constWindTws == 0)) {
          snprintf (checkMessage, maxLen, 
             "\"8: WP or Dest. not in Grib wind zone.\",\n\"grib\": \"%s\", \"bottomLat\": %.2lf, \"leftLon\": %.2lf, \"topLat\": %.2lf, \"rightLon\": %.2lf\n",
-            gribBaseName, zone.latMin, zone.lonLeft, zone.latMax, zone.lonRight);
+            gribBaseName, z->latMin, z->lonLeft, z->latMax, z->lonRight);
          g_free (gribBaseName);
          return false;
       }
    }
+   g_free (gribBaseName);
    for (int i = 0; i < clientReq->nWp -1; i += 1) {
-      wayPoints.t[i].lat = clientReq->wp [i].lat; 
-      wayPoints.t[i].lon = clientReq->wp [i].lon; 
+      ctx->wayPoints.t[i].lat = clientReq->wp [i].lat; 
+      ctx->wayPoints.t[i].lon = clientReq->wp [i].lon; 
    }
-   wayPoints.n = clientReq->nWp - 1;
+   ctx->wayPoints.n = clientReq->nWp - 1;
 
-   if ((par.startTimeInHours < 0) || (par.startTimeInHours > zone.timeStamp [zone.nTimeStamp -1])) {
+   if ((p->startTimeInHours < 0) || (p->startTimeInHours > z->timeStamp [z->nTimeStamp -1])) {
          snprintf (checkMessage, maxLen, "\"4: start Time not in Grib time window\"");
       return false;
    }
 
-   par.tStep = clientReq->timeStep / 3600.0;
+   p->tStep = clientReq->timeStep / 3600.0;
 
    // specific for bestTimeDeparture
-   chooseDeparture.count = 0;
-   chooseDeparture.tInterval = clientReq->timeInterval / 3600.0;
-   chooseDeparture.tBegin = par.startTimeInHours;
+   ctx->chooseDeparture.count = 0;
+   ctx->chooseDeparture.tInterval = clientReq->timeInterval / 3600.0;
+   ctx->chooseDeparture.tBegin = p->startTimeInHours;
+   ctx->chooseDeparture.prune = clientReq->prune;
    if (clientReq->timeWindow > 0)
-      chooseDeparture.tEnd = chooseDeparture.tBegin + (clientReq->timeWindow / 3600.0);
+      ctx->chooseDeparture.tEnd = ctx->chooseDeparture.tBegin + (clientReq->timeWindow / 3600.0);
    else
-      chooseDeparture.tEnd = INT_MAX; // all grib window Grib time will be used.
+      ctx->chooseDeparture.tEnd = INT_MAX; // all grib window Grib time will be used.
 
-   par.pOr.lat = clientReq->boats [0].lat;
-   par.pOr.lon = clientReq->boats [0].lon;
-   par.pDest.lat = clientReq->wp [clientReq->nWp-1].lat;
-   par.pDest.lon = clientReq->wp [clientReq->nWp-1].lon;
+   p->pOr.lat = clientReq->boats [0].lat;
+   p->pOr.lon = clientReq->boats [0].lon;
+   p->pDest.lat = clientReq->wp [clientReq->nWp-1].lat;
+   p->pDest.lon = clientReq->wp [clientReq->nWp-1].lon;
    return true;
 }
 
@@ -669,41 +1269,61 @@ static const char *getMimeType (const char *path) {
    return "application/octet-stream";
 }
 
-/*! serve static file */
-static void serveStaticFile (int client_socket, const char *requested_path) {
+/*! text of HTTP status code */
+static const char *httpStatusText (int status) {
+   switch (status) {
+   case 200: return "OK";
+   case 400: return "Bad Request";
+   case 404: return "Not Found";
+   case 413: return "Payload Too Large";
+   case 431: return "Request Header Fields Too Large";
+   case 501: return "Not Implemented";
+   default:  return "Internal Server Error";
+   }
+}
+
+/*! new response with HTTP header for body of len bytes, body to be appended */
+static GString *httpHeader (int status, const char *mimeType, size_t len, bool keepAlive, bool cors) {
+   GString *response = g_string_sized_new (len + 256);
+   g_string_append_printf (response, "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", status, httpStatusText (status), mimeType);
+   if (cors)
+      g_string_append (response, "Access-Control-Allow-Origin: *\r\n"
+              "Access-Control-Allow-Methods: POST, GET, OPTIONS\r\n"
+              "Access-Control-Allow-Headers: Content-Type\r\n");
+   g_string_append_printf (response, "Connection: %s\r\nContent-Length: %zu\r\n\r\n", 
+      keepAlive ? "keep-alive" : "close", len);
+   return response;
+}
+
+/*! complete response with status as body */
+static GString *httpError (int status, bool keepAlive) {
+   char body [MAX_SIZE_NAME];
+   snprintf (body, sizeof (body), "%d %s", status, httpStatusText (status));
+   GString *response = httpHeader (status, "text/plain", strlen (body), keepAlive, false);
+   g_string_append (response, body);
+   return response;
+}
+
+/*! response with static file */
+static GString *serveStaticFile (const char *requested_path, bool keepAlive) {
    char filepath [512];
    snprintf (filepath, sizeof(filepath), "%s%s", par.web, requested_path);
    printf ("File Path: %s\n", filepath);
 
    // Check if file exist
    struct stat st;
-   if (stat (filepath, &st) == -1 || S_ISDIR(st.st_mode)) {
-      const char *not_found = "HTTP/1.1 404 Not Found\r\nContent-Length: 13\r\n\r\n404 Not Found";
-      send (client_socket, not_found, strlen(not_found), 0);
-      return;
-   }
-
-   // File open
-   int file = open (filepath, O_RDONLY);
-   if (file == -1) {
-      const char *error = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 21\r\n\r\n500 Internal Server Error";
-      send (client_socket, error, strlen(error), 0);
-      return;
-   }
+   if (stat (filepath, &st) == -1 || S_ISDIR(st.st_mode))
+      return httpError (404, keepAlive);
 
-   // send HTTP header and MIME type
-   char header [256];
-   snprintf (header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %ld\r\n\r\n",
-          getMimeType(filepath), st.st_size);
-   send (client_socket, header, strlen(header), 0);
+   char *content = NULL;
+   gsize length;
+   if (! g_file_get_contents (filepath, &content, &length, NULL))
+      return httpError (500, keepAlive);
 
-   // Read end send file
-   char buffer [1024];
-   ssize_t bytesRead;
-   while ((bytesRead = read(file, buffer, sizeof(buffer))) > 0) {
-      send (client_socket, buffer, bytesRead, 0);
-   }
-   close (file);
+   GString *response = httpHeader (200, getMimeType (filepath), length, keepAlive, false);
+   g_string_append_len (response, content, length);
+   g_free (content);
+   return response;
 }
 
 /*!
@@ -747,7 +1367,56 @@ GString *dumpFile (const char * fileName) {
    return res;
 }  
 
-/*! launch action and returns GString after execution */
+/*! routing context for one request, built from globals then bound by checkParamAndBind
+   an idle context and its buffers are recycled if any, given back by freeRequestContext */
+static RoutingContext *newRequestContext (void) {
+   RoutingContext *ctx = g_async_queue_try_pop (idleContexts);
+   if ((ctx == NULL) && ((ctx = routingContextNew ()) == NULL)) {
+      fprintf (stderr, "In newRequestContext: error in memory allocation\n");
+      exit (EXIT_FAILURE);
+   }
+   routingContextFromGlobals (ctx);
+   return ctx;
+}
+
+/*! give back context to idle ones for next request */
+static void freeRequestContext (RoutingContext *ctx) {
+   g_async_queue_push (idleContexts, ctx);
+}
+
+/*! true for long requests, served by heavyPool: routings may last minutes */
+static bool isHeavyRequest (int type) {
+   return (type == REQ_ROUTING) || (type == REQ_BEST_DEP) || (type == REQ_RACE) || (type == REQ_FLEET) || (type == REQ_INIT);
+}
+
+/*! request context bound to request parameters and files, with globals locked for reading
+   return context to be unlocked by unlockRequestContext, or NULL if parameters wrong */
+static RoutingContext *lockRequestContext (ClientRequest *clientReq, Resident *bound [], char *checkMessage, size_t maxLen) {
+   if (g_atomic_int_get (&gribSwap.state) == SWAP_READY) {
+      g_rw_lock_writer_lock (&dataLock);        // waits for routings under way and short requests
+      gribSwapApply ();
+      g_rw_lock_writer_unlock (&dataLock);
+   }
+   g_rw_lock_reader_lock (&dataLock);
+   RoutingContext *ctx = newRequestContext ();
+   if (! checkParamAndBind (clientReq, ctx, bound, checkMessage, maxLen)) {
+      residentsRelease (bound);
+      g_rw_lock_reader_unlock (&dataLock);
+      freeRequestContext (ctx);
+      return NULL;
+   }
+   return ctx;
+}
+
+/*! release context, files bound by lockRequestContext and globals */
+static void unlockRequestContext (RoutingContext *ctx, Resident *bound []) {
+   residentsRelease (bound);
+   g_rw_lock_reader_unlock (&dataLock);
+   freeRequestContext (ctx);
+}
+
+/*! launch action and returns GString after execution
+   globals are read locked by caller except for heavy requests that lock them here */
 static GString *launchAction (int serverPort, ClientRequest *clientReq, const char *date, const char *clientIPAddress) {
    char tempFileName [MAX_SIZE_FILE_NAME];
    GString *res = g_string_new ("");
@@ -755,9 +1424,13 @@ static GString *launchAction (int serverPort, ClientRequest *clientReq, const ch
    char checkMessage [MAX_SIZE_TEXT];
    char sailPolFileName [MAX_SIZE_NAME] = "";
    char body [2048] = "";
+   char key [RESULT_KEY_SIZE];
+   Resident *bound [N_BOUND] = {NULL};
+   RoutingContext *ctx;
    // printf ("client.req = %d\n", clientReq->type);
    switch (clientReq->type) {
    case REQ_KILL:
+      g_atomic_int_set (&serverStop, true);
       printf ("Killed on port: %d, At: %s, By: %s\n", serverPort, date, clientIPAddress);
       g_string_append_printf (res, "{\n   \"killed_on_port\": %d, \"date\": %s, \"by\": %s\"\n}\n", serverPort, date, clientIPAddress);
       break;
@@ -767,43 +1440,82 @@ static GString *launchAction (int serverPort, ClientRequest *clientReq, const ch
       g_string_append_printf (res, "   \"Compilation-date\": \"%s\",\n", __DATE__);
       g_string_append_printf (res, "   \"GLIB-version\": \"%d.%d.%d\",\n   \"ECCODES-version\": \"%s\",\n   \"CURL-version\": \"%s\",\n",
             GLIB_MAJOR_VERSION, GLIB_MINOR_VERSION, GLIB_MICRO_VERSION, ECCODES_VERSION_STR, LIBCURL_VERSION);
+      g_string_append_printf (res, "   \"ECCODES-thread-safe\": %s,\n", gribThreadSafe () ? "true" : "false");
       g_string_append_printf (res, "   \"PID\": %d,\n", getpid ());
+      resultCacheToJson (res);
+      residentsToJson (res);
+      gribSwapToJson (res);
       g_string_append_printf (res, "   \"Memory usage in KB\": %d\n}\n", memoryUsage ());
       break;
    case REQ_ROUTING:
-      if (checkParamAndUpdate (clientReq, checkMessage, sizeof (checkMessage))) {
-         competitors.runIndex = 0;
-         routingLaunch ();
-         GString *jsonRoute = routeToJson (&route, 0, clientReq->isoc, clientReq->isoDesc); // only most recent route with isochrones 
-         g_string_append_printf (res, "{\n%s}\n", jsonRoute->str);
-         g_string_free (jsonRoute, TRUE);
+      if ((ctx = lockRequestContext (clientReq, bound, checkMessage, sizeof (checkMessage))) != NULL) {
+         ctx->competitors.runIndex = 0;
+         if (! resultCacheGet (resultCacheKey (clientReq->type, clientReq, ctx, bound, key), res)) {
+            routingRun (ctx);
+            GString *jsonRoute = routeToJson (ctx, &ctx->route, 0, clientReq->isoc, clientReq->isoDesc); // only most recent route with isochrones 
+            g_string_append_printf (res, "{\n%s}\n", jsonRoute->str);
+            g_string_free (jsonRoute, TRUE);
+            resultCachePut (key, res);
+         }
+         unlockRequestContext (ctx, bound);
       }
       else {
          g_string_append_printf (res,"{\"_Error\":\n%s\n}\n", checkMessage);
       }
       break;
    case REQ_BEST_DEP:
-      if (checkParamAndUpdate (clientReq, checkMessage, sizeof (checkMessage))) {
-         competitors.runIndex = 0;
-         printf ("Launch bestTimeDesparture\n");
-         printf ("begin: %d, end: %d\n", chooseDeparture.tBegin, chooseDeparture.tEnd);
-         bestTimeDeparture ();
-         GString *bestTimeReport = bestTimeReportToJson (&chooseDeparture, clientReq->isoc, clientReq->isoDesc);
-         g_string_append_printf (res, "%s", bestTimeReport->str);
-         g_string_free (bestTimeReport, TRUE);
+      if ((ctx = lockRequestContext (clientReq, bound, checkMessage, sizeof (checkMessage))) != NULL) {
+         ctx->competitors.runIndex = 0;
+         if (! resultCacheGet (resultCacheKey (clientReq->type, clientReq, ctx, bound, key), res)) {
+            printf ("Launch bestTimeDesparture\n");
+            printf ("begin: %d, end: %d\n", ctx->chooseDeparture.tBegin, ctx->chooseDeparture.tEnd);
+            bestTimeDepartureRun (ctx);
+            GString *bestTimeReport = bestTimeReportToJson (ctx, clientReq->isoc, clientReq->isoDesc);
+            g_string_append_printf (res, "%s", bestTimeReport->str);
+            g_string_free (bestTimeReport, TRUE);
+            resultCachePut (key, res);
+         }
+         unlockRequestContext (ctx, bound);
       }
       else {
          g_string_append_printf (res,"{\"_Error\":\n%s\n}\n", checkMessage);
       }
       break;
    case REQ_RACE:
-      historyRoute.n = 0;
-      if (checkParamAndUpdate (clientReq, checkMessage, sizeof (checkMessage))) {
-         printf ("Launch AllCompetitors\n");
-         allCompetitors ();
-         GString *jsonRoutes = allCompetitorsToJson (competitors.n, clientReq->isoc, clientReq->isoDesc);
-         g_string_append_printf (res, "%s", jsonRoutes->str);
-         g_string_free (jsonRoutes, TRUE);
+      if ((ctx = lockRequestContext (clientReq, bound, checkMessage, sizeof (checkMessage))) != NULL) {
+         if (! resultCacheGet (resultCacheKey (clientReq->type, clientReq, ctx, bound, key), res)) {
+            printf ("Launch AllCompetitors\n");
+            allCompetitorsRun (ctx);
+            GString *jsonRoutes = allCompetitorsToJson (ctx, ctx->competitors.n, clientReq->isoc, clientReq->isoDesc);
+            g_string_append_printf (res, "%s", jsonRoutes->str);
+            g_string_free (jsonRoutes, TRUE);
+            resultCachePut (key, res);
+         }
+         unlockRequestContext (ctx, bound);
+      }
+      else {
+         g_string_append_printf (res,"{\"_Error\":\n%s\n}\n", checkMessage);
+      }
+      break;
+   case REQ_FLEET:   // ranked ETA table of boats, no route
+      if ((ctx = lockRequestContext (clientReq, bound, checkMessage, sizeof (checkMessage))) != NULL) {
+         if (! resultCacheGet (resultCacheKey (clientReq->type, clientReq, ctx, bound, key), res)) {
+            FleetList fleet = {0};
+            bool ok = true;
+            for (int i = 0; ok && (i < ctx->competitors.n); i += 1)
+               ok = fleetAdd (&fleet, ctx->competitors.t [i].name, ctx->competitors.t [i].lat, ctx->competitors.t [i].lon);
+            if (ok) {
+               printf ("Launch fleetRun\n");
+               fleetRun (ctx, &fleet);
+               GString *jsonFleet = fleetToJson (ctx, &fleet);
+               g_string_append_printf (res, "%s", jsonFleet->str);
+               g_string_free (jsonFleet, TRUE);
+               resultCachePut (key, res);
+            }
+            else g_string_append_printf (res, "{\"_Error\": \"Memory allocation\"}\n");
+            fleetFree (&fleet);
+         }
+         unlockRequestContext (ctx, bound);
       }
       else {
          g_string_append_printf (res,"{\"_Error\":\n%s\n}\n", checkMessage);
@@ -844,17 +1556,21 @@ static GString *launchAction (int serverPort, ClientRequest *clientReq, const ch
       res = listDirToJson (par.workingDir, clientReq->dirName, clientReq->sortByName, filter);
       break;
    case REQ_PAR_RAW:
+      g_mutex_lock (&tempFileMutex);
       writeParam (buildRootName (TEMP_FILE_NAME, tempFileName, sizeof (tempFileName)), true, false);
       res = dumpFile (TEMP_FILE_NAME);
+      g_mutex_unlock (&tempFileMutex);
       break;
    case REQ_PAR_JSON:
       res = paramToJson (&par);
       break;
    case REQ_INIT:
-      if (! initContext (parameterFileName, PATTERN))
+      g_rw_lock_writer_lock (&dataLock);
+      if (! initContext (parameterFileName, PATTERN, true))
          g_string_append_printf (res, "{\"_Error\": \"%s\"}\n", "Init Routing failed");
       else
-         g_string_append_printf (res, "{\"_Message\": \"%s\"}\n", "Init done");
+         g_string_append_printf (res, "{\"_Message\": \"%s\"}\n", "Init done, grib loading in background");
+      g_rw_lock_writer_unlock (&dataLock);
       break;
    case REQ_FEEDBACK:
          snprintf (body, sizeof (body), "%s; %s\n%s\n", date, clientIPAddress, clientReq->feedback);
@@ -872,33 +1588,55 @@ static GString *launchAction (int serverPort, ClientRequest *clientReq, const ch
    return res;
 }
 
-/*! Handle client connection and launch actions */
-static void handleClient (int serverPort, int clientFd, struct sockaddr_in *client_addr) {
-   char saveBuffer [MAX_SIZE_REQUEST];
-   char buffer [MAX_SIZE_REQUEST] = "";
-   char clientIPAddress [MAX_SIZE_LINE];
+/*! give response in conn->out to event loop. conn must not be used after by caller */
+static void connectionRespond (Connection *conn) {
+   conn->outSent = 0;
+   struct epoll_event ev = {.events = EPOLLOUT | EPOLLONESHOT, .data.ptr = conn};
+   if (epoll_ctl (epollFd, EPOLL_CTL_MOD, conn->fd, &ev) < 0)
+      perror ("In connectionRespond: Error epoll_ctl");
+}
 
-   // read HTTP request
-   int bytes_read = recv (clientFd, buffer, sizeof(buffer) - 1, 0);
-   if (bytes_read <= 0) {
-     return;
-   }
-   buffer [bytes_read] = '\0'; // terminate string
-   //printf ("Client Request: %s\n", buffer);
-   g_strlcpy (saveBuffer, buffer, MAX_SIZE_BUFFER);
+/*! launch action, log and give response to event loop. Run by lightPool or heavyPool thread */
+static void serveRequest (gpointer data, gpointer userData) {
+   (void) userData;
+   Connection *conn = data;
+   char date [MAX_SIZE_NAME];
+   gint64 start = g_get_monotonic_time (); 
+   getCurrentDate (date, sizeof (date));
 
-   if (! getRealIPAddress (buffer, clientIPAddress, sizeof (clientIPAddress))) { // try if proxy 
-      // Get client IP address if IP address not found with proxy
-      char remoteAddr [INET_ADDRSTRLEN];
-      inet_ntop (AF_INET, &(client_addr->sin_addr), remoteAddr, INET_ADDRSTRLEN); // not used
-      g_strlcpy (clientIPAddress, remoteAddr, INET_ADDRSTRLEN);
+   GString *res;
+   if (isHeavyRequest (conn->clientReq.type))
+      res = launchAction (conn->serverPort, &conn->clientReq, date, conn->clientIPAddress);
+   else {
+      g_rw_lock_reader_lock (&dataLock);
+      res = launchAction (conn->serverPort, &conn->clientReq, date, conn->clientIPAddress);
+      g_rw_lock_reader_unlock (&dataLock);
    }
+   conn->out = httpHeader (200, "application/json", res->len, conn->keepAlive, true);
+   g_string_append_len (conn->out, res->str, res->len);
+   g_string_free (res, TRUE);
+   //printf ("response on port %d: %s\n", serverPort, conn->out->str);
+   double duration = (g_get_monotonic_time () - start) / 1e6; 
+   logRequest (par.logFileName, date, conn->serverPort, conn->clientIPAddress, conn->postData, conn->userAgent, &conn->clientReq, duration);
+   fflush (stdout);
+   fflush (stderr);
+   connectionRespond (conn);
+}
+
+/*! Handle complete request of connection, run by lightPool thread. Serve static files and short requests,
+   pass routings and REQ_INIT to heavyPool so that they do not block other clients */
+static void handleRequest (gpointer data, gpointer userData) {
+   (void) userData;
+   Connection *conn = data;
+   char proxyIPAddress [MAX_SIZE_LINE];
+
+   if (getRealIPAddress (conn->request, proxyIPAddress, sizeof (proxyIPAddress))) // try if proxy 
+      g_strlcpy (conn->clientIPAddress, proxyIPAddress, sizeof (conn->clientIPAddress));
+   else
+      g_strlcpy (conn->clientIPAddress, conn->peerIPAddress, sizeof (conn->clientIPAddress));
 
    // Extract HTTP first line request
-   char *requestLine = strtok (buffer, "\r\n");
-   if (!requestLine) {
-     return;
-   }
+   char *requestLine = g_strndup (conn->request, strcspn (conn->request, "\r\n"));
    printf ("Request line: %s\n", requestLine);
 
    // check if Rest API (POST) or static file (GET)
@@ -907,73 +1645,295 @@ static void handleClient (int serverPort, int clientFd, struct sockaddr_in *clie
       // static file
       const char *requested_path = strchr (requestLine, ' '); // space after "GET"
       if (!requested_path) {
-        return;
+         conn->out = httpError (400, conn->keepAlive);
       }
-      requested_path++; // Pass space
+      else {
+         requested_path++; // Pass space
 
-      char *end_path = strchr (requested_path, ' ');
-        if (end_path) {
-      *end_path = '\0'; // Terminate string
-      }
+         char *end_path = strchr (requested_path, ' ');
+         if (end_path) {
+            *end_path = '\0'; // Terminate string
+         }
 
-      if (strcmp(requested_path, "/") == 0) {
-         requested_path = "/index.html"; // Default page
+         if (strcmp(requested_path, "/") == 0) {
+            requested_path = "/index.html"; // Default page
+         }
+         g_rw_lock_reader_lock (&dataLock);      // par.web
+         conn->out = serveStaticFile (requested_path, conn->keepAlive);
+         g_rw_lock_reader_unlock (&dataLock);
       }
-
-      serveStaticFile (clientFd, requested_path);
+      g_free (requestLine);
+      connectionRespond (conn);
       return; // stop
    }
+   g_free (requestLine);
 
-   // Extract request body
-   char *postData = strstr (saveBuffer, "\r\n\r\n");
-   if (postData == NULL) {
+   g_free (conn->userAgent);
+   conn->userAgent = extractUserAgent (conn->request);
+   printf ("POST Request:\n%s\n", conn->postData);
+
+   if (! decodeHttpReq (conn->postData, &conn->clientReq)) {
+      fprintf (stderr, "In handleRequest, Error: Bad Request\n");
+      conn->out = httpError (400, conn->keepAlive);
+      connectionRespond (conn);
       return;
    }
+   if (isHeavyRequest (conn->clientReq.type))
+      g_thread_pool_push (heavyPool, conn, NULL);
+   else
+      serveRequest (conn, NULL);
+}
+
+/*! value of header field name in header of len bytes. Return false if not found */
+static bool headerValue (const char *header, size_t len, const char *name, char *value, size_t maxLen) {
+   const size_t nameLen = strlen (name);
+   const char *end = header + len;
+   for (const char *line = header; line < end; ) {
+      const char *eol = g_strstr_len (line, end - line, "\r\n");
+      if (eol == NULL)
+         eol = end;
+      if (((size_t) (eol - line) > nameLen) && (line [nameLen] == ':') && (g_ascii_strncasecmp (line, name, nameLen) == 0)) {
+         const char *v = line + nameLen + 1;
+         while ((v < eol) && (*v == ' ' || *v == '\t')) v++;
+         g_strlcpy (value, v, MIN (maxLen, (size_t) (eol - v) + 1));
+         return true;
+      }
+      line = eol + 2;
+   }
+   return false;
+}
 
-   char* userAgent = extractUserAgent (saveBuffer);
+/*! move first complete request received in conn->request. Framing by Content-Length only,
+   Transfer-Encoding (chunked) rejected. Answer "Expect: 100-continue" once while body missing
+   Return 0 if incomplete, 200 if complete, or HTTP error status if malformed, too big or not supported */
+static int extractRequest (Connection *conn) {
+   const char *endHeader = g_strstr_len (conn->in->str, conn->in->len, "\r\n\r\n");
+   if (endHeader == NULL)
+      return (conn->in->len > MAX_SIZE_HEADER) ? 431 : 0;
+   const size_t headerLen = endHeader + 4 - conn->in->str;
+   if (headerLen > MAX_SIZE_HEADER)
+      return 431;
+   char value [MAX_SIZE_LINE];
+   size_t bodyLen = 0;
+   if (headerValue (conn->in->str, headerLen, "Transfer-Encoding", value, sizeof (value)))
+      return 501;
+   if (headerValue (conn->in->str, headerLen, "Content-Length", value, sizeof (value))) {
+      char *end;
+      guint64 v = g_ascii_strtoull (value, &end, 10);
+      if (end == value)
+         return 400;
+      if (v > MAX_SIZE_BODY)
+         return 413;
+      bodyLen = v;
+   }
+   if (conn->in->len < headerLen + bodyLen) {
+      if (! conn->continueSent && headerValue (conn->in->str, headerLen, "Expect", value, sizeof (value))
+         && (g_ascii_strcasecmp (value, "100-continue") == 0)) {
+         const char *interim = "HTTP/1.1 100 Continue\r\n\r\n";
+         (void) send (conn->fd, interim, strlen (interim), MSG_NOSIGNAL); // tiny, socket buffer empty
+         conn->continueSent = true;
+      }
+      return 0;
+   }
+   conn->continueSent = false;
 
-   postData += 4; // Ignore HTTP request separators
-   printf ("POST Request:\n%s\n", postData);
-   bool ok = decodeHttpReq (postData, &clientReq);
-   
-   // data for log
-   gint64 start = g_get_monotonic_time (); 
-   const char *date = getCurrentDate ();
+   // keep alive is default with HTTP/1.1, not with HTTP/1.0
+   const char *eol = strstr (conn->in->str, "\r\n");
+   bool http10 = g_strstr_len (conn->in->str, eol - conn->in->str, "HTTP/1.0") != NULL;
+   if (headerValue (conn->in->str, headerLen, "Connection", value, sizeof (value)))
+      conn->keepAlive = http10 ? (g_ascii_strcasecmp (value, "keep-alive") == 0) : (g_ascii_strcasecmp (value, "close") != 0);
+   else
+      conn->keepAlive = ! http10;
 
-   if (! ok) {
-      const char *errorResponse = "HTTP/1.1 400 Bad Request\r\nContent-Type: text/plain\r\n\r\nError";
-      fprintf (stderr, "In handleClient, Error: %s\n", errorResponse);
-      send (clientFd, errorResponse, strlen(errorResponse), 0);
-      return;
+   g_free (conn->request);
+   conn->request = g_strndup (conn->in->str, headerLen + bodyLen);
+   conn->postData = conn->request + headerLen;
+   g_string_erase (conn->in, 0, headerLen + bodyLen);
+   return 200;
+}
+
+/*! free connection and close client socket, also removed from epoll */
+static void connectionFree (Connection *conn) {
+   close (conn->fd);
+   g_string_free (conn->in, TRUE);
+   if (conn->out != NULL)
+      g_string_free (conn->out, TRUE);
+   g_free (conn->request);
+   g_free (conn->userAgent);
+   g_free (conn);
+}
+
+/*! pass next request to lightPool if completely received, else wait for more bytes. eof if client closed
+   Return false if connection to be closed */
+static bool dispatchRequest (Connection *conn, bool eof, int *nBusy) {
+   if (g_atomic_int_get (&serverStop))
+      return false;
+   int status = extractRequest (conn);
+   if (status == 0) {
+      if (eof)
+         return false;
+      struct epoll_event ev = {.events = EPOLLIN | EPOLLONESHOT, .data.ptr = conn};
+      return epoll_ctl (epollFd, EPOLL_CTL_MOD, conn->fd, &ev) == 0;
+   }
+   if (status != 200) {                      // answered by event loop, then closed
+      fprintf (stderr, "In dispatchRequest, Error: %d %s\n", status, httpStatusText (status));
+      conn->keepAlive = false;
+      conn->out = httpError (status, false);
+      connectionRespond (conn);
+      return true;
+   }
+   if (eof)
+      conn->keepAlive = false;
+   conn->busy = true;
+   *nBusy += 1;
+   g_thread_pool_push (lightPool, conn, NULL);
+   return true;
+}
+
+/*! read bytes available without blocking. Return 1 if connection open, 0 if closed by client, -1 if error */
+static int readConnection (Connection *conn) {
+   char buffer [4096];
+   while (conn->in->len <= MAX_SIZE_HEADER + MAX_SIZE_BODY) {
+      ssize_t n = recv (conn->fd, buffer, sizeof (buffer), 0);
+      if (n > 0)
+         g_string_append_len (conn->in, buffer, n);
+      else if (n == 0)
+         return 0;
+      else if (errno == EINTR)
+         continue;
+      else
+         return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 1 : -1;
+   }
+   return 1;                                 // too big, rejected by extractRequest
+}
+
+/*! send as much of response as socket accepts, then wait for next request if kept alive
+   Return false if connection to be closed */
+static bool sendResponse (Connection *conn, int *nBusy) {
+   while (conn->outSent < conn->out->len) {
+      ssize_t n = send (conn->fd, conn->out->str + conn->outSent, conn->out->len - conn->outSent, MSG_NOSIGNAL);
+      if (n >= 0)
+         conn->outSent += n;
+      else if (errno == EINTR)
+         continue;
+      else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+         struct epoll_event ev = {.events = EPOLLOUT | EPOLLONESHOT, .data.ptr = conn};
+         return epoll_ctl (epollFd, EPOLL_CTL_MOD, conn->fd, &ev) == 0;
+      }
+      else
+         return false;
+   }
+   g_string_free (conn->out, TRUE);
+   conn->out = NULL;
+   return conn->keepAlive && dispatchRequest (conn, false, nBusy); // next request may be already received
+}
+
+/*! accept all pending connections, non blocking, watched by epoll */
+static void acceptConnections (int serverFd, int serverPort, GHashTable *connections) {
+   struct sockaddr_in address;
+   socklen_t addrlen;
+   int clientFd;
+   for (;;) {
+      addrlen = sizeof (address);
+      if ((clientFd = accept (serverFd, (struct sockaddr *)&address, &addrlen)) < 0) {
+         if ((errno == EINTR) || (errno == ECONNABORTED))
+            continue;
+         if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            perror ("In acceptConnections: Error accept");
+         return;
+      }
+      fcntl (clientFd, F_SETFL, fcntl (clientFd, F_GETFL, 0) | O_NONBLOCK);
+      Connection *conn = g_new0 (Connection, 1);
+      conn->fd = clientFd;
+      conn->serverPort = serverPort;
+      conn->in = g_string_sized_new (1024);
+      conn->lastActive = g_get_monotonic_time ();
+      inet_ntop (AF_INET, &address.sin_addr, conn->peerIPAddress, sizeof (conn->peerIPAddress));
+      struct epoll_event ev = {.events = EPOLLIN | EPOLLONESHOT, .data.ptr = conn};
+      if (epoll_ctl (epollFd, EPOLL_CTL_ADD, clientFd, &ev) < 0) {
+         perror ("In acceptConnections: Error epoll_ctl");
+         connectionFree (conn);
+         continue;
+      }
+      g_hash_table_add (connections, conn);
    }
-   GString *res = launchAction (serverPort, &clientReq, date, clientIPAddress);
-   const char *cors_headers = "Access-Control-Allow-Origin: *\r\n"
-              "Access-Control-Allow-Methods: POST, GET, OPTIONS\r\n"
-              "Access-Control-Allow-Headers: Content-Type\r\n";
-   GString *response = g_string_new ("");
-
-   g_string_append_printf (response,
-      "HTTP/1.1 200 OK\r\n"
-      "Content-Type: application/json\r\n"
-      "%s"
-      "Content-Length: %zu\r\n"
-      "\r\n"
-      "%s",
-      cors_headers, strlen(res->str), res->str);
-   g_string_free (res, TRUE);
-   //printf ("response on port %d: %s\n", serverPort, response->str);
-   send (clientFd, response->str, strlen(response->str), 0);
-   printf ("Response sent to client\n\n");
-   g_string_free (response, TRUE);
-   double duration = (g_get_monotonic_time () - start) / 1e6; 
-   logRequest (par.logFileName, date, serverPort, clientIPAddress, postData, userAgent, &clientReq, duration);
-   if (userAgent) g_free (userAgent);
+}
+
+/*! close connections idle or slow for more than KEEP_ALIVE_TIMEOUT, except those with request in pool */
+static void closeIdleConnections (GHashTable *connections, gint64 now) {
+   GHashTableIter iter;
+   gpointer key;
+   g_hash_table_iter_init (&iter, connections);
+   while (g_hash_table_iter_next (&iter, &key, NULL)) {
+      Connection *conn = key;
+      if (! conn->busy && (now - conn->lastActive > KEEP_ALIVE_TIMEOUT * G_USEC_PER_SEC)) {
+         g_hash_table_iter_remove (&iter);
+         connectionFree (conn);
+      }
+   }
+}
+
+/*! event loop: accept connections, read requests and send responses without blocking on any client
+   return when stopped by REQ_KILL once pending requests are answered */
+static void eventLoop (int serverFd, int serverPort) {
+   struct epoll_event events [MAX_N_EVENTS];
+   GHashTable *connections = g_hash_table_new (NULL, NULL);   // all open connections
+   gint64 lastScan = g_get_monotonic_time ();
+   bool listening = true;
+   int nBusy = 0;                                             // connections with request in pool
+
+   while (! g_atomic_int_get (&serverStop) || (nBusy > 0)) {
+      if (listening && g_atomic_int_get (&serverStop)) {
+         epoll_ctl (epollFd, EPOLL_CTL_DEL, serverFd, NULL);
+         listening = false;
+      }
+      int n = epoll_wait (epollFd, events, MAX_N_EVENTS, 1000);
+      if (n < 0) {
+         if (errno == EINTR)
+            continue;
+         perror ("In eventLoop: Error epoll_wait");
+         break;
+      }
+      gint64 now = g_get_monotonic_time ();
+      for (int i = 0; i < n; i += 1) {
+         Connection *conn = events [i].data.ptr;
+         if (conn == NULL) {
+            acceptConnections (serverFd, serverPort, connections);
+            continue;
+         }
+         conn->lastActive = now;
+         if (conn->busy) {                                    // response given back by pool
+            conn->busy = false;
+            nBusy -= 1;
+         }
+         bool open;
+         if (conn->out != NULL)
+            open = sendResponse (conn, &nBusy);
+         else {
+            int ret = readConnection (conn);
+            open = (ret >= 0) && dispatchRequest (conn, ret == 0, &nBusy);
+         }
+         if (! open) {
+            g_hash_table_remove (connections, conn);
+            connectionFree (conn);
+         }
+      }
+      if (now - lastScan > G_USEC_PER_SEC) {
+         closeIdleConnections (connections, now);
+         lastScan = now;
+      }
+   }
+   GHashTableIter iter;
+   gpointer key;
+   g_hash_table_iter_init (&iter, connections);
+   while (g_hash_table_iter_next (&iter, &key, NULL))
+      connectionFree (key);
+   g_hash_table_destroy (connections);
 }
 
 int main (int argc, char *argv[]) {
-   int serverFd, clientFd;
+   int serverFd;
    struct sockaddr_in address;
-   int addrlen = sizeof (address);
    int serverPort, opt = 1;
    gint64 start = g_get_monotonic_time (); 
 
@@ -997,9 +1957,11 @@ int main (int argc, char *argv[]) {
    else 
       g_strlcpy (parameterFileName, PARAMETERS_FILE, sizeof (parameterFileName));
 
-   if (! initContext (parameterFileName, ""))
+   if (! initContext (parameterFileName, "", false))
       return EXIT_FAILURE;
 
+   curl_global_init (CURL_GLOBAL_DEFAULT);           // not thread safe, done before pools
+
    // Socket 
    serverFd = socket (AF_INET, SOCK_STREAM, 0);
    if (serverFd < 0) {
@@ -1027,33 +1989,58 @@ int main (int argc, char *argv[]) {
    }
 
    // Listen connexions
-   if (listen (serverFd, 3) < 0) {
+   if (listen (serverFd, SOMAXCONN) < 0) {
       perror ("In main: error listening");
       close (serverFd);
       return EXIT_FAILURE;
    }
+
+   // event loop, listening socket has no connection (NULL)
+   fcntl (serverFd, F_SETFL, fcntl (serverFd, F_GETFL, 0) | O_NONBLOCK);
+   struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+   if (((epollFd = epoll_create1 (0)) < 0) || (epoll_ctl (epollFd, EPOLL_CTL_ADD, serverFd, &ev) < 0)) {
+      perror ("In main: error epoll");
+      close (serverFd);
+      return EXIT_FAILURE;
+   }
    double elapsed = (g_get_monotonic_time () - start) / 1e6; 
    printf ("✅ Loaded in...: %.2lf seconds. Server listen on port: %d, Pid: %d\n", elapsed, serverPort, getpid ());
 
-   while (clientReq.type != REQ_KILL) {
-      if ((clientFd = accept (serverFd, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0) {
-         perror ("In main: Error accept");
-         close (serverFd);
-         exit (EXIT_FAILURE);
-      }
-      handleClient (serverPort, clientFd, &address);
-      fflush (stdout);
-      fflush (stderr);
-      close (clientFd);
+   GError *error = NULL;
+   idleContexts = g_async_queue_new ();
+   lightPool = g_thread_pool_new (handleRequest, NULL, par.serverWorkers, FALSE, &error);
+   if (lightPool != NULL)
+      heavyPool = g_thread_pool_new (serveRequest, NULL, par.routingWorkers, FALSE, &error);
+   if (heavyPool == NULL) {
+      fprintf (stderr, "In main: Error creating thread pools: %s\n", error->message);
+      g_clear_error (&error);
+      close (serverFd);
+      return EXIT_FAILURE;
    }
+   printf ("Server workers: %d, routing workers: %d\n", par.serverWorkers, par.routingWorkers);
+   printf ("ECCODES thread safe: %s\n", gribThreadSafe () ? "yes" : "no, grib decoding is serial");
+
+   eventLoop (serverFd, serverPort);
+
+   g_thread_pool_free (lightPool, FALSE, TRUE);
+   g_thread_pool_free (heavyPool, FALSE, TRUE);
+   close (epollFd);
    close (serverFd);
-   free (tIsSea);
+   isSeaFree ();
    free (isoDesc);
    free (isocArray);
    free (route.t);
    freeHistoryRoute ();
-   free (tGribData [WIND]); 
-   free (tGribData [CURRENT]); 
+   RoutingContext *ctx;
+   while ((ctx = g_async_queue_try_pop (idleContexts)) != NULL)
+      routingContextFree (ctx);
+   g_async_queue_unref (idleContexts);
+   if (resultCache.table != NULL)
+      g_hash_table_destroy (resultCache.table);
+   gribSwapJoin ();
+   residentsRetireAll ();
+   if (residents.table != NULL)
+      g_hash_table_destroy (residents.table);
    curl_global_cleanup();
    return EXIT_SUCCESS;
 }
@@ -1,5 +1,9 @@
 /*! compilation: gcc -c rutil.c `pkg-config --cflags glib-.0` */
+#define _POSIX_C_SOURCE 200809L // for mkstemp and fdopen with -std=c11
 #define MAX_N_SHIP_TYPE 2       // for Virtual Regatta Stamina calculation
+#define IS_SEA_CACHE_MAGIC    "R3ISSEA"   // 8 bytes with final \0
+#define IS_SEA_CACHE_VERSION  2           // increment when format of cache change
+#define IS_SEA_CACHE_SUFFIX   ".r3s"      // cache file is issea file name + suffix
 
 #include <glib.h>
 #include <float.h>   
@@ -9,6 +13,9 @@
 #include <string.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <dirent.h>
 #include <unistd.h>
 #include <time.h>
@@ -60,6 +67,21 @@ Par par;
 /*! table describing if sea or earth */
 char *tIsSea = NULL; 
 
+static void   *isSeaMap = NULL;      // not NULL when tIsSea is mapped from cache file
+static size_t isSeaMapLen = 0;
+
+/*! header of bit-packed cache file of issea file. Followed by SIZE_T_IS_SEA_BYTES bytes */
+typedef struct {
+   char     magic [8];
+   uint32_t version;
+   uint32_t nCells;           // SIZE_T_IS_SEA
+   int64_t  srcSize;          // size of source issea file
+   int64_t  srcMtime;         // modification time of source issea file
+   int64_t  srcMtimeNsec;     // nanoseconds of modification time
+   int64_t  srcIno;           // inode of source issea file
+   int64_t  nSea;             // number of sea cells
+} IsSeaCacheHeader;
+
 /*! geographic zone covered by grib file */
 Zone zone;                             // wind
 Zone currentZone;                      // current
@@ -323,29 +345,142 @@ char *durationToStr (double duration, char *res, size_t maxLen) {
    return res;
 } 
 
-/*! read issea file and fill table tIsSea */
+/*! free tIsSea, either allocated or mapped from cache file */
+void isSeaFree (void) {
+   if (isSeaMap != NULL) {
+      munmap (isSeaMap, isSeaMapLen);
+      isSeaMap = NULL;
+      isSeaMapLen = 0;
+   }
+   else free (tIsSea);
+   tIsSea = NULL;
+}
+
+/*! fill header with version and identification of source issea file
+   return false if source file cannot be stat */
+static bool isSeaCacheHeader (const char *fileName, int64_t nSea, IsSeaCacheHeader *header) {
+   struct stat st;
+   if (stat (fileName, &st) != 0)
+      return false;
+   memset (header, 0, sizeof (IsSeaCacheHeader));
+   memcpy (header->magic, IS_SEA_CACHE_MAGIC, sizeof (header->magic));
+   header->version = IS_SEA_CACHE_VERSION;
+   header->nCells = SIZE_T_IS_SEA;
+   header->srcSize = st.st_size;
+   header->srcMtime = st.st_mtim.tv_sec;
+   header->srcMtimeNsec = st.st_mtim.tv_nsec;
+   header->srcIno = st.st_ino;
+   header->nSea = nSea;
+   return true;
+}
+
+/*! map bit-packed cache file of fileName in tIsSea
+   copy on write so that updateIsSeaWithForbiddenAreas only duplicates the pages it changes
+   return false if no cache or cache invalid (other version, source file changed) */
+static bool readIsSeaCache (const char *fileName) {
+   char cacheName [MAX_SIZE_FILE_NAME + sizeof (IS_SEA_CACHE_SUFFIX)];
+   IsSeaCacheHeader ref, header;
+   struct stat st;
+   int fd;
+
+   if (! isSeaCacheHeader (fileName, 0, &ref))
+      return false;
+   snprintf (cacheName, sizeof (cacheName), "%s%s", fileName, IS_SEA_CACHE_SUFFIX);
+   if ((fd = open (cacheName, O_RDONLY)) < 0)
+      return false;
+   if ((fstat (fd, &st) != 0) || (st.st_size < (off_t) sizeof (IsSeaCacheHeader)) ||
+      (read (fd, &header, sizeof (header)) != (ssize_t) sizeof (header))) {
+      close (fd);
+      return false;
+   }
+   if ((memcmp (header.magic, ref.magic, sizeof (ref.magic)) != 0) || (header.version != ref.version) ||
+      (header.nCells != ref.nCells) || (header.srcSize != ref.srcSize) || 
+      (header.srcMtime != ref.srcMtime) || (header.srcMtimeNsec != ref.srcMtimeNsec) || (header.srcIno != ref.srcIno) ||
+      ((size_t) st.st_size != sizeof (IsSeaCacheHeader) + SIZE_T_IS_SEA_BYTES)) {
+      close (fd);
+      printf ("In readIsSeaCache: %s obsolete\n", cacheName);
+      return false;
+   }
+   void *map = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+   close (fd);
+   if (map == MAP_FAILED) {
+      fprintf (stderr, "In readIsSeaCache, Error mmap: %s\n", cacheName);
+      return false;
+   }
+   isSeaFree ();
+   isSeaMap = map;
+   isSeaMapLen = st.st_size;
+   tIsSea = (char *) map + sizeof (IsSeaCacheHeader);
+   printf ("isSea file     : %s mapped, nIsea: %ld, Proportion sea: %lf\n", cacheName, (long) header.nSea, 
+      (double) header.nSea / (double) SIZE_T_IS_SEA); 
+   return true;
+}
+
+/*! write bit-packed tIsSea in cache file of fileName
+   written in unique temporary file then renamed so that a reader never see a partial cache
+   and concurrent writers do not mix their bytes */
+static bool writeIsSeaCache (const char *fileName, int64_t nSea) {
+   char cacheName [MAX_SIZE_FILE_NAME + sizeof (IS_SEA_CACHE_SUFFIX)];
+   char tmpName [MAX_SIZE_FILE_NAME + sizeof (IS_SEA_CACHE_SUFFIX) + 8];
+   IsSeaCacheHeader header;
+   FILE *f;
+   int fd = -1;
+
+   if (! isSeaCacheHeader (fileName, nSea, &header))
+      return false;
+   snprintf (cacheName, sizeof (cacheName), "%s%s", fileName, IS_SEA_CACHE_SUFFIX);
+   snprintf (tmpName, sizeof (tmpName), "%s.XXXXXX", cacheName);
+   if (((fd = mkstemp (tmpName)) < 0) || (fchmod (fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) != 0) || 
+      ((f = fdopen (fd, "wb")) == NULL)) {
+      fprintf (stderr, "In writeIsSeaCache, Error unable to open: %s\n", tmpName);
+      if (fd >= 0) {
+         close (fd);
+         remove (tmpName);
+      }
+      return false;
+   }
+   bool ok = (fwrite (&header, sizeof (header), 1, f) == 1) &&
+             (fwrite (tIsSea, 1, SIZE_T_IS_SEA_BYTES, f) == SIZE_T_IS_SEA_BYTES);
+   ok = (fclose (f) == 0) && ok;
+   if (! ok || (rename (tmpName, cacheName) != 0)) {
+      fprintf (stderr, "In writeIsSeaCache, Error writing: %s\n", cacheName);
+      remove (tmpName);
+      return false;
+   }
+   printf ("In writeIsSeaCache: %s written\n", cacheName);
+   return true;
+}
+
+/*! read issea file and fill bit-packed table tIsSea 
+   text file (one char per cell, '0' if earth) is decoded once then mapped from its cache file */
 bool readIsSea (const char *fileName) {
    FILE *f = NULL;
    int i = 0;
-   char c;
+   int c;
    int nSea = 0;
+   if (readIsSeaCache (fileName))
+      return true;
    if ((f = fopen (fileName, "r")) == NULL) {
       fprintf (stderr, "In readIsSea, Error cannot open: %s\n", fileName);
       return false;
    }
-	if ((tIsSea = (char *) malloc (SIZE_T_IS_SEA + 1)) == NULL) {
-		fprintf (stderr, "In readIsSea, error Malloc");
+   isSeaFree ();
+   if ((tIsSea = (char *) calloc (SIZE_T_IS_SEA_BYTES, 1)) == NULL) {
+      fprintf (stderr, "In readIsSea, error Malloc");
       fclose (f);
-		return false;
-	}
+      return false;
+   }
 
-   while (((c = fgetc (f)) != -1) && (i < SIZE_T_IS_SEA)) {
+   while (((c = fgetc (f)) != EOF) && (i < SIZE_T_IS_SEA)) {
       if (c == '1') nSea += 1;
-      tIsSea [i] = c - '0';
+      if (c != '0')
+         tIsSea [i >> 3] |= 1 << (i & 7);
       i += 1;
    }
    fclose (f);
    printf ("isSea file     : %s, Size: %d, nIsea: %d, Proportion sea: %lf\n", fileName, i, nSea, (double) nSea/ (double) i); 
+   if (writeIsSeaCache (fileName, nSea))
+      readIsSeaCache (fileName);
    return true;
 } 
 
@@ -447,40 +582,61 @@ bool analyseCoord (const char *strCoord, double *lat, double *lon) {
 }
 
 /*! fill str with polygon information */
-/*! return true if p is in polygon po
-  Ray casting algorithm */ 
-static bool isInPolygon (double lat, double lon, const MyPolygon *po) {
-   int i, j;
-   bool inside = false;
-   // printf ("isInPolygon lat:%.2lf lon: %.2lf\n", p.lat, p.lon);
-   for (i = 0, j = po->n - 1; i < po->n; j = i++) {
-      if ((po->points[i].lat > lat) != (po->points[j].lat > lat) &&
-         (lon < (po->points[j].lon - po->points[i].lon) * (lat - po->points[i].lat) / (po->points[j].lat - po->points[i].lat) + po->points[i].lon)) {
-         inside = !inside;
-      }
-   }
-   return inside;
+/*! compare doubles for qsort */
+static int compareDouble (const void *a, const void *b) {
+   const double x = *(const double *) a;
+   const double y = *(const double *) b;
+   return (x > y) - (x < y);
 }
 
-/*! return true if p is in forbid area */ 
-static bool isInForbidArea (double lat, double lon) {
-   for (int i = 0; i < par.nForbidZone; i++) {
-      if (isInPolygon (lat, lon, &forbidZones [i]))
-         return true;
+/*! clear in tIsSea cells whose grid node is inside polygon po. Even odd rule (ray casting).
+   Scanline restricted to the bounding box of po: for each row, longitudes where edges cross the row
+   are sorted and nodes from an even crossing included to next one excluded are inside.
+   xCross has room for po->n values */
+static void forbidPolygonBurn (const MyPolygon *po, double *xCross) {
+   double latMin = DBL_MAX, latMax = -DBL_MAX;
+   if (po->n < 3) return;
+   for (int i = 0; i < po->n; i++) {
+      latMin = MIN (latMin, po->points [i].lat);
+      latMax = MAX (latMax, po->points [i].lat);
+   }
+   const int rowMin = MAX (0, (int) floor ((90.0 - latMax) * 10.0) - 1);
+   const int rowMax = MIN (1800, (int) ceil ((90.0 - latMin) * 10.0) + 1);
+
+   for (int row = rowMin; row <= rowMax; row++) {
+      const double lat = 90.0 - row / 10.0;
+      int m = 0;
+      for (int i = 0, j = po->n - 1; i < po->n; j = i++) {
+         if ((po->points[i].lat > lat) != (po->points[j].lat > lat))
+            xCross [m++] = (po->points[j].lon - po->points[i].lon) * (lat - po->points[i].lat) / (po->points[j].lat - po->points[i].lat) + po->points[i].lon;
+      }
+      qsort (xCross, m, sizeof (double), compareDouble);
+      for (int k = 0; k + 1 < m; k += 2) {
+         int col = MAX (0, (int) floor ((xCross [k] + 180.0) * 10.0) - 1);
+         while ((col <= 3600) && (col / 10.0 - 180.0 < xCross [k])) col++;
+         for (; (col <= 3600) && (col / 10.0 - 180.0 < xCross [k + 1]); col++) {
+            const int i = row * 3601 + col;
+            tIsSea [i >> 3] &= ~(1 << (i & 7));
+         }
+      }
    }
-   return false;
 }
 
 /*! complement according to forbidden areas */
 void updateIsSeaWithForbiddenAreas (void) {
+   int nMax = 0;
    if (tIsSea == NULL) return;
    if (par.nForbidZone <= 0) return;
-   for (int i = 0; i < SIZE_T_IS_SEA; i++) {
-      double lon = (i % 3601) / 10 - 180.0;
-      double lat = 90.0 - (i / (3601 *10));
-      if (isInForbidArea (lat, lon))
-         tIsSea [i] = 0;
+   for (int i = 0; i < par.nForbidZone; i++)
+      nMax = MAX (nMax, forbidZones [i].n);
+   double *xCross = malloc (MAX (nMax, 1) * sizeof (double));
+   if (xCross == NULL) {
+      fprintf (stderr, "In updateIsSeaWithForbiddenAreas, Error Malloc: %d\n", nMax);
+      return;
    }
+   for (int i = 0; i < par.nForbidZone; i++)
+      forbidPolygonBurn (&forbidZones [i], xCross);
+   free (xCross);
 }
 
 /*! read forbid zone */
@@ -531,6 +687,13 @@ bool readParam (const char *fileName) {
    par.kFactor = 1;
    par.jFactor = 300;
    par.nSectors = MAX_N_SECTORS;
+   par.nThreads = 1;
+   par.vectorSweep = true;
+   par.segmentSea = false;
+   par.serverWorkers = 4;
+   par.routingWorkers = 2;
+   par.resultCacheMB = 64;
+   par.residentMB = 2048;
    par.style = 1;
    par.showColors =2;
    par.dispDms = 2;
@@ -690,6 +853,13 @@ bool readParam (const char *fileName) {
       else if (sscanf (pLine, "PENALTY1:%d", &par.penalty1) > 0);
       else if (sscanf (pLine, "PENALTY2:%d", &par.penalty2) > 0);
       else if (sscanf (pLine, "N_SECTORS:%d", &par.nSectors) > 0);
+      else if (sscanf (pLine, "N_THREADS:%d", &par.nThreads) > 0);
+      else if (sscanf (pLine, "VECTOR_SWEEP:%d", &par.vectorSweep) > 0);
+      else if (sscanf (pLine, "SEGMENT_SEA:%d", &par.segmentSea) > 0);
+      else if (sscanf (pLine, "SERVER_WORKERS:%d", &par.serverWorkers) > 0);
+      else if (sscanf (pLine, "ROUTING_WORKERS:%d", &par.routingWorkers) > 0);
+      else if (sscanf (pLine, "RESULT_CACHE_MB:%d", &par.resultCacheMB) > 0);
+      else if (sscanf (pLine, "RESIDENT_MB:%d", &par.residentMB) > 0);
       else if (sscanf (pLine, "WITH_WAVES:%d", &par.withWaves) > 0);
       else if (sscanf (pLine, "WITH_CURRENT:%d", &par.withCurrent) > 0);
       else if (sscanf (pLine, "ISOC_DISP:%d", &par.style) > 0);
@@ -743,6 +913,11 @@ bool readParam (const char *fileName) {
    par.staminaVR = CLAMP (par.staminaVR, 0.0, 100.0);
    fclose (f);
    par.nSectors = MIN (par.nSectors, MAX_N_SECTORS);
+   par.nThreads = CLAMP (par.nThreads, 1, MAX_N_THREADS);
+   par.serverWorkers = CLAMP (par.serverWorkers, 1, MAX_N_SERVER_WORKERS);
+   par.routingWorkers = CLAMP (par.routingWorkers, 1, MAX_N_ROUTING_WORKERS);
+   par.resultCacheMB = MAX (0, par.resultCacheMB);
+   par.residentMB = MAX (0, par.residentMB);
    return true;
 }
 
@@ -863,6 +1038,13 @@ bool writeParam (const char *fileName, bool header, bool password) {
    fprintf (f, "J_FACTOR:        %d\n", par.jFactor);
    fprintf (f, "K_FACTOR:        %d\n", par.kFactor);
    fprintf (f, "N_SECTORS:       %d\n", par.nSectors);
+   fprintf (f, "N_THREADS:       %d\n", par.nThreads);
+   fprintf (f, "VECTOR_SWEEP:    %d\n", par.vectorSweep);
+   fprintf (f, "SEGMENT_SEA:     %d\n", par.segmentSea);
+   fprintf (f, "SERVER_WORKERS:  %d\n", par.serverWorkers);
+   fprintf (f, "ROUTING_WORKERS: %d\n", par.routingWorkers);
+   fprintf (f, "RESULT_CACHE_MB: %d\n", par.resultCacheMB);
+   fprintf (f, "RESIDENT_MB:     %d\n", par.residentMB);
    fprintf (f, "PYTHON:          %d\n", par.python);
    fprintf (f, "CURL_SYS:        %d\n", par.curlSys);
    fprintf (f, "SMTP_SCRIPT:     %s\n", par.smtpScript);
@@ -897,22 +1079,85 @@ bool writeParam (const char *fileName, bool header, bool password) {
    return true;
 }
 
-/*! true if day light, false if night 
-   simplified : day if local theoric time is >= 6 and <= 18 
-   t is the time in hours from beginning of grib specified in tm0 */
-bool isDayLight (struct tm *tm0, double t, double lat, double lon) {
-    lon = lonCanonize(lon);
+/*! sunrise and sunset in local solar hours for day of year (1 = 1st january) at latitude lat.
+   Approximate sun position: declination (Cooper), equation of time, atmospheric refraction.
+   rise == set if polar night, 0 and 24 if polar day */
+static void sunRiseSet (int dayOfYear, double lat, double *rise, double *set) {
+   const double decl = DEG_TO_RAD * 23.44 * sin (DEG_TO_RAD * 360.0 * (284 + dayOfYear) / 365.0);
+   const double b = DEG_TO_RAD * 360.0 * (dayOfYear - 81) / 364.0;
+   const double eot = 9.87 * sin (2 * b) - 7.53 * cos (b) - 1.5 * sin (b); // equation of time in minutes
+   const double noon = 12.0 - eot / 60.0;
+   const double cosH = (sin (DEG_TO_RAD * -0.833) - sin (DEG_TO_RAD * lat) * sin (decl)) / (cos (DEG_TO_RAD * lat) * cos (decl));
+   if (cosH >= 1.0) {                // polar night
+      *rise = *set = noon;
+   }
+   else if (cosH <= -1.0) {          // polar day
+      *rise = 0.0;
+      *set = 24.0;
+   }
+   else {
+      const double halfDay = RAD_TO_DEG * acos (cosH) / 15.0;
+      *rise = noon - halfDay;
+      *set = noon + halfDay;
+   }
+}
+
+/*! true if day light, false if night: sun above horizon at local solar time 
+   t is the time in hours from beginning of grib specified in tm0. See also dayLightBuild for table version */
+bool isDayLight (const struct tm *tm0, double t, double lat, double lon) {
+   double rise, set;
+   const double solar = tm0->tm_hour + tm0->tm_min / 60.0 + t + lonCanonize (lon) / 15.0;
+   const double day = floor (solar / 24.0);
+   const double hour = solar - 24.0 * day;
+   sunRiseSet (tm0->tm_yday + 1 + (int) day, lat, &rise, &set);
+   return (hour >= rise) && (hour < set);
+}
+
+/*! build sunrise sunset table of dl for grib reference dataDate, dataTime, from t = 0 to tMax hours.
+   Nothing done if table already built for same reference and range. Return false if no memory */
+bool dayLightBuild (DayLight *dl, long dataDate, long dataTime, double tMax) {
+   const struct tm tm0 = gribDateToTm (dataDate, dataTime / 100);
+   const double hour0 = tm0.tm_hour + tm0.tm_min / 60.0;
+   const int firstDay = -1;                                        // west longitudes before grib reference day
+   const int lastDay = (int) floor ((hour0 + MAX (tMax, 0.0) + 12.0) / 24.0); // east longitudes after
+   const int nDays = lastDay - firstDay + 1;
+
+   if (dl->nDays > 0 && dl->dataDate == dataDate && dl->dataTime == dataTime && dl->nDays >= nDays)
+      return true;
 
-    // Ajouter les heures/minutes directement
-    tm0->tm_hour += (int)(t + lon / 15.0);  
-    tm0->tm_min  += (int)((t + lon / 15.0) * 60) % 60;
+   if ((size_t) nDays > dl->nAlloc) {
+      float *newRise = realloc (dl->sunRise, nDays * N_DAY_LIGHT_LAT * sizeof (float));
+      if (newRise != NULL) dl->sunRise = newRise;
+      float *newSet = realloc (dl->sunSet, nDays * N_DAY_LIGHT_LAT * sizeof (float));
+      if (newSet != NULL) dl->sunSet = newSet;
+      if (newRise == NULL || newSet == NULL) {
+         fprintf (stderr, "In dayLightBuild, Error: Malloc: %d days\n", nDays);
+         dl->nDays = 0;
+         return false;
+      }
+      dl->nAlloc = nDays;
+   }
+   for (int d = 0; d < nDays; d += 1) {
+      for (int i = 0; i < N_DAY_LIGHT_LAT; i += 1) {
+         double rise, set;
+         sunRiseSet (tm0.tm_yday + 1 + firstDay + d, i - 90, &rise, &set);
+         dl->sunRise [d * N_DAY_LIGHT_LAT + i] = rise;
+         dl->sunSet [d * N_DAY_LIGHT_LAT + i] = set;
+      }
+   }
+   dl->dataDate = dataDate;
+   dl->dataTime = dataTime;
+   dl->hour0 = hour0;
+   dl->firstDay = firstDay;
+   dl->nDays = nDays;
+   return true;
+}
 
-    mktime (tm0);  // Ajustement des débordements (ex : passage à un autre jour)
- 
-    if (lat > 75.0) return (tm0->tm_mon > 3 && tm0->tm_mon < 9);
-    if (lat < -75.0) return !(tm0->tm_mon > 3 && tm0->tm_mon < 9);
-    
-    return (tm0->tm_hour >= 6) && (tm0->tm_hour <= 18);
+/*! free table of dl */
+void dayLightFree (DayLight *dl) {
+   free (dl->sunRise);
+   free (dl->sunSet);
+   memset (dl, 0, sizeof (DayLight));
 }
 
 /*! for virtual Regatta. return penalty in seconds for manoeuvre type. Depend on tws and energy. Give also sTamina coefficient */
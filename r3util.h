@@ -23,7 +23,7 @@ extern PolMat wavePolMat;
 /*! parameters desciption */
 extern Par par;
 
-extern char *tIsSea;                   // array of byte. 0 if earth, 1 if sea
+extern char *tIsSea;                   // array of bits. 0 if earth, 1 if sea. See isSea
 
 /*! for competitors */
 extern CompetitorsList competitors;
@@ -31,7 +31,9 @@ extern CompetitorsList competitors;
 /*! functions defined in r3util.c */
 extern char   *epochToStr (time_t t, bool seconds, char *str, size_t len);
 extern struct tm gribDateToTm (long intDate, double nHours);
-extern bool   isDayLight (struct tm *tm0, double t, double lat, double lon);
+extern bool   isDayLight (const struct tm *tm0, double t, double lat, double lon);
+extern bool   dayLightBuild (DayLight *dl, long dataDate, long dataTime, double tMax);
+extern void   dayLightFree (DayLight *dl);
 extern char  *fSailName (int val, char *str, size_t maxLen);
 extern char   *newFileNameSuffix (const char *fileName, const char *suffix, char *newFileName, size_t maxLen);
 extern double offsetLocalUTC (void);
@@ -51,6 +53,7 @@ extern char   *newDateWeekDayVerbose (long intDate, double myTime, char *res, si
 extern bool   readParam (const char *fileName);
 extern bool   writeParam (const char *fileName, bool header, bool password);
 extern bool   readIsSea (const char *fileName);
+extern void   isSeaFree (void);
 extern void   updateIsSeaWithForbiddenAreas (void);
 extern bool   mostRecentFile (const char *directory, const char *pattern0, const char *pattern1, char *name, size_t maxLen);
 extern double fPenalty (int shipIndex, int type, double tws, double energy, double *cStamina);
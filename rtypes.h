@@ -42,6 +42,7 @@
 #define RAD_TO_DEG            (180.0/G_PI)      // conversion radius to degree
 #define DEG_TO_RAD            (G_PI/180.0)      // conversion degree to radius
 #define SIZE_T_IS_SEA         (3601 * 1801)     // size of size is sea 
+#define SIZE_T_IS_SEA_BYTES   ((SIZE_T_IS_SEA + 7) / 8) // size in bytes of bit-packed tIsSea
 #define MAX_N_WAY_POINT       10                // Max number of Way Points
 #define PROG_WEB_SITE         "http://www.orange.com"  
 #define PROG_NAME             "RCube"         
@@ -52,11 +53,15 @@
 
 #define MILLION               1000000           // Million !
 #define NIL                   (-100000)         // for routing return when unreacheable
+#define PRUNED                (-200000)         // for chooseDeparture.t when try abandoned as it cannot beat best
 #define MAX_N_DAYS_WEATHER    16                // Max number od days for weather forecast
+#define N_DAY_LIGHT_LAT       181               // one degree latitude bands of daylight table, -90 to 90
 #define MAX_SIZE_ISOC         100000            // Max number of point in an isochrone
 #define MAX_N_ISOC            (384 + 1) * 4     // Max Hours in 16 days * 4 times per hours Max (tSep = 15 mn) required for STATIC way
 #define MAX_N_POL_MAT_COLS    128               // Max number of column in polar
 #define MAX_N_POL_MAT_LINES   128               // Max number of lines in polar
+#define POL_GRID_TWA_STEP     1.0               // TWA step in degrees of compiled polar grid
+#define POL_GRID_W_STEP       0.1               // TWS (or wave height) step of compiled polar grid
 #define MAX_SIZE_LINE         256		         // Max size of pLine in text files
 #define MAX_SIZE_STD          1024		         // Max size of lines standard
 #define MAX_SIZE_LINE_BASE64  1024              // Max size of line in base64 mail file
@@ -93,6 +98,11 @@
 #define MAX_SIZE_SHIP_NAME    21                // see AIS specificatiions
 #define MAX_N_SAIL            8                 // Max number of sails in sailName table
 #define MAX_N_SECTORS         3600              // Max number of sectors for optimization of sectors
+#define MAX_N_THREADS         64                // Max number of worker threads for isochrone expansion
+#define MAX_N_SERVER_WORKERS  64                // Max number of r3server threads serving connections
+#define MAX_N_ROUTING_WORKERS 16                // Max number of r3server threads running routings concurrently
+#define MAX_N_ARENA_BLOCK     32                // Max number of blocks in isochrone arena. Block size doubles
+#define ARENA_MIN_BLOCK       16384             // Number of points of first block of isochrone arena
 
 // NOAA or ECMWF or ARPEGE or AROME for web download or MAIL. Specific for current
 enum {NOAA_WIND, ECMWF_WIND, ARPEGE_WIND, AROME_WIND, MAIL, MAIL_SAILDOCS_CURRENT}; 
@@ -109,7 +119,7 @@ enum {NOTHING, JUST_POINT, SEGMENT, BEZIER};    // bezier or segment representat
 enum {UNVISIBLE, NORMAL, CAT, PORT, NEW};       // for POI point of interest
 enum {RUNNING, STOPPED, NO_SOLUTION, EXIST_SOLUTION};          // for chooseDeparture.ret values and allCompetitors check
 enum {GRIB_STOPPED = -2, GRIB_RUNNING = -1, GRIB_ERROR = 0, GRIB_OK = 1, GRIB_UNCOMPLETE = 2, GRIB_ONLY_DOWNLOAD = 3}; // for readGribCheck and readCurentGribCheck
-enum {ROUTING_STOPPED = -2, ROUTING_ERROR = -1, ROUTING_RUNNING = 0};   // for routingLaunch
+enum {ROUTING_PRUNED = -3, ROUTING_STOPPED = -2, ROUTING_ERROR = -1, ROUTING_RUNNING = 0};   // for routingLaunch
 enum {NO_ANIMATION, PLAY, LOOP};                // for animationActive status
 enum {WIND_DISP, GUST_DISP, WAVE_DISP, RAIN_DISP, PRESSURE_DISP}; // for display
 
@@ -179,6 +189,7 @@ typedef struct {
    int tEnd;
    double tInterval; // time interval in decimal hours betwen tries
    int tStop;
+   int prune;        // if true, tries that cannot beat best are abandoned (PRUNED) and unreachable ones (NIL) do not stop search
    double t [MAX_N_TIME_STAMPS];
    double minDuration;
    double maxDuration;
@@ -223,6 +234,34 @@ typedef struct {
    float prate;               // precipitation rate
 } FlowP;                      // either wind or current
 
+/*! grid points of a lat lon box at the two grib time stamps around time t, built by flowSliceBuild
+   once per isochrone so that each point lookup does only spatial interpolation */
+typedef struct {
+   bool   valid;              // false if not built: lookups use grib data directly
+   double t;                  // time of the slice in hours after grib reference time
+   double t0;                 // grib time stamp before or equal t
+   double t1;                 // grib time stamp after or equal t
+   long   iLat0;              // grid index of south row of the box
+   long   iLon0;              // grid index of west column of the box
+   long   nLat;               // number of rows of the box
+   long   nLon;               // number of columns of the box
+   size_t nAlloc;             // number of FlowP allocated in node
+   FlowP  *node;              // node [2 * (i * nLon + j)] at t0, next one at t1
+} FlowSlice;
+
+/*! sunrise and sunset in local solar hours per day and per latitude band, built by dayLightBuild
+   over grib time range so that daylight test is a table lookup */
+typedef struct {
+   long   dataDate;           // grib reference date the table is built for
+   long   dataTime;           // grib reference time the table is built for
+   double hour0;              // hour of day of grib reference time
+   int    firstDay;           // day of the first line, relative to grib reference day
+   int    nDays;              // number of days of the table
+   size_t nAlloc;             // number of days allocated
+   float  *sunRise;           // sunRise [(day - firstDay) * N_DAY_LIGHT_LAT + band]
+   float  *sunSet;            // same for sunset. sunRise == sunSet if polar night, 0 and 24 if polar day
+} DayLight;
+
 /*! zone description */
 typedef struct {
    bool   anteMeridian;       // set at true if zone crosses meridian 180
@@ -255,22 +294,41 @@ typedef struct {
    size_t intervalLimit;
 } Zone;
 
-/*! Point in isochrone */
+/*! decoded grib data, either allocated or mapped from cache file */
+typedef struct {
+   FlowP  *data;
+   void   *map;               // not NULL when data is mapped from cache file
+   size_t mapLen;
+} GribStore;
+
+/*! grib file to load in tGribData [iFlow] by readGribAllFlows */
+typedef struct {
+   const char *fileName;
+   Zone   *zone;
+   int    iFlow;              // WIND or CURRENT
+   bool   ret;                // result of load
+} GribLoad;
+
+/*! Point in isochrone. 32 bytes: coordinates stay double, small fields are packed.
+   Metrics of candidate points are kept apart in PpMetric */
 typedef struct {
+   double lat;
+   double lon;
    int    id;
    int    father;
-   int    amure;
-   int    sail;
+   int    fatherIndex;       // index of father in previous isochrone
+   signed char amure;
+   signed char sail;
    bool   motor;
-   int    sector;
-   int    toIndexWp;
-   double lat;
-   double lon;
-   double dd;        // distance to pDest
-   double vmc;       // velocity made on course
-   double orthoVmc;  // distance to the middle direction
+   signed char toIndexWp;    // index of way point aimed, -1 for destination
 } Pp;
 
+/*! metrics of candidate point built by isochrone expansion, parallel to candidate list, for forwardSectorOptimize */
+typedef struct {
+   double vmc;               // velocity made on course
+   double orthoVmc;          // distance to the middle direction
+} PpMetric;
+
 /*! isochrone meta data */ 
 typedef struct {
    int    toIndexWp;       // index of waypoint targetted
@@ -289,6 +347,15 @@ typedef struct {
    double t [MAX_N_POL_MAT_LINES][MAX_N_POL_MAT_COLS];
    int    nLine;
    int    nCol;
+   // dense grid compiled by readPolar. grid is NULL if not compiled
+   double *grid;          // grid [iTwa * nGridCol + iW] value at twa = iTwa * POL_GRID_TWA_STEP, w = iW * POL_GRID_W_STEP
+   double *gridMax;       // gridMax [iW] max value for all twa at w = iW * POL_GRID_W_STEP
+   int    *lIndex;        // lIndex [iTwa] first line of t with twa value > iTwa * POL_GRID_TWA_STEP
+   int    *cIndex;        // cIndex [iW] first col of t with w value > iW * POL_GRID_W_STEP
+   int    nGridLine;
+   int    nGridCol;
+   double gridMaxW;       // grid covers w in [0, gridMaxW[. Outside, t is used
+   double gridErr;        // max difference measured between grid and t interpolation
 } PolMat;
 
 /*! Point for way point route */
@@ -353,6 +420,32 @@ typedef struct {
    Competitor t [MAX_N_COMPETITORS];
 } CompetitorsList;
 
+/*! compact result of one boat of a fleet. Route itself is not kept */
+typedef struct {
+   char   name [MAX_SIZE_NAME];
+   double lat;                             // start position
+   double lon;
+   int    ret;                             // return of routing. > 0 if destination reached
+   int    rank;                            // 1 for winner. 0 if no solution
+   double duration;                        // in hours, duration of the trip. HUGE_VAL if no solution
+   double dist;                            // orthodromic distance to destination
+   double totDist;                         // route distance in NM
+   double avrSog;                          // average Speed Over Ground
+   double maxTws;                          // max wind speed of the route
+   int    nSailChange;                     // number of sail change
+   int    nAmureChange;                    // number of amure change
+   char   strETA [MAX_SIZE_DATE];          // estimated Time of Arrival
+} FleetBoat;
+
+/*! fleet of boats with no limit in number, routed by fleetRun */
+typedef struct {
+   int n;                                  // number of boats
+   int nAlloc;                             // number of boats allocated in t
+   int nDone;                              // number of boats routed. Atomic, for progress
+   int ret;                                // return of fleetRun running function
+   FleetBoat *t;                           // dynamic array of boats
+} FleetList;
+
 /*! Route description  */
 typedef struct {
    char   polarFileName [MAX_SIZE_FILE_NAME];   // save the polar name
@@ -362,6 +455,7 @@ typedef struct {
    double isocTimeStep;                         // isoc time step for this route in hours
    int    n;                                    // number of steps
    double calculationTime;                      // compute time to calculate the route
+   size_t isocMemory;                           // bytes used to store isochrones of the route
    double lastStepDuration;                     // in hours, last step (to destination)
    double lastStepWpDuration [MAX_N_WAY_POINT]; // in hours, to waypoints 
    int    nWayPoints;                           // number of WayPoints (0 if only destination)
@@ -410,6 +504,13 @@ typedef struct {
    int jFactor;                              // factor for target point distance used in sectorOptimize
    int kFactor;                              // factor for target point distance used in sectorOptimize
    int nSectors;                             // number of sector for optimization by sector
+   int nThreads;                             // number of worker threads for isochrone expansion, grib decoding and departure search
+   int vectorSweep;                          // true if heading sweep of isochrone expansion is vectorized, false for scalar path
+   int segmentSea;                           // true if whole segment of each step must be at sea, not only its end
+   int serverWorkers;                        // number of r3server threads serving short requests
+   int routingWorkers;                       // number of r3server threads running routings concurrently
+   int resultCacheMB;                        // memory budget in MB of r3server cache of routing results. 0: no cache
+   int residentMB;                           // memory budget in MB of grib and polar files kept resident by r3server
    char workingDir [MAX_SIZE_FILE_NAME];     // working directory
    char gribFileName [MAX_SIZE_FILE_NAME];   // name of grib file
    int  mostRecentGrib;                      // true if most recent grib in grib directory to be selected
@@ -496,6 +597,71 @@ typedef struct {
    int withCurrent;                          // true if current is  considered
 } Par;
 
+/*! sector used by forwardSectorOptimize */
+typedef struct {
+   double vmc;
+   double orthoVmc;
+   int nPt;
+} Sector;
+
+/*! read only data shared between routing contexts: grib, polars, sea mask */
+typedef struct {
+   const Zone *zone;                         // wind zone
+   const Zone *currentZone;                  // current zone
+   const FlowP *windData;                    // wind grib data described by zone
+   const FlowP *currentData;                 // current grib data described by currentZone
+   const PolMat *polMat;                     // boat polar
+   const PolMat *sailPolMat;                 // sail polar
+   const PolMat *wavePolMat;                 // wave polar
+   char *tIsSea;                             // array of bits. 0 if earth, 1 if sea. NULL means allways sea
+} RoutingData;
+
+/*! storage of isochrone points. Blocks are kept between routings and recycled */
+typedef struct {
+   Pp     *block [MAX_N_ARENA_BLOCK];        // blocks of points
+   size_t capacity [MAX_N_ARENA_BLOCK];      // number of points of each block
+   int    nBlock;                            // number of allocated blocks
+   int    current;                           // block in use
+   size_t used;                              // number of points used in current block
+   size_t nPoints;                           // number of points stored since last reset
+} IsocArena;
+
+/*! all state of one routing computation. Several contexts can run concurrently in one process */
+typedef struct RoutingContext {
+   Par par;                                  // private copy of parameters
+   WayPointList wayPoints;                   // private copy of way points
+   CompetitorsList competitors;              // private copy of competitors
+   ChooseDeparture chooseDeparture;          // for choice of departure time
+   RoutingData data;                         // shared grib and polar data
+   Pp **isocArray;                           // isocArray [i] is isochrone i with isoDesc [i].size points stored in arena
+   IsocArena arena;                          // storage of isochrone points
+   Pp *tempList;                             // working list of MAX_SIZE_ISOC points for isochrone expansion
+   PpMetric *tempMetric;                     // metrics of tempList points
+   Pp *optList;                              // working list of MAX_SIZE_ISOC points for isochrone optimization
+   IsoDesc *isoDesc;                         // isochrone meta data. Array one dimension
+   int maxNIsoc;                             // max number of isochrones based on grib zone time stamp and time step
+   int nIsoc;                                // total number of isochrones
+   int nIsocAlloc;                           // number of isochrones allocated in isocArray, isoDesc and route.t
+   Pp lastClosest;                           // closest point to destination in last isochrone computed
+   int pId;                                  // ID for points. -1 and 0 are reserved for pOr and pDest
+   double pOrToPDestCog;                     // cog from pOr to pDest
+   double tDeltaCurrent;                     // delta time in hours between wind zone and current zone
+   Sector sector [2][MAX_N_SECTORS];         // we keep even and odd last sectors
+   Pp *chunkBuffer [MAX_N_THREADS];          // private buffers of buildNextIsochrone worker threads
+   PpMetric *chunkMetric [MAX_N_THREADS];    // metrics of chunkBuffer points
+   struct _GThreadPool *chunkPool;           // persistent worker threads of buildNextIsochrone, NULL until needed
+   FlowSlice windSlice;                      // wind around time of isochrone being built, see flowSlicesBuild
+   FlowSlice currentSlice;                   // current around time of isochrone being built
+   DayLight dayLight;                        // sunrise sunset table over grib time range
+   SailRoute route;                          // route calculated
+   double pruneDuration;                     // if > 0, routing abandoned when its duration is sure to exceed this value
+   double pruneSpeed;                        // max speed in knots reachable by boat, for pruneDuration bound
+   HistoryRouteList historyRoute;            // routes saved by allCompetitors
+   struct RoutingContext *worker [MAX_N_THREADS]; // private contexts of bestTimeDepartureRun and fleetRun workers
+   void (*progress) (struct RoutingContext *ctx); // if not NULL, called after each isochrone and each routing
+   void *userData;                           // free for progress callback
+} RoutingContext;
+
 /*! for point of interest management */
 typedef struct {
    double lat;
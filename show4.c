@@ -212,6 +212,7 @@ static GThread *runThread;                         // global var for isochrone r
 static GMutex warningMutex;                        // mutex for warnin message
 static char   statusbarWarningStr [MAX_SIZE_TEXT]; // global var to store warning string
 static struct tm startInfo =  {0};                 // initilized with fCalendar
+static FleetList fleet = {0};                      // boats of Virtual Regatta dashboard for fleet routing
 
 /*! struct for animation */
 static struct {
@@ -296,6 +297,7 @@ static void stopChildThread () {
    g_atomic_int_set (&route.ret, ROUTING_STOPPED);         // for route calculation stop BUG
    g_atomic_int_set (&chooseDeparture.ret, STOPPED);       // to force stop of choose departure
    g_atomic_int_set (&competitors.ret, STOPPED);           // to force stop when all competitors run
+   g_atomic_int_set (&fleet.ret, STOPPED);                 // to force stop of fleet routing
    printf ("Thread killed\n");
 }
 
@@ -1391,7 +1393,7 @@ static gboolean drawAllIsochrones0 (cairo_t *cr) {
       GdkRGBA color = colors [i % N_COLORS];
       cairo_set_source_rgba (cr, color.red, color.green, color.blue, color.alpha);
       for (int k = 0; k < isoDesc [i].size; k++) {
-         pt = isocArray [i * MAX_SIZE_ISOC + k]; 
+         pt = isocArray [i][k]; 
          x = getX (pt.lon); 
          y = getY (pt.lat); 
          cairo_arc (cr, x, y, 1.0, 0, 2 * G_PI);
@@ -1407,7 +1409,7 @@ static gboolean drawClosest (cairo_t *cr) {
    Pp pt;
    CAIRO_SET_SOURCE_RGB_RED(cr);
    for (int i = 0; i < nIsoc; i++) {
-      pt = isocArray [i* MAX_SIZE_ISOC + isoDesc [i].closest];
+      pt = isocArray [i][isoDesc [i].closest];
       // printf ("lat: %.2lf, lon: %.2lf\n", pt.lat, pt.lon); 
       x = getX (pt.lon); 
       y = getY (pt.lat); 
@@ -1455,7 +1457,7 @@ static gboolean drawAllIsochrones (cairo_t *cr, int style) {
       
       index = isoDesc [i].first;
       for (int j = 0; j < isoDesc [i].size; j++) {
-         newIsoc [j] = isocArray [i * MAX_SIZE_ISOC + index];
+         newIsoc [j] = isocArray [i][index];
          index += 1;
          if (index == isoDesc [i].size) index = 0;
       }
@@ -3355,6 +3357,12 @@ static void onChooseDepartureButtonClicked (GtkWidget *widget, gpointer data) {
    gtk_grid_attach (GTK_GRID (grid), spinButtonMaxi, 1, 2, 1, 1);
    gtk_grid_attach (GTK_GRID (grid), labelHours,     2, 2, 1, 1);
 
+   /// prune line
+   GtkWidget *checkboxPrune = gtk_check_button_new_with_label ("Abandon tries that cannot beat best");
+   gtk_check_button_set_active ((GtkCheckButton *) checkboxPrune, chooseDeparture.prune);
+   g_signal_connect (G_OBJECT (checkboxPrune), "toggled", G_CALLBACK (onCheckBoxToggled), &chooseDeparture.prune);
+   gtk_grid_attach (GTK_GRID (grid), checkboxPrune, 0, 3, 3, 1);
+
    GtkWidget *hBox = OKCancelLine (onOkButtonDepClicked, depWindow);
 
    gtk_box_append (GTK_BOX (vBox), grid);
@@ -3857,9 +3865,9 @@ static void cbSimulationReport (GtkDrawingArea *area, cairo_t *cr,
    double poulidorVal = DBL_MAX; 
 
    CAIRO_SET_SOURCE_RGB_GRAY (cr);
-   // one gray vertical rectangle for each value
+   // one gray vertical rectangle for each value. None for pruned ones
    for (int count = 0; count < chooseDeparture.count; count += 1) {
-      if (count != chooseDeparture.bestCount && chooseDeparture.t [count] != NIL) {
+      if (count != chooseDeparture.bestCount && chooseDeparture.t [count] >= 0) {
          h = (int) (chooseDeparture.t [count] * yk);
          if (chooseDeparture.t [count] < poulidorVal && chooseDeparture.t [count] >= 0) {
             poulidorVal = chooseDeparture.t [count];
@@ -4305,8 +4313,8 @@ static void routeGram () {
    GtkWidget *routeWindow = gtk_application_window_new (GTK_APPLICATION (app));
 
    if (route.calculationTime > 0)
-      snprintf (str, sizeof (str), "Destnation %s %s      Compute Time: %.2lf sec.", (route.destinationReached) ? 
-       "Reached" : "Unreached", competitors.t [cIndex].name, route.calculationTime);
+      snprintf (str, sizeof (str), "Destnation %s %s      Compute Time: %.2lf sec.      Isoc Memory: %zu KB", (route.destinationReached) ? 
+       "Reached" : "Unreached", competitors.t [cIndex].name, route.calculationTime, route.isocMemory / 1024);
    else 
       snprintf (str, sizeof (str), "Desination %s %s", (route.destinationReached) ? "Reached" : "Unreached", competitors.t [cIndex].name);
 
@@ -6174,6 +6182,68 @@ static void virtualRegDashboardImport () {
    free (buffer);
 }
 
+/*! check if fleet routing is terminated */
+static gboolean fleetCheck (gpointer data) {
+   char str [MAX_SIZE_LINE] = "";
+   char footer [MAX_SIZE_LINE];
+   int localRet = g_atomic_int_get (&fleet.ret); // atomic read
+   int nDone = g_atomic_int_get (&fleet.nDone);
+   switch (localRet) {
+   case RUNNING: // not terminated
+      g_mutex_lock (&warningMutex);
+      snprintf (str, sizeof (str),"%.0lf%% Fleet boats routed: %d/%d", 100.0 * nDone / MAX (1, fleet.n), nDone, fleet.n);
+      statusWarningMessage (statusbar, str);
+      g_mutex_unlock (&warningMutex);
+      return TRUE;
+   case NO_SOLUTION: 
+      snprintf (str, MAX_SIZE_LINE, "No solution: No boat of fleet can reach target");
+      break;
+   case STOPPED:
+      break;
+   case EXIST_SOLUTION: {
+      GString *report = fleetToStr (&fleet, footer, sizeof (footer));
+      displayText (app, report->str, report->len, "Fleet Ranking", footer);
+      g_string_free (report, TRUE);
+      break;
+   }
+   default: 
+      snprintf (str, MAX_SIZE_LINE, "In fleetCheck: Unknown fleet.ret: %d\n", localRet);
+      break;
+   }
+   waitMessageDestroy ();
+   if (runThread != NULL)
+      g_thread_unref (runThread);
+   runThread = NULL;
+   if (str [0] != '\0')
+      infoMessage (str, GTK_MESSAGE_WARNING);
+   return FALSE;
+}
+
+/*! Import all boats of most recent virtual Regatta dashboard file and route them to destination */
+static void virtualRegFleet () {
+   char fileName [MAX_SIZE_FILE_NAME];
+   char directory [MAX_SIZE_DIR_NAME];
+
+   snprintf (directory, sizeof (directory), "%sVRdashboard/", par.workingDir); 
+   if (! mostRecentFile (directory, ".csv", "", fileName, sizeof (fileName))) { // most recent csv file found
+      infoMessage ("No Virtual Regatta dashboard file found", GTK_MESSAGE_WARNING);
+      return;
+   }
+   if (! isInZone (par.pDest.lat, par.pDest.lon, &zone) && (par.constWindTws == 0)) {
+      infoMessage ("Destination point not in wind zone", GTK_MESSAGE_WARNING);
+      return;
+   }
+   fleetFree (&fleet);
+   if (dashboardImportFleet (fileName, &fleet) <= 0) {
+      infoMessage ("No boat found in Virtual Regatta dashboard file", GTK_MESSAGE_WARNING);
+      return;
+   }
+   g_atomic_int_set (&fleet.ret, RUNNING); // mean not terminated
+   waitMessage ("Fleet Running", "It can take a while !!!\nWatch status bar ");
+   runThread = g_thread_new ("Fleet", fleetLaunch, &fleet); // launch routing
+   routingTimeout = g_timeout_add (ROUTING_TIME_OUT, fleetCheck, NULL);
+}
+
 /*! CallBack for test choice */
 static void cbDropDownSel (GObject *dropDown, GParamSpec *pspec, gpointer userData) {
    char str [MAX_SIZE_TEXT];
@@ -7071,15 +7141,15 @@ static void changeLastPoint () {
 
    if (menuWindow != NULL) popoverFinish (menuWindow);
    for (int i = 0; i < isoDesc [nIsoc - 1 ].size; i++) {
-      xLon = getX (isocArray [(nIsoc - 1) * MAX_SIZE_ISOC + i].lon);
-      yLat = getY (isocArray [(nIsoc - 1) * MAX_SIZE_ISOC + i].lat);
+      xLon = getX (isocArray [nIsoc - 1][i].lon);
+      yLat = getY (isocArray [nIsoc - 1][i].lat);
       dXy = (xLon - x)*(xLon -x) + (yLat - y) * (yLat - y);
       if (dXy < minDxy) {
          minDxy = dXy;
          selectedPointInLastIsochrone = i;
       }
    }
-   lastClosest = isocArray [(nIsoc - 1) * MAX_SIZE_ISOC + selectedPointInLastIsochrone];
+   lastClosest = isocArray [nIsoc - 1][selectedPointInLastIsochrone];
    storeRoute (&route, &par.pOr, &lastClosest);
    routeGram ();
 }
@@ -7933,6 +8003,7 @@ static void appStartup (GApplication *application) {
    createAction ("LogDump", logDump);
    createAction ("VirtualRegDashboardImport", virtualRegDashboardImport);
    createAction ("VirtualRegStaminaCalculator", virtualRegStaminaCalculator);
+   createAction ("VirtualRegFleet", virtualRegFleet);
 
    createAction ("Nmea", nmeaConf);
    createAction ("Gps", gpsDump);
@@ -8034,6 +8105,7 @@ static void appStartup (GApplication *application) {
    subMenu (misc_menu_v, "Log Dump", "app.LogDump");
    subMenu (misc_menu_v, "Virtual Regatta Dashboard Import", "app.VirtualRegDashboardImport");
    subMenu (misc_menu_v, "Virtual Regatta Stamina Calculator","app.VirtualRegStaminaCalculator");
+   subMenu (misc_menu_v, "Virtual Regatta Fleet Routing", "app.VirtualRegFleet");
 
    // Add elements for "Display" menu
    GMenu *display_menu_v = g_menu_new ();
@@ -8122,7 +8194,7 @@ static void cleanAll () {
    freeDisplayTextResources ();
    g_hash_table_destroy (aisTable);
    freeSHP ();
-   free (tIsSea);
+   isSeaFree ();
    free (isoDesc);
    free (isocArray);
    free (route.t);